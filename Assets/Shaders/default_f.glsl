@@ -1,7 +1,21 @@
 #version 400
 
-uniform vec4 u_lightPos;
-uniform vec4 u_colour;
+// Features, #defined by Shader::loadShaderFromFile (see ShaderPermutations.h)
+// LIT - diffuse light from u_lightPos added to the colour
+// TEXTURED - the colour is multiplied by u_tex
+
+// Uniform blocks, shared by every program (see UniformBlocks.h)
+layout(std140) uniform FrameData
+{
+	mat4 u_view;
+	mat4 u_proj;
+	mat4 u_viewProj;
+	vec4 u_lightPos; // eye space
+};
+
+#ifdef TEXTURED
+uniform sampler2D u_tex;
+#endif
 
 // Fragment Shader Inputs
 in VertexData
@@ -16,11 +30,20 @@ layout(location = 0) out vec4 FragColor; // corresponds to the FBO attachments
 
 void main()
 {
-	FragColor = vec4(vIn.normal * 0.5 + 0.5, 1.0f);
-	
+	vec3 colour = vIn.colour.rgb;
+
+#ifdef LIT
 	vec3 L = normalize(u_lightPos.xyz - vIn.posEye);
 	vec3 N = normalize(vIn.normal);
 
 	float diffuse = max(0.0, dot(N, L));
-	FragColor = vec4(vec3(0.5, 0.5, 0.5) * (diffuse * 0.8f) + u_colour.rgb, 1.0f);
+	colour += vec3(0.5, 0.5, 0.5) * (diffuse * 0.8f);
+#endif
+
+#ifdef TEXTURED
+	vec4 texel = texture(u_tex, vIn.texCoord.xy);
+	FragColor = vec4(colour * texel.rgb, vIn.colour.a * texel.a);
+#else
+	FragColor = vec4(colour, 1.0f);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#version 430
+#extension GL_ARB_shader_draw_parameters : require
+
+// Vertex Shader Inputs
+// Meshes in a geometry arena are always float (see TTK/GeometryArena.h)
+layout(location = 0) in vec3 vIn_vertex;
+layout(location = 1) in vec3 vIn_normal;
+layout(location = 2) in vec3 vIn_uv;
+
+// Per draw data, one for each object drawn by glMultiDrawElementsIndirect (see MultiDrawRenderer.h)
+struct DrawData
+{
+	mat4 model;
+	vec4 colour;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer
+{
+	DrawData draws[];
+};
+
+// Uniform blocks, shared by every program (see UniformBlocks.h)
+layout(std140) uniform FrameData
+{
+	mat4 u_view;
+	mat4 u_proj;
+	mat4 u_viewProj;
+	vec4 u_lightPos; // eye space
+};
+
+// Uniforms
+// Constants throughout the entire pipeline
+// These values are sent from C++ (glSendUniform*)
+uniform int u_firstDraw; // gl_DrawID counts from 0 in every multi draw call
+
+out VertexData
+{
+	vec3 normal;
+	vec3 texCoord;
+	vec4 colour;
+	vec3 posEye;
+} vOut;
+
+void main() 
+{
+	DrawData draw = draws[u_firstDraw + gl_DrawIDARB];
+	mat4 mv = u_view * draw.model;
+
+	vOut.texCoord = vIn_uv;
+	vOut.colour = draw.colour;
+	vOut.normal = (mv * vec4(vIn_normal, 0.0)).xyz;
+	vOut.posEye = (mv * vec4(vIn_vertex, 1.0)).xyz;
+
+	gl_Position = u_viewProj * (draw.model * vec4(vIn_vertex, 1.0));
+}
\ No newline at end of file
@@ -1,5 +1,10 @@
  #version 400
 
+// Features, #defined by Shader::loadShaderFromFile (see ShaderPermutations.h)
+// INSTANCED - the model matrix and colour are per instance attributes (see InstanceBatcher.h)
+// LIT - normal and eye space position for default_f.glsl's lighting
+// TEXTURED - texture coordinates
+
 // Vertex Shader Inputs
 // These are the attributes of the vertex
 layout(location = 0) in vec3 vIn_vertex;
@@ -7,13 +12,44 @@ layout(location = 1) in vec3 vIn_normal;
 layout(location = 2) in vec3 vIn_uv;
 layout(location = 3) in vec4 vIn_colour;
 
-// Uniforms
-// Constants throughout the entire pipeline
-// These values are sent from C++ (glSendUniform*)
-uniform mat4 u_mvp;
-uniform mat4 u_mv;
-uniform vec4 u_colour;
+#ifdef INSTANCED
+// Per instance attributes, one set for each object drawn (see InstanceBatcher.h)
+// A mat4 attribute takes four locations, so the model matrix uses 4 to 7
+layout(location = 4) in mat4 iIn_model;
+layout(location = 8) in vec4 iIn_colour;
+#endif
+
+// Uniform blocks, shared by every program (see UniformBlocks.h)
+layout(std140) uniform FrameData
+{
+	mat4 u_view;
+	mat4 u_proj;
+	mat4 u_viewProj;
+	vec4 u_lightPos; // eye space
+};
+
+#ifdef INSTANCED
+// Packed vertex formats (see TTK/VertexPacking.h)
+// position = vIn_vertex * u_positionScale + u_positionOffset
+uniform vec4 u_positionScale = vec4(1.0);
+uniform vec4 u_positionOffset = vec4(0.0);
+uniform int u_octNormals = 0; // normal is octahedron encoded in .xy
+#else
+layout(std140) uniform ObjectData
+{
+	mat4 u_mvp;
+	mat4 u_mv;
+	vec4 u_colour;
+
+	// Packed vertex formats (see TTK/VertexPacking.h)
+	// position = vIn_vertex * u_positionScale + u_positionOffset
+	vec4 u_positionScale;
+	vec4 u_positionOffset;
+	int u_octNormals; // normal is octahedron encoded in .xy
+};
+#endif
 
+// Outputs the fragment shader doesn't use for these features are left unwritten
 out VertexData
 {
 	vec3 normal;
@@ -22,12 +58,37 @@ out VertexData
 	vec3 posEye;
 } vOut;
 
+#ifdef LIT
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+#endif
+
 void main() 
 {
-	vOut.texCoord = vIn_uv;
+	vec3 position = vIn_vertex * u_positionScale.xyz + u_positionOffset.xyz;
+
+#ifdef INSTANCED
+	mat4 mv = u_view * iIn_model;
+	vOut.colour = iIn_colour;
+	gl_Position = u_viewProj * (iIn_model * vec4(position, 1.0));
+#else
+	mat4 mv = u_mv;
 	vOut.colour = u_colour;
-	vOut.normal = (u_mv * vec4(vIn_normal, 0.0)).xyz;
-	vOut.posEye = (u_mv * vec4(vIn_vertex, 1.0)).xyz;
+	gl_Position = u_mvp * vec4(position, 1.0);
+#endif
+
+#ifdef TEXTURED
+	vOut.texCoord = vIn_uv;
+#endif
 
-	gl_Position = u_mvp * vec4(vIn_vertex, 1.0);
+#ifdef LIT
+	vec3 normal = u_octNormals != 0 ? octDecode(vIn_normal.xy) : vIn_normal;
+	vOut.normal = (mv * vec4(normal, 0.0)).xyz;
+	vOut.posEye = (mv * vec4(position, 1.0)).xyz;
+#endif
 }
\ No newline at end of file
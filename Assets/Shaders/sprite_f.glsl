@@ -15,5 +15,7 @@ layout(location = 0) out vec4 FragColor;
 
 void main()
 {
-	FragColor = texture(u_tex, vIn.texCoord.xy);
+	// Colour is added like QuadMesh::draw_1_0 does (GL_ADD), alpha is multiplied
+	vec4 texel = texture(u_tex, vIn.texCoord.xy);
+	FragColor = vec4(texel.rgb + vIn.colour.rgb, texel.a * vIn.colour.a);
 }
\ No newline at end of file
@@ -1,18 +1,15 @@
- #version 400
+#version 400
 
 // Vertex Shader Inputs
-// These are the attributes of the vertex
+// Written by TTK::SpriteBatch, see TTK/SpriteBatch.h
 layout(location = 0) in vec3 vIn_vertex;
-layout(location = 1) in vec3 vIn_normal;
-layout(location = 2) in vec3 vIn_uv;
+layout(location = 2) in vec2 vIn_uv;
 layout(location = 3) in vec4 vIn_colour;
 
 // Uniforms
 // Constants throughout the entire pipeline
 // These values are sent from C++ (glSendUniform*)
 uniform mat4 u_mvp;
-uniform mat4 u_mv;
-uniform vec4 u_colour;
 
 out VertexData
 {
@@ -24,7 +21,7 @@ out VertexData
 
 void main() 
 {
-	vOut.texCoord = vIn_uv;
+	vOut.texCoord = vec3(vIn_uv, 0.0);
+	vOut.colour = vIn_colour;
 	gl_Position = u_mvp * vec4(vIn_vertex, 1.0);
-    
 }
\ No newline at end of file
@@ -13,6 +13,8 @@
 
 #include "Material.h"
 
+class ObjectRenderer;
+
 class GameObject
 {
 protected:
@@ -30,6 +32,9 @@ protected:
 	GameObject* m_pParent;
 	std::vector<GameObject*> m_pChildren;
 
+	// Level of detail drawn last frame
+	unsigned int m_pLOD;
+
 public:
 	GameObject();
 	GameObject(glm::vec3 position, std::shared_ptr<TTK::OBJMesh> _mesh, std::shared_ptr<Material> _material);
@@ -46,6 +51,14 @@ public:
 	virtual void update(float dt);	
 	virtual void draw(TTK::Camera &camera);
 
+	// Instead of drawing right away, queues this object and its children in renderer
+	// to be drawn together with the other objects (see ObjectRenderer.h)
+	virtual void submit(ObjectRenderer &renderer, TTK::Camera &camera);
+
+	// Picks the mesh's level of detail for the camera: the coarsest one whose error
+	// covers no more than lodPixelError pixels on screen. Called by draw.
+	unsigned int selectLOD(TTK::Camera &camera);
+
 	// Forward Kinematics
 	// Pass in null to make game object a root node
 	void setParent(GameObject* newParent);
@@ -59,6 +72,10 @@ public:
 	std::string name;
 	glm::vec4 colour; 
 
+	// Levels of detail, see selectLOD
+	float lodPixelError;
+	float lodHysteresis;	// A coarser level is only picked once its error is this fraction under lodPixelError, stops popping back and forth
+
 	std::shared_ptr<TTK::OBJMesh> mesh;
 	std::shared_ptr<Material> material;
 };
\ No newline at end of file
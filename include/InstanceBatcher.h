@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <map>
+
+#include "ObjectRenderer.h"
+
+// Collects the objects to draw this frame and draws every group sharing a mesh,
+// material and level of detail with one instanced draw call. The model matrices and
+// colours of all groups go to the GPU together in one buffer.
+// Materials without an instancedShader are still drawn one object at a time.
+class InstanceBatcher : public ObjectRenderer
+{
+public:
+	InstanceBatcher();
+	~InstanceBatcher();
+
+	void add(std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material, unsigned int lod,
+		const glm::mat4& model, const glm::vec4& colour);
+	void draw(TTK::Camera& camera);
+
+	// Draw calls and objects in the last draw
+	unsigned int getNumDrawCalls() { return numDrawCalls; }
+	unsigned int getNumInstances() { return numInstances; }
+
+	void destroy();
+
+private:
+	// Objects using the same mesh, material and level of detail
+	struct Batch
+	{
+		std::shared_ptr<TTK::MeshBase> mesh;
+		std::shared_ptr<Material> material;
+		unsigned int lod;
+		std::vector<ObjectInstance> instances;
+		size_t firstInstance;	// Where the instances start in instanceBuffer
+	};
+
+	typedef std::tuple<TTK::MeshBase*, Material*, unsigned int> BatchKey;
+
+	// Kept from frame to frame so the instance arrays don't get reallocated
+	std::map<BatchKey, Batch> batches;
+
+	// Every batch's instances one after another, copied into instanceBuffer each draw
+	std::vector<ObjectInstance> instanceData;
+	unsigned int instanceBuffer;
+	size_t instanceBufferSize;
+
+	unsigned int numDrawCalls;
+	unsigned int numInstances;
+
+	// Sends instanceData to the GPU, growing the buffer if it is too small
+	void uploadInstances();
+
+	// Per mesh uniforms, packed vertex formats
+	void setMeshUniforms(Material& material, TTK::MeshBase& mesh);
+};
@@ -1,33 +1,111 @@
 #pragma once
 
 #include "ShaderProgram.h"
+#include <memory>
+#include <vector>
+#include <string>
+
+// A uniform name turned into a number once, see Material::getParameterId
+typedef unsigned int ParameterId;
+
+enum ParameterType
+{
+	PARAMETER_INT = 0,	// Also bools and samplers
+	PARAMETER_FLOAT,
+	PARAMETER_VEC2,
+	PARAMETER_VEC3,
+	PARAMETER_VEC4,
+	PARAMETER_MAT3,
+	PARAMETER_MAT4
+};
 
 class Material
 {
 public:
 	std::shared_ptr<ShaderProgram> shader;
 
-	std::map<std::string, glm::vec4> vec4Uniforms;
-	std::map<std::string, glm::mat4> mat4Uniforms;
-	std::map<std::string, int> intUniforms;
-	// maps for other uniform types ...
+	// Optional, used when objects with this material are drawn together (see InstanceBatcher.h).
+	// Takes the model matrix and colour per instance instead of u_mvp, u_mv and u_colour
+	std::shared_ptr<ShaderProgram> instancedShader;
+
+	// Optional, used for meshes in a geometry arena (see MultiDrawRenderer.h).
+	// Reads the model matrix and colour from a storage buffer with gl_DrawID
+	std::shared_ptr<ShaderProgram> indirectShader;
+
+	// Drawn after everything opaque, blended and back to front (see RenderQueue.h)
+	bool transparent;
 
 	Material()
-		: shader(std::make_shared<ShaderProgram>())
+		: shader(std::make_shared<ShaderProgram>()),
+		transparent(false)
 	{}
 
+	// Description:
+	// Id for a uniform name, the same for every material. Look ids up once
+	// (a static or a member) and set parameters with them, there is no string
+	// compare or map lookup when setting or sending.
+	static ParameterId getParameterId(const std::string& uniformName);
+
+	// Setting a parameter to the value it already has does nothing.
+	// Names the shader doesn't have are kept but never sent, like glUniform with -1
+	void setInt(ParameterId id, int value);
+	void setFloat(ParameterId id, float value);
+	void setVec2(ParameterId id, const glm::vec2& value);
+	void setVec3(ParameterId id, const glm::vec3& value);
+	void setVec4(ParameterId id, const glm::vec4& value);
+	void setMat3(ParameterId id, const glm::mat3& value);
+	void setMat4(ParameterId id, const glm::mat4& value);
+
 	void sendUniforms() // send data to the GPU
 	{
-		// Send vector4 uniforms
-		for (auto itr = vec4Uniforms.begin(); itr != vec4Uniforms.end(); itr++)
-			shader->sendUniformVec4(itr->first, itr->second);
+		sendUniforms(*shader);
+	}
 
-		// Send mat4 uniforms
-		for (auto itr = mat4Uniforms.begin(); itr != mat4Uniforms.end(); itr++)
-			shader->sendUniformMat4(itr->first, itr->second);
+	// Sends the parameters changed since the last send to this program, ie. instancedShader.
+	// If anything else sent uniforms to the program in between, everything set is sent again
+	void sendUniforms(ShaderProgram& program);
 
-		// Send int uniforms
-		for (auto itr = intUniforms.begin(); itr != intUniforms.end(); itr++)
-			shader->sendUniformInt(itr->first, itr->second);
-	}
+private:
+	// One parameter's place in values
+	struct Parameter
+	{
+	public:
+		ParameterId id;
+		ParameterType type;
+		unsigned int offset;	// In bytes
+		bool isSet;				// Parameters laid out from the shader but never set are not sent, so the shader's defaults stay
+		unsigned int dirty;		// Bit i is set if programs[i] hasn't been sent the current value
+	};
+
+	// What has been sent to one program
+	struct ProgramState
+	{
+	public:
+		ShaderProgram* program;
+		unsigned int numLinks;			// Program's getNumLinks when uniformIndices was filled in
+		unsigned int numUploads;		// Program's getNumUploads after the last send
+		std::vector<int> uniformIndices;	// Per parameter, index in the program's uniform table or -1
+	};
+
+	// Maximum programs one material sends to, one dirty bit each
+	static const unsigned int MAX_PROGRAMS = 32;
+
+	std::vector<Parameter> parameters;
+	std::vector<unsigned char> values;		// Every parameter's value back to back
+	std::vector<int> parameterIndices;		// By ParameterId, index in parameters or -1
+	std::vector<ProgramState> programs;
+
+	void setParameter(ParameterId id, ParameterType type, const void* value);
+
+	// Index in parameters, adding the parameter if there isn't one yet
+	int findParameter(ParameterId id, ParameterType type);
+
+	// Adds a slot in values for every uniform program has that isn't a parameter yet
+	void layoutParameters(ShaderProgram& program);
+
+	ProgramState& getProgramState(ShaderProgram& program, unsigned int& programBit);
+
+	static ParameterType getParameterType(GLenum uniformType);
+	static bool isCompatible(ParameterType type, GLenum uniformType);
+	static unsigned int getParameterSize(ParameterType type);
 };
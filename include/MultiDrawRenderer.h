@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <TTK/GeometryArena.h>
+
+#include "ObjectRenderer.h"
+
+// Draws every object whose mesh is in a TTK::GeometryArena with one glMultiDrawElementsIndirect
+// per material (and arena block). The draw commands are built on the CPU each frame, each
+// object's model matrix and colour go in a shader storage buffer the indirect shader reads
+// with gl_DrawID. Needs OpenGL 4.3 and ARB_shader_draw_parameters.
+//
+// Meshes are added to the arena the first time they are drawn, once they have finished loading.
+// Objects whose mesh can't go in the arena, or whose material has no indirectShader, are
+// drawn one at a time like GameObject::draw.
+class MultiDrawRenderer : public ObjectRenderer
+{
+public:
+	MultiDrawRenderer(TTK::GeometryArena& arena = TTK::GeometryArena::shared());
+	~MultiDrawRenderer();
+
+	void add(std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material, unsigned int lod,
+		const glm::mat4& model, const glm::vec4& colour);
+	void draw(TTK::Camera& camera);
+
+	// False if the OpenGL context can't do multi draw indirect, every object is then drawn one at a time
+	static bool isSupported();
+
+	// Draw calls and objects in the last draw
+	unsigned int getNumDrawCalls() { return numDrawCalls; }
+	unsigned int getNumObjects() { return numObjects; }
+
+	void destroy();
+
+	// Shader storage binding the per draw data is read from, see default_indirect_v.glsl
+	static const unsigned int DRAW_DATA_BINDING = 0;
+
+private:
+	// Layout glMultiDrawElementsIndirect reads
+	struct DrawElementsIndirectCommand
+	{
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	// Everything drawn by one glMultiDrawElementsIndirect
+	struct DrawGroup
+	{
+		std::shared_ptr<Material> material;
+		unsigned int block;
+		std::vector<DrawElementsIndirectCommand> commands;
+		std::vector<ObjectInstance> drawData;	// One per command, indexed by gl_DrawID
+		size_t firstDraw;						// Where the group starts in commandBuffer / drawDataBuffer
+	};
+
+	// Objects drawn the slow way
+	struct SingleDraw
+	{
+		std::shared_ptr<TTK::MeshBase> mesh;
+		std::shared_ptr<Material> material;
+		unsigned int lod;
+		ObjectInstance instance;
+	};
+
+	TTK::GeometryArena& arena;
+
+	// Kept from frame to frame so the arrays don't get reallocated
+	std::map<std::pair<Material*, unsigned int>, DrawGroup> groups;
+	std::vector<SingleDraw> singleDraws;
+
+	// Every group's commands and draw data one after another
+	std::vector<DrawElementsIndirectCommand> commandData;
+	std::vector<ObjectInstance> drawData;
+	unsigned int commandBuffer;
+	unsigned int drawDataBuffer;
+	size_t commandBufferSize;
+	size_t drawDataBufferSize;
+
+	unsigned int numDrawCalls;
+	unsigned int numObjects;
+
+	// Looks up, or tries to add, the mesh in the arena
+	const TTK::ArenaMesh* findArenaMesh(TTK::MeshBase* mesh);
+
+	// Copies data into buffer, growing it if it is too small
+	void uploadBuffer(GLenum target, unsigned int& buffer, size_t& bufferSize, const void* data, size_t size);
+};
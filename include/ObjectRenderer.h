@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GLM/glm.hpp>
+#include <TTK/MeshBase.h>
+#include <TTK/Camera.h>
+#include <memory>
+#include <cstddef>
+
+#include "Material.h"
+#include "VertexBufferObject.h"
+
+// What the instanced and indirect shaders get for each object, in place of u_mvp, u_mv and u_colour
+struct ObjectInstance
+{
+	glm::mat4 model;
+	glm::vec4 colour;
+};
+
+template <>
+struct VertexLayout<ObjectInstance>
+{
+	static const unsigned int numElements = 5;
+
+	static const VertexElement* getElements()
+	{
+		// A mat4 attribute is four vec4 columns in a row
+		static const VertexElement elements[numElements] =
+		{
+			{ AttributeLocations::INSTANCE_MODEL_MATRIX, GL_FLOAT, 4, false, 0 },
+			{ (AttributeLocations)(AttributeLocations::INSTANCE_MODEL_MATRIX + 1), GL_FLOAT, 4, false, sizeof(glm::vec4) },
+			{ (AttributeLocations)(AttributeLocations::INSTANCE_MODEL_MATRIX + 2), GL_FLOAT, 4, false, sizeof(glm::vec4) * 2 },
+			{ (AttributeLocations)(AttributeLocations::INSTANCE_MODEL_MATRIX + 3), GL_FLOAT, 4, false, sizeof(glm::vec4) * 3 },
+			{ AttributeLocations::INSTANCE_COLOUR, GL_FLOAT, 4, false, offsetof(ObjectInstance, colour) }
+		};
+
+		return elements;
+	}
+};
+
+// Something objects are queued in and then drawn together, rather than each drawing itself.
+// See GameObject::submit, InstanceBatcher.h and MultiDrawRenderer.h
+class ObjectRenderer
+{
+public:
+	virtual ~ObjectRenderer() {}
+
+	// Queues one object for the next draw
+	virtual void add(std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material, unsigned int lod,
+		const glm::mat4& model, const glm::vec4& colour) = 0;
+
+	// Draws everything queued since the last draw, then empties the queue
+	virtual void draw(TTK::Camera& camera) = 0;
+};
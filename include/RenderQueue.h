@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "ObjectRenderer.h"
+#include "UniformBlocks.h"
+
+enum RenderPass
+{
+	PASS_OPAQUE = 0,	// Front to back, grouped by shader, material and mesh
+	PASS_TRANSPARENT	// Back to front after everything opaque, blended and not writing depth
+};
+
+// Collects the objects to draw this frame as draw packets, gives each a 64-bit sort key
+// and draws them in key order. Opaque keys sort by shader, then material, then mesh,
+// then depth front to back, so state changes least and nearer objects hide the ones
+// behind before they are shaded. Transparent keys sort by depth back to front first so
+// they blend correctly.
+//
+//	opaque:      | pass 2 | shader 10 | material 12 | mesh 16 | depth 24 |
+//	transparent: | pass 2 | far to near depth 24 | shader 10 | material 12 | mesh 16 |
+class RenderQueue : public ObjectRenderer
+{
+public:
+	RenderQueue();
+
+	void add(std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material, unsigned int lod,
+		const glm::mat4& model, const glm::vec4& colour);
+	void draw(TTK::Camera& camera);
+
+	// Draw calls, shader binds and material changes in the last draw
+	unsigned int getNumDrawCalls() { return numDrawCalls; }
+	unsigned int getNumShaderChanges() { return numShaderChanges; }
+	unsigned int getNumMaterialChanges() { return numMaterialChanges; }
+
+	void destroy();
+
+private:
+	struct DrawPacket
+	{
+		std::shared_ptr<TTK::MeshBase> mesh;
+		std::shared_ptr<Material> material;
+		unsigned int lod;
+		ObjectInstance instance;
+	};
+
+	// Key and the packet it belongs to, this is what gets sorted
+	struct SortEntry
+	{
+		uint64_t key;
+		unsigned int packet;
+	};
+
+	std::vector<DrawPacket> packets;
+	std::vector<SortEntry> sortEntries;
+	std::vector<SortEntry> sortScratch;	// Radix sort ping-pongs between the two
+	std::vector<ObjectData> objectData;	// Uniform blocks in sorted order
+
+	// Small ids for the key, given out the first time each is seen.
+	// Ids past what fits in the key share the last one, which only costs some grouping
+	std::map<const void*, unsigned int> shaderIds;
+	std::map<const void*, unsigned int> materialIds;
+	std::map<const void*, unsigned int> meshIds;
+
+	unsigned int numDrawCalls;
+	unsigned int numShaderChanges;
+	unsigned int numMaterialChanges;
+
+	uint64_t makeKey(const DrawPacket& packet, float depth);
+
+	// Least significant byte first, skips the bytes where every key is the same
+	void radixSort();
+
+	static unsigned int getId(std::map<const void*, unsigned int>& ids, const void* object, unsigned int numBits);
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <memory>
+
+#include <TTK/OBJMesh.h>
+#include <TTK/Camera.h>
+
+#include "GameObject.h"
+#include "InstanceBatcher.h"
+#include "MultiDrawRenderer.h"
+#include "RenderQueue.h"
+
+// How objects are drawn, press i to switch
+enum ObjectDrawMode
+{
+	DRAW_EACH_OBJECT,		// GameObject::draw, one draw call each
+	DRAW_SORTED,			// One draw call each, sorted by shader, material, mesh and depth
+	DRAW_INSTANCED,			// One instanced draw call per mesh and material
+	DRAW_MULTI_INDIRECT,	// One multi draw indirect call per material
+	NUM_DRAW_MODES
+};
+
+// The game objects, the meshes they use and the light, updated and drawn once a frame.
+// The tutorial and the benchmark (Benchmark.cpp) both run it, so the benchmark times
+// the same update and draw path the game does.
+//
+// loadFromFile reads a scene description, one entry per line, # starts a comment:
+//
+//	mesh <name> <OBJ file, relative to meshPath>
+//	object <name> <mesh> <x> <y> <z> [<r> <g> <b> <a>]
+//	grid <name> <mesh> <columns> <rows> <spacing> <y> [<r> <g> <b> <a>]
+//	parent <object> <parent object>
+//	light <object>
+//
+// A grid is columns * rows objects named <name>_0, <name>_1... spread over the xz plane
+// around the origin. parent makes the object's position relative to the parent's.
+// The light object is moved along with the light every update.
+class Scene
+{
+public:
+	Scene();
+
+	// Description:
+	// Loads the meshes and objects in fileName, every object gets material.
+	// With async the meshes load in the background (see OBJMesh::loadMeshAsync) and
+	// objects pop in once their mesh is uploaded, otherwise they are all on the GPU
+	// when this returns. Returns false if the file can't be read or a line is wrong.
+	bool loadFromFile(const std::string& fileName, const std::string& meshPath, std::shared_ptr<Material> material,
+		const TTK::OBJLoadOptions& loadOptions, bool async);
+
+	// Moves the light and updates every root object (they update their children)
+	void update(float dt);
+
+	// Draws every object seen from cam with drawMode
+	void draw(TTK::Camera& cam);
+
+	// Draw calls made by the last draw
+	unsigned int getNumDrawCalls() { return numDrawCalls; }
+
+	// Name of each ObjectDrawMode, "each", "sorted", "instanced" and "indirect"
+	static const char* getDrawModeName(ObjectDrawMode mode);
+
+	void destroy();
+
+	// Note: looking up a mesh or object by it's string name is not the fastest thing,
+	// do it once in a while (like when loading) and keep a pointer if you need it every frame.
+	std::map<std::string, std::shared_ptr<TTK::MeshBase>> meshes;
+	std::map<std::string, std::shared_ptr<GameObject>> gameobjects;
+
+	glm::vec4 lightPos;
+	std::string lightObject;	// Moved with the light, empty for none
+
+	ObjectDrawMode drawMode;
+
+private:
+	float lightAngle;
+	unsigned int numDrawCalls;
+
+	InstanceBatcher instanceBatcher;
+	MultiDrawRenderer multiDrawRenderer;
+	RenderQueue renderQueue;
+
+	// The meshes loadFromFile loaded, objects need them as OBJMeshes
+	std::map<std::string, std::shared_ptr<TTK::OBJMesh>> objMeshes;
+
+	// Adds an object using mesh meshName, returns null (and says why) if there is no such mesh
+	std::shared_ptr<GameObject> addObject(const std::string& name, const std::string& meshName,
+		glm::vec3 position, glm::vec4 colour, std::shared_ptr<Material> material);
+};
@@ -2,11 +2,27 @@
 #include <string>
 #include "GLEW/glew.h"
 
+// Feature flags a shader can be compiled with. Each one is #defined at the top of
+// the source, so the GLSL can leave out what a material doesn't use with #ifdef
+// (see default_v.glsl and ShaderPermutations.h)
+enum ShaderFeature
+{
+	FEATURE_INSTANCED = 1 << 0,	// Model matrix and colour are per instance attributes (see InstanceBatcher.h)
+	FEATURE_LIT = 1 << 1,		// Normals and eye space position, for lighting
+	FEATURE_TEXTURED = 1 << 2,	// Texture coordinates and u_tex
+
+	NUM_SHADER_FEATURES = 3
+};
+
 class Shader
 {
 private:
 	unsigned int handle;
 	GLenum shaderType;
+	unsigned int features;
+	std::string source;		// With the feature #defines
+	std::string fileName;
+	bool compileChecked;	// compile status has been looked at since glCompileShader
 
 public:
 
@@ -23,10 +39,53 @@ public:
 	Shader();
 	~Shader();
 
-	// Returns shader handle
-	unsigned int loadShaderFromFile(std::string fileName, GLenum type);
+	// Description:
+	// Loads the shader's source, returns false if the file can't be read.
+	// It isn't compiled until compile() is called, which ShaderProgram::linkProgram
+	// only does if the program isn't in the binary cache (see TTK/ProgramBinaryCache.h)
+	// features is a mask of ShaderFeature, each is #defined after the #version line
+	bool loadShaderFromFile(std::string fileName, GLenum type, unsigned int features = 0);
+
+	// Same as above with source already in memory, fileName is only used in logs and the cache file name
+	bool loadShaderFromSource(const std::string& source, const std::string& fileName, GLenum type, unsigned int features = 0);
+
+	// Compiles the source if that hasn't been done yet, returns the shader handle or 0 if it failed
+	unsigned int compile()
+	{
+		submitCompile();
+		return finishCompile();
+	}
+
+	// Description:
+	// Starts compiling the source if that hasn't been done yet, without waiting for the result.
+	// With parallel shader compile (see ShaderBatch.h) the driver works on it on its own threads.
+	// Returns the shader handle, which can be attached and linked before the compile is done.
+	unsigned int submitCompile();
 
+	// True once the driver has finished compiling, so finishCompile won't wait.
+	// Always true without parallel shader compile
+	bool isCompileComplete();
+
+	// Checks the compile went through, waiting for it if needed, and prints the log if not.
+	// Returns the shader handle or 0 if it failed
+	unsigned int finishCompile();
+
+	// 0 until compiled
 	unsigned int getHandle() { return handle; }
 
+	GLenum getType() { return shaderType; }
+	const std::string& getSource() { return source; }
+	const std::string& getFileName() { return fileName; }
+	unsigned int getFeatures() { return features; }
+
+	// File name followed by the features, "default_v.glsl.LIT.TEXTURED"
+	std::string getVariantName();
+
+	// The name #defined for a single feature, "INSTANCED" for FEATURE_INSTANCED
+	static const char* getFeatureName(unsigned int feature);
+
+	// Features that source tests in a preprocessor line (#ifdef LIT...), the others make no difference to it
+	static unsigned int getUsedFeatures(const std::string& source);
+
 	void destroy();
 };
\ No newline at end of file
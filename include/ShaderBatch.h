@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "ShaderProgram.h"
+
+// Links several shader programs at once. Asking for a compile or link status makes the
+// driver finish that compile right away, so calling linkProgram on each program in turn
+// compiles one shader at a time. A batch submits every compile and link first and only
+// looks at the results once they are all in, which lets a driver with
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile work on them on its own
+// threads while the game gets on with other loading.
+//
+//	ShaderBatch batch;
+//	batch.add(material->shader);
+//	batch.add(material->instancedShader);
+//	batch.submit();
+//	... load meshes, textures ...
+//	batch.finish();
+//
+// Without either extension the batch still works, the driver just compiles on the thread
+// that asks for the first status.
+class ShaderBatch
+{
+public:
+	// The shaders attached to the programs must still be around when finish is called
+	void add(std::shared_ptr<ShaderProgram> program);
+
+	// Submits the link of every program added since the last submit, doesn't wait
+	void submit();
+
+	// True once the driver is done with every submitted program, so finish won't wait.
+	// Poll this each frame to show a loading screen instead of stalling in finish
+	bool isComplete();
+
+	// Finishes every submitted program, waiting for the ones still compiling.
+	// Returns the number that failed to link
+	unsigned int finish();
+
+	// True if the driver can compile shaders on its own threads. The first call turns it on
+	static bool isParallelCompileSupported();
+
+private:
+	std::vector<std::shared_ptr<ShaderProgram>> added;
+	std::vector<std::shared_ptr<ShaderProgram>> submitted;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "ShaderProgram.h"
+#include "ShaderBatch.h"
+
+// One vertex and fragment shader pair written with #ifdef for each ShaderFeature, and the
+// programs compiled from it. Each feature mask is compiled and linked the first time it is
+// asked for and kept after that, so a material gets the smallest program that does what it
+// needs (no lighting maths for an unlit quad) without a hand written copy of the shaders.
+//
+//	defaultShaders.loadShadersFromFile("default_v.glsl", "default_f.glsl");
+//	material->shader = defaultShaders.get(FEATURE_LIT);
+//	material->instancedShader = defaultShaders.get(FEATURE_LIT | FEATURE_INSTANCED);
+//
+// Features a stage never tests in a #if are dropped from its mask, so the stage is only
+// compiled once for masks that differ in those. Every program also goes through the binary
+// cache under its own name (see TTK/ProgramBinaryCache.h).
+class ShaderPermutations
+{
+public:
+	// Reads both files, nothing is compiled yet. Returns false if either can't be read
+	bool loadShadersFromFile(const std::string& vertexFile, const std::string& fragmentFile);
+
+	// The program with these features, linked the first time (waits for the driver)
+	std::shared_ptr<ShaderProgram> get(unsigned int features);
+
+	// Same, but a new program is only added to batch, it's ready once the batch is finished
+	std::shared_ptr<ShaderProgram> get(unsigned int features, ShaderBatch& batch);
+
+	// Programs and compiled shader variants made so far
+	unsigned int getNumPrograms() { return programs.size(); }
+	unsigned int getNumShaders();
+
+	void destroy();
+
+private:
+	struct Stage
+	{
+	public:
+		std::string fileName;
+		std::string source;			// Without any #defines
+		GLenum type;
+		unsigned int usedFeatures;	// Shader::getUsedFeatures of source
+
+		// By feature mask (only usedFeatures bits). Shaders aren't copyable,
+		// and have to stay put while the programs they are attached to link
+		std::unordered_map<unsigned int, std::unique_ptr<Shader>> variants;
+	};
+
+	Stage stages[2];
+
+	// By feature mask
+	std::unordered_map<unsigned int, std::shared_ptr<ShaderProgram>> programs;
+
+	std::shared_ptr<ShaderProgram> makeProgram(unsigned int features);
+	Shader& getVariant(Stage& stage, unsigned int features);
+};
@@ -1,8 +1,90 @@
 #pragma once
 
 #include "Shader.h"
+#include "TTK/ProgramBinaryCache.h"
 #include <glm\matrix.hpp>
 #include "GLEW/glew.h"
+#include <vector>
+#include <map>
+#include <cstring>
+#include <chrono>
+
+// How each C++ type is sent, and which GLSL types it can be sent to
+template <typename T>
+struct UniformType;
+
+template <>
+struct UniformType<int>
+{
+	// Also bools, and samplers which take the texture unit
+	static bool matches(GLenum type)
+	{
+		return type == GL_INT || type == GL_BOOL ||
+			type == GL_SAMPLER_1D || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE ||
+			type == GL_SAMPLER_2D_SHADOW || type == GL_SAMPLER_2D_ARRAY || type == GL_SAMPLER_2D_RECT;
+	}
+	static void upload(int location, const int& value) { glUniform1i(location, value); }
+};
+
+template <>
+struct UniformType<float>
+{
+	static bool matches(GLenum type) { return type == GL_FLOAT; }
+	static void upload(int location, const float& value) { glUniform1f(location, value); }
+};
+
+template <>
+struct UniformType<glm::vec2>
+{
+	static bool matches(GLenum type) { return type == GL_FLOAT_VEC2; }
+	static void upload(int location, const glm::vec2& value) { glUniform2fv(location, 1, &value[0]); }
+};
+
+template <>
+struct UniformType<glm::vec3>
+{
+	static bool matches(GLenum type) { return type == GL_FLOAT_VEC3; }
+	static void upload(int location, const glm::vec3& value) { glUniform3fv(location, 1, &value[0]); }
+};
+
+template <>
+struct UniformType<glm::vec4>
+{
+	static bool matches(GLenum type) { return type == GL_FLOAT_VEC4; }
+	static void upload(int location, const glm::vec4& value) { glUniform4fv(location, 1, &value[0]); }
+};
+
+template <>
+struct UniformType<glm::mat3>
+{
+	static bool matches(GLenum type) { return type == GL_FLOAT_MAT3; }
+	static void upload(int location, const glm::mat3& value) { glUniformMatrix3fv(location, 1, false, &value[0][0]); }
+};
+
+template <>
+struct UniformType<glm::mat4>
+{
+	static bool matches(GLenum type) { return type == GL_FLOAT_MAT4; }
+	static void upload(int location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, false, &value[0][0]); }
+};
+
+// A uniform looked up once with ShaderProgram::getUniform, so sending it needs no
+// name lookup. Only works with the program it came from, and has to be looked up
+// again after that program is linked again
+template <typename T>
+struct UniformHandle
+{
+public:
+	unsigned int program;
+	int index;	// Into the program's uniform table, -1 if the program has no such uniform
+
+	UniformHandle()
+		: program(0),
+		index(-1)
+	{}
+
+	bool isValid() const { return index >= 0; }
+};
 
 class ShaderProgram
 {
@@ -11,8 +93,32 @@ public:
 	~ShaderProgram();
 
 	// Initialization functions
-	void attachShader(Shader shader);
-	int linkProgram();
+	// The shader must still be around when linkProgram (or finishLink) is called
+	void attachShader(Shader& shader);
+
+	// Description:
+	// Loads the program from the binary cache if the shaders haven't changed since
+	// it was saved, otherwise compiles the shaders, links them and saves the binary
+	// (see TTK/ProgramBinaryCache.h). Returns the program handle, or 0 if it failed.
+	// Waits for the driver, link several programs with a ShaderBatch to overlap them.
+	int linkProgram()
+	{
+		submitLink();
+		return finishLink();
+	}
+
+	// Description:
+	// linkProgram in two halves. submitLink loads the cached binary or starts the
+	// compiles and the link without asking for any status, so it doesn't wait on the
+	// driver. finishLink checks the results, printing the logs, and does what needs
+	// the linked program (saving the binary, finding the uniforms). Returns the
+	// program handle, or 0 if it failed. submitLink returns false if there is no handle.
+	bool submitLink();
+	int finishLink();
+
+	// True once the link has been submitted and the driver is done with it, so finishLink
+	// won't wait. Always true without parallel shader compile (see ShaderBatch.h)
+	bool isLinkComplete();
 	
 	// Usage functions
 	void bind();
@@ -32,16 +138,118 @@ public:
 	// Must have to apply the MVP transform
 	void sendUniformMat4(const std::string& uniformName, glm::mat4& mat4);
 
+	// Looks a uniform up in the table made when the program was linked.
+	// Returns an invalid handle if there is no such uniform or it is a different type
+	template <typename T>
+	UniformHandle<T> getUniform(const std::string& uniformName)
+	{
+		UniformHandle<T> uniform;
+		int index = findUniform(uniformName);
+
+		if (index >= 0 && UniformType<T>::matches(uniforms[index].type))
+		{
+			uniform.program = handle;
+			uniform.index = index;
+		}
+
+		return uniform;
+	}
+
+	// Sends value unless it is what the uniform already holds.
+	// The program must be bound, same as the functions above
+	template <typename T>
+	void sendUniform(UniformHandle<T> uniform, const T& value)
+	{
+		if (uniform.program != handle || uniform.index < 0)
+			return;
+
+		UniformInfo& info = uniforms[uniform.index];
+
+		// Uniforms keep their value in the program, so the same value twice needs no upload
+		if (info.hasValue && memcmp(info.value, &value, sizeof(T)) == 0)
+			return;
+
+		memcpy(info.value, &value, sizeof(T));
+		info.hasValue = true;
+		numUploads++;
+
+		UniformType<T>::upload(info.location, value);
+	}
+
+	// Number of uniforms the program has, not counting ones in uniform blocks
+	unsigned int getNumUniforms() { return uniforms.size(); }
+
+	// Name and GLSL type (GL_FLOAT_VEC4 etc.) of uniform index, 0 to getNumUniforms - 1
+	const std::string& getUniformName(unsigned int index) { return uniforms[index].name; }
+	GLenum getUniformType(unsigned int index) { return uniforms[index].type; }
+
+	// Counts the glUniform calls actually made, so a material can tell if anything
+	// else has sent to the program since it last did (see Material.h)
+	unsigned int getNumUploads() { return numUploads; }
+
+	// Times the program has been linked, the uniform table is new each time
+	unsigned int getNumLinks() { return numLinks; }
+
+	unsigned int getHandle() { return handle; }
+
 	void destroy();
 
 private:
 	unsigned int handle;
+	unsigned int numUploads;
+	unsigned int numLinks;
+
+	// Attached since the last link
+	std::vector<Shader*> attachedShaders;
+
+	// Between submitLink and finishLink
+	bool linkPending;
+	bool linkedFromCache;
+	bool saveToCache;
+	std::string cacheFileName;
+	TTK::ProgramCacheKey cacheKey;
+	std::chrono::high_resolution_clock::time_point linkStartTime;
+
+	// One active uniform, found with glGetActiveUniform after linking
+	struct UniformInfo
+	{
+	public:
+		std::string name;		// Without "[0]" for arrays
+		int location;
+		GLenum type;
+		int arraySize;
+		bool hasValue;			// False until something is sent
+		unsigned char value[sizeof(glm::mat4)];	// Last value sent, big enough for any type above
+	};
+
+	std::vector<UniformInfo> uniforms;
+	std::map<std::string, int> uniformIndices;	// Name to index in uniforms
+
+	// Fills uniforms with every active uniform in the linked program
+	void reflectUniforms();
 
-	// All uniforms have a constant location
-	// This function searches for the uniform name (as written in the shader)
-	// and returns that location. If name is not found, it returns 0
-	// Note: This is a pretty slow operation and you do not want to be
-	// calling this every frame. Set up a system, such as a std::map which caches
-	// the location and used the string name as a key
+	// Points each uniform block at its binding from UniformBlocks.h, GLSL 400 can't say it in the shader
+	void bindUniformBlocks();
+
+	// Index in uniforms, or -1 if the program has no uniform called uniformName
+	int findUniform(const std::string& uniformName);
+
+	// Location of the uniform, -1 if there is none. Comes from the table,
+	// glGetUniformLocation is only called once for each uniform when linking
 	int getUniformLocation(const std::string& uniformName);
+
+	// Sends value by name, skipping names the program does not have, like glUniform with -1
+	template <typename T>
+	void sendUniformByName(const std::string& uniformName, const T& value)
+	{
+		int index = findUniform(uniformName);
+
+		if (index < 0 || !UniformType<T>::matches(uniforms[index].type))
+			return;
+
+		UniformHandle<T> uniform;
+		uniform.program = handle;
+		uniform.index = index;
+		sendUniform(uniform, value);
+	}
 };
\ No newline at end of file
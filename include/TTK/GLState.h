@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Remembers the OpenGL state set through it and skips calls that would
+// set it to what it already is. Binding the same shader, VAO or texture
+// draw after draw costs driver time even when nothing changes.
+//
+// Only works if every bind / enable goes through here. Call invalidate()
+// after code that changes the state directly (another library, say).
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLEW/glew.h"
+#include <map>
+
+namespace TTK
+{
+	class GLState
+	{
+	public:
+		// Texture units whose GL_TEXTURE_2D binding is remembered, others always go to GL
+		static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+		GLState();
+
+		// State of the application's GL context
+		static GLState& shared();
+
+		void useProgram(GLuint program);
+		void bindVertexArray(GLuint vao);
+		void bindFramebuffer(GLenum target, GLuint framebuffer);
+		void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+		// Makes unit active (GL_TEXTURE0 + i) and binds texture to it
+		void bindTexture(GLenum unit, GLenum target, GLuint texture);
+
+		// Binds texture to whichever unit is active, for creating textures
+		void bindTexture(GLenum target, GLuint texture);
+		void activeTexture(GLenum unit);
+
+		void enable(GLenum capability);
+		void disable(GLenum capability);
+		void blendFunc(GLenum source, GLenum destination);
+
+		// Description:
+		// Call these before deleting an object. GL may hand its name out again, and
+		// the new object must not look like it is already bound.
+		void forgetProgram(GLuint program);
+		void forgetVertexArray(GLuint vao);
+		void forgetFramebuffer(GLuint framebuffer);
+		void forgetTexture(GLuint texture);
+
+		// Forgets everything, the next call of each kind goes to GL
+		void invalidate();
+
+		// GL calls made and skipped since the last resetCounters
+		unsigned int getNumIssued() { return numIssued; }
+		unsigned int getNumElided() { return numElided; }
+		void resetCounters();
+
+	private:
+		// Value of a binding that has not been set through here
+		static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+		GLuint program;
+		GLuint vertexArray;
+		GLuint drawFramebuffer;
+		GLuint readFramebuffer;
+		GLint viewportRect[4];
+		GLenum activeUnit;
+		GLuint textures[MAX_TEXTURE_UNITS];	// GL_TEXTURE_2D on each unit
+		GLenum blendSource;
+		GLenum blendDestination;
+		std::map<GLenum, bool> capabilities;	// Missing means unknown
+
+		unsigned int numIssued;
+		unsigned int numElided;
+
+		void setCapability(GLenum capability, bool enabled);
+
+		// Counts a call and returns true if it has to go to GL
+		bool changed(bool isDifferent);
+	};
+}
@@ -0,0 +1,151 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Times named parts of a frame on the GPU with timer queries.
+// The CPU only queues the GL calls, so timing them on the CPU says little
+// about where the GPU spends its time. A zone writes a GL_TIMESTAMP
+// before and after its GL calls and the difference is the GPU time.
+//
+// Results are read back MAX_FRAME_LATENCY frames later, by which time
+// the GPU has long finished them, so reading never waits. If a frame's
+// results still aren't in when its queries come round again they are
+// dropped rather than waited for.
+//
+//	GPUProfiler::shared().beginFrame();
+//	{
+//		GPUZone zone("Scene");
+//		drawScene();
+//	}
+//	GPUProfiler::shared().endFrame();
+//
+// Zones can nest. Each keeps its last HISTORY_SIZE times, printReport and
+// writeCSV give the average and percentiles over them.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLEW/glew.h"
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+
+namespace TTK
+{
+	// Times for one zone over the last HISTORY_SIZE frames, in milliseconds
+	struct GPUZoneStats
+	{
+	public:
+		std::string name;
+		unsigned int depth;			// 0 for top level zones, 1 for zones inside those...
+		unsigned int numSamples;
+		double average;
+		double median;
+		double p95;
+		double p99;
+		double max;
+	};
+
+	class GPUProfiler
+	{
+	public:
+		// Frames between a zone's queries being issued and read back
+		static const unsigned int MAX_FRAME_LATENCY = 4;
+
+		// Times kept per zone for the averages and percentiles
+		static const unsigned int HISTORY_SIZE = 240;
+
+		GPUProfiler();
+		~GPUProfiler();
+
+		// Profiler for the application's GL context
+		static GPUProfiler& shared();
+
+		// False if the driver has no timer queries (GL 3.3 or ARB_timer_query), everything is then skipped
+		static bool isSupported();
+
+		// Off by default. Zones cost two queries each, so leave it off when not looking
+		void setEnabled(bool enabled);
+		bool isEnabled() { return enabled; }
+
+		// Description:
+		// Call at the start and end of each frame. beginFrame collects the results
+		// of the frame MAX_FRAME_LATENCY frames ago and reuses its queries.
+		void beginFrame();
+		void endFrame();
+
+		// Zones must be ended in the reverse order they were begun, GPUZone does this for you
+		void beginZone(const char* name);
+		void endZone();
+
+		// Stats for every zone seen, in the order they were first begun
+		std::vector<GPUZoneStats> getStats();
+
+		// Table of getStats, zones indented by depth
+		void printReport(std::ostream& out = std::cout);
+
+		// getStats as comma separated values, with a header line. Returns false if the file can't be written
+		bool writeCSV(const std::string& fileName);
+
+		// Frames whose results were dropped because the GPU hadn't got to them yet
+		unsigned int getNumDroppedFrames() { return numDroppedFrames; }
+
+		void destroy();
+
+	private:
+		struct Zone
+		{
+		public:
+			std::string name;
+			unsigned int depth;
+			std::vector<float> history;	// Ring of HISTORY_SIZE times in ms
+			unsigned int numSamples;	// Times ever added, the next goes in history[numSamples % HISTORY_SIZE]
+		};
+
+		// One zone begun in one frame, and the queries around it
+		struct ZoneQuery
+		{
+		public:
+			unsigned int zone;
+			unsigned int beginQuery;	// Index in the frame's queries
+			unsigned int endQuery;
+		};
+
+		// What one frame in flight issued
+		struct FrameQueries
+		{
+		public:
+			std::vector<GLuint> queries;	// Grown as needed, never shrunk
+			unsigned int numUsed;
+			std::vector<ZoneQuery> zones;
+		};
+
+		bool enabled;
+		bool inFrame;
+		unsigned int frameIndex;
+		unsigned int numDroppedFrames;
+
+		FrameQueries frames[MAX_FRAME_LATENCY];
+
+		std::vector<Zone> zones;
+		std::map<std::string, unsigned int> zoneIndices;	// Zone name to index in zones
+		std::vector<unsigned int> openZones;				// Index in the current frame's zones, innermost last
+
+		unsigned int findZone(const char* name, unsigned int depth);
+		GLuint issueTimestamp(FrameQueries& frame, unsigned int& queryIndex);
+
+		// Reads frame's results into the zones if they are in, returns false if the GPU isn't done
+		bool collect(FrameQueries& frame);
+	};
+
+	// Times the GL calls made while it is in scope
+	class GPUZone
+	{
+	public:
+		GPUZone(const char* name) { GPUProfiler::shared().beginZone(name); }
+		~GPUZone() { GPUProfiler::shared().endZone(); }
+	};
+}
@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Packs many static meshes into a few large vertex and index buffers,
+// so they can all be drawn from one VAO with glMultiDrawElementsIndirect
+// (see MultiDrawRenderer.h) instead of binding each mesh's own VAO.
+//
+// Every mesh is stored as VertexPositionNormalUV with 32-bit indices,
+// whatever format its own vbo uses. Space is handed out front to back
+// and never reused, the arena is meant for meshes that stay loaded.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TTK/MeshBase.h"
+#include <unordered_map>
+#include <vector>
+
+namespace TTK
+{
+	// Where a mesh lives in the arena
+	struct ArenaMesh
+	{
+	public:
+		ArenaMesh()
+		{
+			block = 0;
+			baseVertex = 0;
+			firstIndex = 0;
+			numIndices = 0;
+		}
+
+		unsigned int block;			// Which set of buffers, see GeometryArena::bindBlock
+		unsigned int baseVertex;	// Added to every index
+		unsigned int firstIndex;	// In the block's index buffer
+		unsigned int numIndices;	// Every level of detail included
+		std::vector<MeshLOD> lods;	// Copied from the mesh, relative to firstIndex
+	};
+
+	class GeometryArena
+	{
+	public:
+		// Default block size, 32 MB of vertices and 16 MB of indices.
+		// Meshes bigger than that get a block of their own
+		static const unsigned int DEFAULT_VERTICES_PER_BLOCK = 1024 * 1024;
+		static const unsigned int DEFAULT_INDICES_PER_BLOCK = 4 * 1024 * 1024;
+
+		GeometryArena(unsigned int verticesPerBlock = DEFAULT_VERTICES_PER_BLOCK, unsigned int indicesPerBlock = DEFAULT_INDICES_PER_BLOCK);
+		~GeometryArena();
+
+		// Arena used by default
+		static GeometryArena& shared();
+
+		// Description:
+		// Copies the mesh's vertices, normals, uvs, indices and levels of detail into the arena.
+		// The CPU side arrays must still be there (OBJLoadOptions::keepCPUData), and for an async
+		// load the mesh must have finished loading. Must be called on the GL thread.
+		// Returns false if the mesh has no vertices, or was added already.
+		bool addMesh(const MeshBase* mesh);
+
+		// Forgets the mesh, for before it is destroyed. Its space is not reused
+		void removeMesh(const MeshBase* mesh);
+
+		// Null if the mesh is not in the arena
+		const ArenaMesh* findMesh(const MeshBase* mesh);
+
+		// Range of the block's index buffer holding level of detail level (clamped like MeshBase::drawLOD)
+		void getLODRange(const ArenaMesh& mesh, unsigned int level, unsigned int& firstIndex, unsigned int& numIndices);
+
+		// Binds the VAO of a block, its index buffer holds GL_UNSIGNED_INT indices
+		void bindBlock(unsigned int block);
+		unsigned int getNumBlocks() { return blocks.size(); }
+
+		// GPU memory in use across all blocks
+		size_t getBytesUsed();
+
+		void destroy();
+
+	private:
+		struct Block
+		{
+			unsigned int vaoHandle;
+			unsigned int vboHandle;
+			unsigned int iboHandle;
+			unsigned int vertexCapacity;
+			unsigned int indexCapacity;
+			unsigned int numVertices;
+			unsigned int numIndices;
+		};
+
+		unsigned int verticesPerBlock;
+		unsigned int indicesPerBlock;
+
+		std::vector<Block> blocks;
+		std::unordered_map<const MeshBase*, ArenaMesh> meshes;
+
+		// Finds a block with room for the mesh, making a new one if none has
+		unsigned int allocateBlock(unsigned int numVertices, unsigned int numIndices);
+	};
+}
@@ -17,5 +17,12 @@ namespace TTK
 	{
 		// Loads the specified text file from disk and returns a copy of it in a std::string
 		std::string loadFile(std::string fileName);
+
+		// Gets size (in bytes) and last modification time of a file without opening it
+		// Returns false if the file does not exist
+		bool getFileInfo(std::string fileName, unsigned long long& size, unsigned long long& modifiedTime);
+
+		// Returns the most physical memory (in bytes) this process has used at any point so far
+		size_t getPeakMemoryUsage();
 	}
 }
\ No newline at end of file
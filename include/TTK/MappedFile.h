@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Maps a file read-only into the address space of the process so it can
+// be parsed in place, without copying it through an iostream first.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <string>
+
+namespace TTK
+{
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		// Description:
+		// Maps the specified file into memory.
+		// Returns false if the file could not be opened or mapped.
+		// An empty file opens successfully with size() == 0 and data() == nullptr.
+		bool open(std::string fileName);
+
+		// Unmaps the file, pointers returned by data() are no longer valid
+		void close();
+
+		bool isOpen();
+
+		// Returns pointer to the first byte of the file.
+		// Note: the data is NOT null terminated, always use size()
+		const char* data();
+
+		// Returns size of file in bytes
+		size_t size();
+
+		// Description:
+		// Tells the OS that the pages in [begin, end) are not needed for now.
+		// They drop out of the process's working set but stay in the file cache,
+		// so touching them again later is cheap. The data is still valid to read.
+		void release(const char* begin, const char* end);
+
+	private:
+		// A mapping owns OS handles, copying it would unmap twice
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* dataPtr;
+		size_t fileSize;
+		bool opened;
+
+#ifdef _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#else
+		int fileDescriptor;
+#endif
+	};
+}
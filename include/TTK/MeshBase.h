@@ -13,8 +13,10 @@
 #define MESH_BASE_H
 
 #include <vector>
+#include <string>
 #include "GLM/glm.hpp"
 #include "VertexBufferObject.h"
+#include "TTK/VertexPacking.h"
 
 namespace TTK
 {
@@ -24,9 +26,27 @@ namespace TTK
 		Quads
 	};
 
+	// One level of detail, a range of MeshBase::indices (see TTK/MeshSimplifier.h)
+	struct MeshLOD
+	{
+	public:
+		MeshLOD()
+		{
+			firstIndex = 0;
+			numIndices = 0;
+			error = 0.0f;
+		}
+
+		unsigned int firstIndex;
+		unsigned int numIndices;
+		float error;	// Largest distance the surface moved from the full mesh, as a fraction of the bounding sphere's radius
+	};
+
 	class MeshBase
 	{
 	public:
+		MeshBase();
+
 		// Description:
 		// Very simple draw function which binds all three buffers
 		// Yes, it uses OpenGL 1.0 draw calls... for now.
@@ -35,19 +55,89 @@ namespace TTK
 		// The modern draw function which uses vertex buffer objects!
 		void draw();
 
+		// Description:
+		// True once the vbo is created and fully uploaded. Until then an async load (see
+		// OBJMesh::loadMeshAsync) may still replace the arrays, bounds and levels of detail,
+		// so nothing should read them or draw the mesh every frame before this is true.
+		bool isUploaded() const { return vbo.isCreated() && !vbo.isUploading(); }
+
+		// Draws level of detail level (0 is the full mesh), or the whole mesh if it has no levels.
+		// Does nothing until the mesh is uploaded.
+		void drawLOD(unsigned int level);
+		unsigned int getNumLODs() { return lods.size(); }
+
+		// Draws instanceCount copies of level of detail level, the per instance
+		// attributes must already be set with vbo.setInstanceArray
+		void drawLODInstanced(unsigned int level, unsigned int instanceCount);
+
 		// Description:
 		// Sets all per-vertex colours to the specified colour
 		void setAllColours(glm::vec4 colour);
-		
+
+		// Description:
+		// Recalculates boundsMin / boundsMax from the vertex positions
+		void computeBounds();
+
 		void createVBO();
 
+		// Description:
+		// Describes the arrays below to the vbo without touching OpenGL, so it is safe on any thread.
+		// Arrays are converted to vertexFormat first if it is not float.
+		// createVBO() calls this and then uploads.
+		void prepareVBO();
+
+		// Recalculates positionScale / positionOffset from the bounds and vertexFormat
+		void updatePositionQuantization();
+
+		// Frees the packed copies made by prepareVBO, they are only needed until the upload
+		void freePackedArrays();
+
+		// Frees every CPU side array, for once the mesh is on the GPU
+		void freeCPUData();
+
+		// Description:
+		// Swaps the arrays, bounds, levels of detail, formats and vbo with other's.
+		// Lets a mesh be loaded into a staging copy on a worker thread and handed over
+		// on the GL thread (see MeshUploadQueue). The vbo's pointers move with the arrays.
+		void swapData(MeshBase& other);
+
+		// Description:
+		// Adds one per-vertex attribute array to the vbo.
+		// data may be null, the array is then only allocated (see VertexBufferObject::mapAttributeArray)
+		void addAttribute(AttributeLocations location, std::string name, void* data, unsigned int numVertices, unsigned int numComponents);
+
 		std::vector<glm::vec3> vertices;
 		std::vector<glm::vec3> normals;
 		std::vector<glm::vec2> textureCoordinates;
 		std::vector<glm::vec4> colours;
 
+		// Optional, if not empty every three indices make a triangle
+		// and the arrays above hold one entry per unique vertex
+		std::vector<unsigned int> indices;
+
+		// Empty, or lods[0] is the full mesh and each one after it has fewer triangles.
+		// The levels share the vertex arrays, their triangles are appended to indices.
+		std::vector<MeshLOD> lods;
+
 		PrimitiveType primitiveType;
 
+		// Axis aligned bounding box of the vertex positions, in model space
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+
+		// Format the arrays are uploaded in, set before createVBO
+		VertexFormat vertexFormat;
+
+		// Packed positions are turned back into model space in the vertex shader with
+		// position = packed * positionScale + positionOffset (u_positionScale / u_positionOffset)
+		glm::vec3 positionScale;
+		glm::vec3 positionOffset;
+
+		// Converted copies of the arrays above, for formats other than float
+		std::vector<unsigned char> packedPositions;
+		std::vector<unsigned char> packedNormals;
+		std::vector<unsigned char> packedTexCoords;
+
 		VertexBufferObject vbo;
 	};
 }
@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Binary mesh cache (.ttkmesh)
+// Stores the vertex and index arrays exactly as they were sent to the GPU,
+// so a cached mesh is mapped into memory and uploaded with no parsing.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TTK/MeshBase.h"
+#include <string>
+
+namespace TTK
+{
+	// Identifies the source file (and the settings) a cache file was built from.
+	// A cache file is only used if every field matches.
+	struct MeshCacheKey
+	{
+	public:
+		MeshCacheKey()
+		{
+			sourceSize = 0;
+			sourceModifiedTime = 0;
+			sourceHash = 0;
+			contentFlags = 0;
+		}
+
+		unsigned long long sourceSize;
+		unsigned long long sourceModifiedTime;
+		unsigned long long sourceHash;	// 0 if the source contents were not hashed
+		unsigned int contentFlags;		// Loader settings which change the cached data
+	};
+
+	namespace MeshCache
+	{
+		// Bump this whenever the file layout changes, old cache files are then rebuilt
+		const unsigned int VERSION = 3;
+
+		// Returns the name of the cache file for a source file ("mesh.obj" -> "mesh.obj.ttkmesh")
+		std::string getCacheFileName(std::string sourceFileName);
+
+		// Description:
+		// Fills in the key for a source file.
+		// If hashContents is true the whole file is read and hashed (slower, but survives
+		// tools which do not update modification times).
+		// Returns false if the source file does not exist.
+		bool makeKey(std::string sourceFileName, bool hashContents, unsigned int contentFlags, MeshCacheKey& key);
+
+		// Description:
+		// Writes the mesh's vertex buffer object to a cache file.
+		// Must be called after mesh.prepareVBO() or createVBO(), while the mesh's arrays are still alive.
+		// Does not touch OpenGL.
+		bool write(std::string cacheFileName, const MeshCacheKey& key, MeshBase& mesh);
+
+		// Description:
+		// Maps a cache file and uploads it straight into the mesh's vertex buffer object.
+		// If keepCPUData is true the mesh's vertices/normals/textureCoordinates/indices are filled too
+		// (packed arrays are converted back to float for them).
+		// Returns false if the file is missing, corrupt, from another version or does not match the key.
+		bool load(std::string cacheFileName, const MeshCacheKey& key, MeshBase& mesh, bool keepCPUData);
+
+		// Description:
+		// Like load, but only fills the mesh's vertices/normals/textureCoordinates/indices, lods, bounds and vertexFormat.
+		// Does not touch OpenGL, so it can run on a worker thread.
+		bool read(std::string cacheFileName, const MeshCacheKey& key, MeshBase& mesh);
+	}
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Reorders the triangles and vertices of indexed meshes so the GPU does
+// less work drawing them:
+//  - Vertex cache: triangles that share vertices are drawn close together,
+//    so a shared vertex is transformed once instead of once per triangle
+//    (Tipsify, Sander et al. 2007, "Fast Triangle Reordering for Vertex
+//    Locality and Reduced Overdraw")
+//  - Overdraw: clusters of triangles facing out of the mesh are drawn
+//    first, so they hide the triangles behind them
+//  - Vertex fetch: vertices are stored in the order they are first used
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TTK/MeshBase.h"
+#include <vector>
+
+namespace TTK
+{
+	// Results of running an index buffer through a simulated vertex cache
+	struct VertexCacheStats
+	{
+	public:
+		VertexCacheStats()
+		{
+			acmr = 0.0f;
+			atvr = 0.0f;
+		}
+
+		float acmr;	// Average cache miss ratio, vertices transformed per triangle (0.5 is ideal, 3 is no reuse)
+		float atvr;	// Average transformed vertex ratio, vertices transformed per vertex used (1 is ideal)
+	};
+
+	namespace MeshOptimizer
+	{
+		// Size of the simulated FIFO vertex cache, about what most GPUs have
+		const unsigned int DEFAULT_CACHE_SIZE = 16;
+
+		// Description:
+		// Simulates drawing the triangles through a FIFO vertex cache of cacheSize entries
+		VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int numVertices,
+			unsigned int cacheSize = DEFAULT_CACHE_SIZE);
+
+		// Description:
+		// Reorders the triangles for vertex cache reuse (Tipsify).
+		// If clusters is not null it is filled with the first triangle of every cluster, a run
+		// of triangles that starts with a cold cache, for use by optimizeOverdraw.
+		void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices,
+			unsigned int cacheSize = DEFAULT_CACHE_SIZE, std::vector<unsigned int>* clusters = nullptr);
+
+		// Description:
+		// Sorts the clusters from optimizeVertexCache so the ones facing away from the middle
+		// of the mesh are drawn first. Triangles are only moved as part of their cluster,
+		// so vertex cache reuse is kept.
+		void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+			const std::vector<unsigned int>& clusters);
+
+		// Description:
+		// Renumbers the vertices in the order the indices first use them and reorders every
+		// per-vertex array of the mesh to match. Vertices no triangle uses are dropped.
+		void optimizeVertexFetch(MeshBase& mesh);
+
+		// Description:
+		// Runs all of the above on an indexed mesh (does nothing if mesh.indices is empty).
+		// before and after are filled with the vertex cache stats if not null.
+		void optimize(MeshBase& mesh, bool reduceOverdraw, unsigned int cacheSize = DEFAULT_CACHE_SIZE,
+			VertexCacheStats* before = nullptr, VertexCacheStats* after = nullptr);
+	}
+}
@@ -0,0 +1,46 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Builds lower detail versions of indexed meshes by collapsing edges,
+// cheapest first, using quadric error metrics (Garland and Heckbert 1997,
+// "Surface Simplification Using Quadric Error Metrics").
+//
+// Edges are only ever collapsed onto one of their existing vertices, so
+// every level of detail is just another index array into the same vertex
+// arrays. The levels are appended to MeshBase::indices and described by
+// MeshBase::lods, one vertex buffer serves all of them.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TTK/MeshBase.h"
+#include <vector>
+
+namespace TTK
+{
+	namespace MeshSimplifier
+	{
+		// Default number of triangles each level keeps from the one before it
+		const float DEFAULT_TRIANGLE_RATIO = 0.25f;
+
+		// Description:
+		// Simplifies the triangles in indices, which index into mesh's arrays, until at most
+		// targetNumIndices are left or no edge can be collapsed without folding a triangle over.
+		// Mesh borders and uv / normal seams are kept in place as far as possible.
+		// out receives the new indices. Returns the largest distance, in model space,
+		// the surface moved.
+		float simplify(const MeshBase& mesh, const std::vector<unsigned int>& indices, unsigned int targetNumIndices,
+			std::vector<unsigned int>& out);
+
+		// Description:
+		// Builds up to numLevels levels of detail from the mesh's indices (which become level 0),
+		// each with about triangleRatio times the triangles of the one before.
+		// The new indices are appended to mesh.indices and mesh.lods is filled in.
+		// Stops early once a level would not remove enough triangles to be worth drawing.
+		// Does nothing if the mesh is not indexed.
+		void generateLODs(MeshBase& mesh, unsigned int numLevels, float triangleRatio = DEFAULT_TRIANGLE_RATIO);
+	}
+}
@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Sends meshes that were loaded on worker threads to the GPU a little at
+// a time, so a big mesh does not stall a whole frame.
+// OpenGL can only be used on the thread that owns the context, so the
+// queue is drained once per frame on that thread by calling update().
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TTK/MeshBase.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace TTK
+{
+	enum MeshLoadState
+	{
+		MESH_LOAD_PARSING = 0,	// Being read on a worker thread
+		MESH_LOAD_UPLOADING,	// Waiting for / in the middle of its upload
+		MESH_LOAD_READY,		// Uploaded, the mesh can be drawn
+		MESH_LOAD_FAILED,
+		MESH_LOAD_CANCELLED		// The mesh was destroyed or loaded again, the data was thrown away
+	};
+
+	// Shared by the loader and whoever asked for the mesh
+	class MeshLoadStatus
+	{
+	public:
+		MeshLoadStatus() : state(MESH_LOAD_PARSING) {}
+
+		MeshLoadState getState() { return (MeshLoadState)state.load(); }
+
+		// A cancelled load stays cancelled, whatever the loader gets to afterwards
+		void setState(MeshLoadState newState)
+		{
+			int current = state.load();
+			while (current != MESH_LOAD_CANCELLED && !state.compare_exchange_weak(current, (int)newState)) {}
+		}
+
+		// Called on the GL thread by the mesh the load was for, nothing touches it afterwards
+		void cancel() { state = MESH_LOAD_CANCELLED; }
+		bool isCancelled() { return getState() == MESH_LOAD_CANCELLED; }
+
+		bool isReady() { return getState() == MESH_LOAD_READY; }
+
+		// True once the load has finished, successfully or not
+		bool isDone() { return getState() >= MESH_LOAD_READY; }
+
+	private:
+		std::atomic<int> state;
+	};
+
+	typedef std::shared_ptr<MeshLoadStatus> MeshLoadHandle;
+
+	class MeshUploadQueue
+	{
+	public:
+		MeshUploadQueue();
+
+		// Returns the queue drained by the application every frame
+		static MeshUploadQueue& shared();
+
+		// Most bytes sent to the GPU per call to update(), 0 = no limit
+		void setBytesPerFrame(size_t bytes);
+		size_t getBytesPerFrame();
+
+		// Description:
+		// Queues a mesh for upload, can be called from any thread.
+		// staging holds the loaded arrays, staging->prepareVBO() must already have been called.
+		// On the GL thread, once the upload starts, everything in staging is moved into mesh,
+		// so mesh is only ever touched on that thread. If the handle is cancelled first (mesh
+		// is being destroyed) mesh is left alone and staging is thrown away.
+		// If keepCPUData is false the mesh's arrays are freed once they are on the GPU.
+		void push(std::shared_ptr<MeshBase> staging, MeshBase* mesh, MeshLoadHandle handle, bool keepCPUData);
+
+		// Description:
+		// Uploads queued meshes, in the order they were pushed, until the byte budget is used up.
+		// Must be called on the OpenGL thread, once per frame.
+		void update();
+
+		// Bytes sent by the last call to update()
+		size_t getBytesUploadedLastFrame();
+
+		// Meshes which are queued or in the middle of their upload
+		unsigned int getNumPending();
+
+	private:
+		MeshUploadQueue(const MeshUploadQueue&) = delete;
+		MeshUploadQueue& operator=(const MeshUploadQueue&) = delete;
+
+		struct Upload
+		{
+			std::shared_ptr<MeshBase> staging;	// Null once moved into mesh
+			MeshBase* mesh;
+			MeshLoadHandle handle;
+			bool keepCPUData;
+			bool started;
+
+			// Buffer being uploaded, attribute arrays first then the index array,
+			// and how far into it the upload is (bytes for attributes, indices for the index array)
+			unsigned int buffer;
+			size_t offset;
+		};
+
+		// Pushed from worker threads, moved to uploads at the start of update()
+		std::mutex incomingMutex;
+		std::vector<Upload> incoming;
+
+		// Only touched on the OpenGL thread
+		std::deque<Upload> uploads;
+
+		size_t bytesPerFrame;
+		size_t bytesUploadedLastFrame;
+	};
+}
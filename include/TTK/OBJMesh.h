@@ -1,6 +1,6 @@
 //////////////////////////////////////////////////////////////////////////
 //
-// This header is a part of the Tutorial Tool Kit (TTK) library. 
+// This header is a part of the Tutorial Tool Kit (TTK) library.
 // You may not use this header in your GDW games.
 //
 //
@@ -11,13 +11,82 @@
 #pragma once
 
 #include "TTK/MeshBase.h"
+#include "TTK/MeshUploadQueue.h"
 #include <string>
 
 namespace TTK
 {
+	enum OBJLoaderBackend
+	{
+		// Original loader, reads the file a character at a time through std::ifstream
+		OBJ_LOADER_STREAM = 0,
+
+		// Maps the file into memory and tokenizes it in place,
+		// no iostreams and no allocations per token
+		OBJ_LOADER_MAPPED
+	};
+
+	// Options for OBJMesh::loadMesh
+	struct OBJLoadOptions
+	{
+	public:
+		OBJLoadOptions()
+		{
+			backend = OBJ_LOADER_MAPPED;
+			numThreads = 0;
+			indexed = true;
+			streaming = false;
+			streamToGPU = false;
+			optimize = false;
+			reduceOverdraw = false;
+			numLODs = 0;
+			lodTriangleRatio = 0.25f;
+			interleaved = false;
+			useCache = true;
+			validateCacheHash = false;
+			keepCPUData = true;
+			reportThroughput = true;
+		}
+
+		OBJLoaderBackend backend;
+		unsigned int numThreads;	// Threads used by the mapped backend, 0 = all cores, 1 = single threaded
+		bool indexed;				// Shares vertices between faces with matching v/vt/vn and fills MeshBase::indices
+		bool streaming;				// Mapped backend only, faces become output vertices as they are parsed and are never stored
+		bool streamToGPU;			// Streaming with indexed = false only, triangles are written into mapped GL buffers
+									// and the MeshBase arrays are never filled (the mesh is not cached either)
+		bool optimize;				// Reorders triangles and vertices for the GPU's vertex cache, see TTK/MeshOptimizer.h (implies indexed)
+		bool reduceOverdraw;		// With optimize, also draws outward facing parts of the mesh first
+		unsigned int numLODs;		// Simplified levels of detail to build below the full mesh, see TTK/MeshSimplifier.h (implies indexed)
+		float lodTriangleRatio;		// Triangles each level keeps from the one before it
+		VertexFormat vertexFormat;	// Format of the arrays on the GPU, see TTK/VertexPacking.h (ignored by streamToGPU, which always uses float)
+		bool interleaved;			// Puts every attribute in one GL buffer, one vertex after another (ignored by streamToGPU)
+		bool useCache;				// Loads from / writes to "<filename>.ttkmesh", see TTK/MeshCache.h
+		bool validateCacheHash;		// Also compares a hash of the OBJ file, not just its size and modification time
+		bool keepCPUData;			// If false, the MeshBase arrays are freed once the mesh is on the GPU
+		bool reportThroughput;		// Prints file size, load time and MB/s once loaded
+	};
+
 	class OBJMesh : public MeshBase
 	{
 	public:
-		void loadMesh(std::string filename);
+		// Cancels a load still in flight
+		~OBJMesh();
+
+		void loadMesh(std::string filename, OBJLoadOptions options = OBJLoadOptions());
+
+		// Description:
+		// Loads the mesh on a worker thread and returns straight away.
+		// The file is read into a copy owned by the worker, the finished arrays go through
+		// MeshUploadQueue::shared() and are moved into this mesh on the GL thread, so the mesh
+		// appears once the application has called its update() for enough frames. Until then
+		// the mesh keeps whatever it had and draw() does nothing new.
+		// Destroying the mesh, or loading it again, cancels the load. Do either on the GL thread.
+		// streamToGPU is ignored, the GL buffers can only be mapped on the GL thread.
+		MeshLoadHandle loadMeshAsync(std::string filename, OBJLoadOptions options = OBJLoadOptions());
+
+	private:
+		// The last loadMeshAsync, if it may still be running
+		MeshLoadHandle pendingLoad;
+		void cancelPendingLoad();
 	};
-}
\ No newline at end of file
+}
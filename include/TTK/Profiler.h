@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// CPU profiler for finding out where a frame's time goes.
+// Put TTK_PROFILE_ZONE("name") at the top of a scope and the time spent
+// in it is recorded, on whichever thread runs it. writeChromeTrace saves
+// the last few seconds as Chrome trace_event JSON, which about:tracing
+// and ui.perfetto.dev open as a timeline.
+//
+// Each thread records into its own ring buffer, so a zone is two clock
+// reads and a store, no locks. Without TTK_PROFILE defined (see the
+// project's preprocessor definitions) the macros compile to nothing.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#ifdef TTK_PROFILE
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+namespace TTK
+{
+	class Profiler
+	{
+	public:
+		// Zones kept per thread, older ones are overwritten
+		static const unsigned int EVENTS_PER_THREAD = 1 << 16;
+
+		Profiler();
+
+		// Profiler shared by every thread
+		static Profiler& shared();
+
+		// Nanoseconds since the profiler was created
+		long long now();
+
+		// Records a zone that ran from start to end (from now()) on the calling thread.
+		// name must outlive the profiler, a string literal say
+		void record(const char* name, long long start, long long end);
+
+		// Name shown for the calling thread's row in the trace, "Main", "Worker 2"...
+		void setThreadName(const std::string& name);
+
+		// Description:
+		// Call once per frame on the main thread, records a "Frame" zone since the last call.
+		// If the frame took over the spike threshold the trace is written to
+		// "<spikeFilePrefix><frame number>.json", so the slow frame can be looked at later.
+		// Writing the file is not counted in the next frame.
+		void endFrame();
+
+		// 0 turns spike captures off (the default). After a capture the next cooldownFrames
+		// frames are not captured, so a stretch of slow frames writes one file, not one each.
+		void setSpikeThreshold(double milliseconds, const std::string& filePrefix = "cpu_spike_", unsigned int cooldownFrames = 300);
+
+		// Writes every zone still in the buffers. Returns false if the file can't be written
+		bool writeChromeTrace(const std::string& fileName);
+
+	private:
+		// One finished zone
+		struct Event
+		{
+		public:
+			const char* name;
+			long long start;	// ns
+			long long end;
+		};
+
+		// Only the owning thread writes to it, the trace writer reads
+		struct ThreadBuffer
+		{
+		public:
+			std::vector<Event> events;			// Ring of EVENTS_PER_THREAD
+			std::atomic<unsigned long long> numEvents;	// Ever recorded, bumped after the event is written
+			std::string name;
+			unsigned int id;
+		};
+
+		std::chrono::high_resolution_clock::time_point startTime;
+
+		// Only locked when a thread records for the first time, and while writing a trace
+		std::mutex buffersMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+		long long lastFrameEnd;
+		unsigned int frameNumber;
+		double spikeMilliseconds;
+		std::string spikeFilePrefix;
+		unsigned int spikeCooldownFrames;
+		unsigned int lastSpikeFrame;	// 0 before the first capture
+
+		ThreadBuffer& getThreadBuffer();
+	};
+
+	// Records the time from its construction to the end of its scope
+	class ProfileZone
+	{
+	public:
+		ProfileZone(const char* name)
+			: name(name),
+			start(Profiler::shared().now())
+		{}
+
+		~ProfileZone()
+		{
+			Profiler& profiler = Profiler::shared();
+			profiler.record(name, start, profiler.now());
+		}
+
+	private:
+		const char* name;
+		long long start;
+	};
+}
+
+#define TTK_PROFILE_CONCAT_(a, b) a##b
+#define TTK_PROFILE_CONCAT(a, b) TTK_PROFILE_CONCAT_(a, b)
+
+#define TTK_PROFILE_ZONE(name) TTK::ProfileZone TTK_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define TTK_PROFILE_THREAD_NAME(name) TTK::Profiler::shared().setThreadName(name)
+#define TTK_PROFILE_END_FRAME() TTK::Profiler::shared().endFrame()
+
+#else
+
+#define TTK_PROFILE_ZONE(name)
+#define TTK_PROFILE_THREAD_NAME(name)
+#define TTK_PROFILE_END_FRAME()
+
+#endif
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Binary shader program cache (.ttkprog)
+// Stores linked programs as the driver's own binary (glGetProgramBinary),
+// so the next launch loads them with glProgramBinary instead of compiling
+// and linking the GLSL again.
+//
+// A binary only works with the driver that made it, so the key is a hash
+// of the shader sources plus a hash of the GL vendor, renderer and
+// version strings. Anything different and the program is compiled from
+// source as usual and the cache file replaced.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLEW/glew.h"
+#include <string>
+#include <vector>
+
+namespace TTK
+{
+	struct ProgramCacheKey
+	{
+	public:
+		ProgramCacheKey()
+		{
+			sourceHash = 0;
+			driverHash = 0;
+		}
+
+		unsigned long long sourceHash;	// Every shader's type and source, in the order they were attached
+		unsigned long long driverHash;	// GL_VENDOR, GL_RENDERER and GL_VERSION
+	};
+
+	namespace ProgramBinaryCache
+	{
+		// Bump this whenever the file layout changes, old cache files are then rebuilt
+		const unsigned int VERSION = 1;
+
+		// On by default, turn off to always compile from source
+		void setEnabled(bool enabled);
+		bool isEnabled();
+
+		// True if the driver can save program binaries in at least one format
+		bool isSupported();
+
+		// Returns the name of the cache file for the program made from these shader files
+		// ("default_v.glsl", "default_f.glsl" -> "default_v.glsl.<hash of both names>.ttkprog").
+		// ShaderProgram passes Shader::getVariantName, so each feature set gets its own file
+		std::string getCacheFileName(const std::vector<std::string>& shaderFileNames);
+
+		// Fills in the key for shaders with these types and sources
+		ProgramCacheKey makeKey(const std::vector<GLenum>& shaderTypes, const std::vector<std::string>& shaderSources);
+
+		// Description:
+		// Loads the cached binary into program (from glCreateProgram, nothing attached) and checks it links.
+		// compileMilliseconds is how long compiling and linking from source took when the file was written.
+		// Returns false if the file is missing, stale, from another driver or the driver rejects it.
+		bool load(std::string cacheFileName, const ProgramCacheKey& key, GLuint program, double& compileMilliseconds);
+
+		// Description:
+		// Saves a linked program's binary. The program should have been linked with
+		// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set, or some drivers return nothing.
+		bool write(std::string cacheFileName, const ProgramCacheKey& key, GLuint program, double compileMilliseconds);
+	}
+}
@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Draws lots of textured quads with a handful of draw calls. Sprites are
+// queued between begin() and end(), then written four vertices each
+// into one streamed vertex buffer and drawn with one glDrawElements per
+// texture (or atlas page). QuadMesh can only be drawn one at a time with
+// glBegin(GL_QUADS), which core profiles don't have.
+//
+// The batch does not bind a shader. Bind one that takes vIn_vertex,
+// vIn_uv and vIn_colour and set its u_mvp before end(), see sprite_v.glsl.
+// Like QuadMesh::draw_1_0 the colour is added to the texture, so
+// (0, 0, 0, 1) leaves it as it is.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLM/glm.hpp"
+#include "TTK/Texture2D.h"
+#include "TTK/QuadMesh.h"
+#include "VertexBufferObject.h"
+#include <vector>
+#include <cstddef>
+
+namespace TTK
+{
+	enum SpriteSortMode
+	{
+		SPRITE_SORT_TEXTURE = 0,	// Fewest draw calls, sprites with different textures may be drawn out of order
+		SPRITE_SORT_NONE			// Drawn in the order they were queued, a new draw call each time the texture changes
+	};
+
+	// One corner of a sprite, 24 bytes
+	struct SpriteVertex
+	{
+		glm::vec3 position;
+		glm::vec2 uv;
+		unsigned char colour[4];	// Normalized, 0..255 is 0..1 in the shader
+	};
+
+	class SpriteBatch
+	{
+	public:
+		// Sprites sent to the GPU at once, any more are drawn in several goes.
+		// Small enough for 16-bit indices
+		static const unsigned int DEFAULT_MAX_SPRITES = 16384;
+
+		SpriteBatch(unsigned int maxSprites = DEFAULT_MAX_SPRITES);
+		~SpriteBatch();
+
+		// Starts queueing sprites
+		void begin(SpriteSortMode sortMode = SPRITE_SORT_TEXTURE);
+
+		// Description:
+		// Queues a sprite centred on position, rotated by rotation radians around its centre.
+		// uvRect is the part of the texture to show: (left, bottom, right, top) in uvs,
+		// so atlas frames are just different rects of the same texture.
+		void draw(Texture2D* texture, glm::vec2 position, glm::vec2 size,
+			glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4 colour = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+			float rotation = 0.0f, float depth = 0.0f);
+
+		// Queues a QuadMesh's corners, uvs and colours, moved by model
+		void draw(Texture2D* texture, const QuadMesh& quad, const glm::mat4& model = glm::mat4(1.0f));
+
+		// Sorts the sprites, sends them to the GPU and draws them
+		void end();
+
+		// Draw calls and sprites in the last end()
+		unsigned int getNumDrawCalls() { return numDrawCalls; }
+		unsigned int getNumSprites() { return numSprites; }
+
+		void destroy();
+
+	private:
+		struct Sprite
+		{
+			Texture2D* texture;
+			unsigned int firstVertex;	// Into vertices
+		};
+
+		unsigned int maxSprites;
+		SpriteSortMode sortMode;
+
+		std::vector<Sprite> sprites;
+		std::vector<SpriteVertex> vertices;		// Four per sprite, in the order they were queued
+
+		unsigned int vaoHandle;
+		unsigned int vboHandle;
+		unsigned int iboHandle;
+		GLenum indexType;
+
+		unsigned int numDrawCalls;
+		unsigned int numSprites;
+
+		// Makes the buffers, the index buffer never changes: 0 1 2, 0 2 3 for every quad
+		void createBuffers();
+
+		// Sends sprites [first, first + count) to the GPU and draws them
+		void flush(unsigned int first, unsigned int count);
+
+		void addVertex(glm::vec3 position, glm::vec2 uv, glm::vec4 colour);
+	};
+}
+
+template <>
+struct VertexLayout<TTK::SpriteVertex>
+{
+	static const unsigned int numElements = 3;
+
+	static const VertexElement* getElements()
+	{
+		static const VertexElement elements[numElements] =
+		{
+			{ AttributeLocations::VERTEX,	 GL_FLOAT,		   3, false, offsetof(TTK::SpriteVertex, position) },
+			{ AttributeLocations::TEX_COORD, GL_FLOAT,		   2, false, offsetof(TTK::SpriteVertex, uv) },
+			{ AttributeLocations::COLOUR,	 GL_UNSIGNED_BYTE, 4, true,  offsetof(TTK::SpriteVertex, colour) }
+		};
+
+		return elements;
+	}
+};
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// A fixed size pool of worker threads.
+// Threads are expensive to create, so they are started once and then
+// fed small tasks through a queue.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace TTK
+{
+	class ThreadPool
+	{
+	public:
+		// numThreads = 0 starts one worker per hardware thread
+		ThreadPool(unsigned int numThreads = 0);
+		~ThreadPool();
+
+		// Returns the pool shared by all TTK systems, created on first use
+		static ThreadPool& shared();
+
+		unsigned int numThreads();
+
+		// Adds a task to the queue, it will be run by the next free worker
+		void enqueue(std::function<void()> task);
+
+		// Description:
+		// Calls func(i) for every i in [0, count) and returns once all calls are done.
+		// The calling thread works on the items too, so this is safe to call from
+		// inside a task running on this pool, even if every worker is busy.
+		void parallelFor(unsigned int count, std::function<void(unsigned int)> func);
+
+	private:
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+
+		std::mutex queueMutex;
+		std::condition_variable queueCondition;
+		bool stopping;
+	};
+}
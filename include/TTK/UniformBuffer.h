@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Buffers for GLSL uniform blocks. A block in a buffer is set once and
+// read by every program that declares it, instead of each program
+// getting its own copy with glUniform.
+//
+// UniformBuffer holds one block that changes now and then, like the
+// camera. UniformRing holds many small blocks that change every draw,
+// like each object's matrices. It hands out space from one big buffer
+// front to back and each draw binds its part with glBindBufferRange.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLEW/glew.h"
+#include <cstddef>
+
+namespace TTK
+{
+	class UniformBuffer
+	{
+	public:
+		UniformBuffer();
+		~UniformBuffer();
+
+		// Replaces the block, the old contents are orphaned so draws still reading them don't stall
+		void setData(const void* data, size_t size);
+
+		// Binds the whole buffer to a block binding point, see glUniformBlockBinding
+		void bindBase(GLuint binding);
+
+		void destroy();
+
+	private:
+		unsigned int handle;
+		size_t size;
+	};
+
+	class UniformRing
+	{
+	public:
+		static const size_t DEFAULT_SIZE = 4 * 1024 * 1024;
+
+		UniformRing(size_t size = DEFAULT_SIZE);
+		~UniformRing();
+
+		// Description:
+		// Copies data to the next free part of the ring and returns its offset in the buffer.
+		// Space is never written twice until the ring wraps, and then the buffer is orphaned,
+		// so the copy can skip waiting for the GPU. Several blocks can go in one call if
+		// each starts at a multiple of getAlignment.
+		size_t write(const void* data, size_t size);
+
+		// Binds size bytes from offset to a block binding point
+		void bindRange(GLuint binding, size_t offset, size_t size);
+
+		// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, bound ranges have to start at a multiple of this
+		size_t getAlignment();
+
+		// Rounds size up to a multiple of getAlignment
+		size_t align(size_t size);
+
+		void destroy();
+
+	private:
+		unsigned int handle;
+		size_t size;
+		size_t head;		// Where the next write goes
+		size_t alignment;
+
+		void create();
+	};
+}
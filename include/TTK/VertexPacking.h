@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// This header is a part of the Tutorial Tool Kit (TTK) library.
+// You may not use this header in your GDW games.
+//
+// Smaller vertex formats. Float positions, normals and uvs take 32 bytes
+// per vertex, the packed formats below get that down to 16:
+//
+//  positions  POSITION_HALF     4 x half float, relative to the middle of the bounds
+//             POSITION_SNORM16  4 x normalized short, -1..1 across the bounds
+//  normals    NORMAL_OCT16      2 x normalized short, octahedron encoded
+//             NORMAL_SNORM_10_10_10_2  x, y, z in 10 bits each
+//  uvs        TEX_COORD_HALF    2 x half float
+//
+// Positions are scaled back up in the vertex shader, see
+// MeshBase::positionScale / positionOffset. Octahedron normals are
+// decoded in the vertex shader too.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLM/glm.hpp"
+#include "VertexBufferObject.h"
+#include <vector>
+
+namespace TTK
+{
+	enum PositionFormat
+	{
+		POSITION_FLOAT = 0,
+		POSITION_HALF,
+		POSITION_SNORM16
+	};
+
+	enum NormalFormat
+	{
+		NORMAL_FLOAT = 0,
+		NORMAL_OCT16,
+		NORMAL_SNORM_10_10_10_2
+	};
+
+	enum TexCoordFormat
+	{
+		TEX_COORD_FLOAT = 0,
+		TEX_COORD_HALF
+	};
+
+	// Format of each vertex attribute on the GPU, the CPU side arrays are always float
+	struct VertexFormat
+	{
+	public:
+		VertexFormat()
+		{
+			positions = POSITION_FLOAT;
+			normals = NORMAL_FLOAT;
+			texCoords = TEX_COORD_FLOAT;
+		}
+
+		PositionFormat positions;
+		NormalFormat normals;
+		TexCoordFormat texCoords;
+	};
+
+	namespace VertexPacking
+	{
+		unsigned short floatToHalf(float value);
+		float halfToFloat(unsigned short value);
+
+		// Description:
+		// Gets the transform which takes packed positions back to model space:
+		// position = packed * scale + offset
+		void getPositionQuantization(PositionFormat format, glm::vec3 boundsMin, glm::vec3 boundsMax,
+			glm::vec3& scale, glm::vec3& offset);
+
+		// Description:
+		// Converts an array to the given format.
+		// out receives the packed data and attrib is filled in to describe it (attrib.data points into out).
+		void packPositions(const std::vector<glm::vec3>& positions, PositionFormat format, glm::vec3 scale, glm::vec3 offset,
+			std::vector<unsigned char>& out, AttributeDescriptor& attrib);
+		void packNormals(const std::vector<glm::vec3>& normals, NormalFormat format,
+			std::vector<unsigned char>& out, AttributeDescriptor& attrib);
+		void packTexCoords(const std::vector<glm::vec2>& texCoords, TexCoordFormat format,
+			std::vector<unsigned char>& out, AttributeDescriptor& attrib);
+
+		// Description:
+		// Converts an array described by attrib (float or any of the formats above) back to floats.
+		// Returns false if attrib is not in a format the function knows.
+		bool unpackPositions(const AttributeDescriptor& attrib, glm::vec3 scale, glm::vec3 offset, std::vector<glm::vec3>& out);
+		bool unpackNormals(const AttributeDescriptor& attrib, std::vector<glm::vec3>& out);
+		bool unpackTexCoords(const AttributeDescriptor& attrib, std::vector<glm::vec2>& out);
+
+		// Works out the format of a vbo's position, normal and uv arrays from their descriptors
+		VertexFormat getVertexFormat(const std::vector<AttributeDescriptor>& attributes);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GLM/glm.hpp>
+#include <TTK/Camera.h>
+#include <TTK/MeshBase.h>
+#include <TTK/UniformBuffer.h>
+#include <string>
+#include <vector>
+
+// Binding points of the uniform blocks in the bundled shaders.
+// ShaderProgram::linkProgram points each block it finds at its binding by name
+enum UniformBlockBinding
+{
+	FRAME_DATA_BINDING = 0,
+	OBJECT_DATA_BINDING = 1
+};
+
+// Binding for a block name, or -1 if it is not one of the above
+int getUniformBlockBinding(const std::string& blockName);
+
+// layout(std140) uniform FrameData, the same for every draw with a camera
+struct FrameData
+{
+	glm::mat4 view;
+	glm::mat4 proj;
+	glm::mat4 viewProj;
+	glm::vec4 lightPos;	// Eye space
+};
+
+// layout(std140) uniform ObjectData, what GameObject::draw used to send as loose uniforms
+struct ObjectData
+{
+	glm::mat4 mvp;
+	glm::mat4 mv;
+	glm::vec4 colour;
+
+	// Packed vertex formats (see TTK/VertexPacking.h)
+	glm::vec4 positionScale;
+	glm::vec4 positionOffset;
+	int octNormals;
+	int padding[3];	// std140 rounds the block up to a vec4
+};
+
+// The frame block and the ring the object blocks go in
+class UniformBlocks
+{
+public:
+	static UniformBlocks& shared();
+
+	// Sends the camera and light, once per camera per frame
+	void setFrame(TTK::Camera& camera, const glm::vec4& lightPosEye);
+
+	// Fills in an object block for the camera from the last setFrame
+	ObjectData makeObject(const glm::mat4& model, const glm::vec4& colour, const TTK::MeshBase& mesh);
+
+	// Sends one object's block and binds it, for drawing objects one at a time
+	void setObject(const glm::mat4& model, const glm::vec4& colour, const TTK::MeshBase& mesh);
+
+	// Description:
+	// Sends a whole frame's object blocks at once, returns where they start.
+	// bindObject(first, i) then binds the i'th one for its draw
+	size_t writeObjects(const ObjectData* objects, unsigned int count);
+	void bindObject(size_t first, unsigned int index);
+
+	void destroy();
+
+private:
+	FrameData frame;
+	TTK::UniformBuffer frameBuffer;
+	TTK::UniformRing objectRing;
+
+	// Object blocks spaced out to the ring's alignment
+	std::vector<unsigned char> objectStaging;
+};
@@ -13,7 +13,11 @@ enum AttributeLocations
 	VERTEX = 0,
 	NORMAL,
 	TEX_COORD,
-	COLOUR
+	COLOUR,
+
+	// Per instance attributes, see InstanceBatcher.h
+	INSTANCE_MODEL_MATRIX = 4,	// A mat4 takes four locations, 4 to 7
+	INSTANCE_COLOUR = 8
 };
 
 // This struct describes the array for an attribute
@@ -28,6 +32,7 @@ public:
 		attributeLocation = AttributeLocations::VERTEX;
 		attributeName = "";
 		data = nullptr;
+		normalized = false;
 	}
 
 	AttributeLocations attributeLocation;
@@ -38,8 +43,32 @@ public:
 	unsigned int numElements;			// Number of elements in entire array
 	std::string attributeName;			// Name of the attribute as it appears in the shader
 	void* data;							// Pointer to data
+	bool normalized;					// Integer types only, maps them to 0..1 (unsigned) or -1..1 (signed) in the shader
+};
+
+// One attribute inside an interleaved vertex
+struct VertexElement
+{
+	AttributeLocations attributeLocation;
+	GLenum elementType;					// Type of each component (ie GL_FLOAT)
+	unsigned int numComponents;			// ie a vertex position has 3
+	bool normalized;					// Same as AttributeDescriptor::normalized
+	unsigned int offset;				// Bytes from the start of the vertex
 };
 
+// Describes the layout of a vertex struct at compile time, so an array of them can be
+// handed to VertexBufferObject::setVertexArray as is. Specialize it for each vertex type:
+//
+//   template <> struct VertexLayout<MyVertex>
+//   {
+//       static const unsigned int numElements = 2;
+//       static const VertexElement* getElements();
+//   };
+//
+// See VertexLayout.h for the common ones.
+template <typename Vertex>
+struct VertexLayout;
+
 class VertexBufferObject
 {
 private:
@@ -58,6 +87,32 @@ private:
 	// is interleaved. 
 	std::vector<unsigned int> vboHandles;
 
+	// Optional element array, when set the object is drawn with glDrawElements
+	// and each index picks a vertex from the attribute arrays above
+	unsigned int iboHandle;
+	void* indexData;
+	unsigned int numIndices;
+	GLenum indexDataType;	// Type of indexData, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	GLenum indexType;		// Type of the index buffer on the GPU
+
+	// True between createVBO(false) and finishUpload(), the buffers are not complete yet
+	bool uploading;
+
+	// Number of vertices in the attribute arrays
+	unsigned int numVertices;
+
+	// Interleaved mode, every attribute lives in one buffer (vboHandles[0]) one vertex after another.
+	// Set up either by setVertexArray, or from the attribute arrays by interleaveAttributes.
+	bool interleaved;
+	std::vector<VertexElement> vertexElements;
+	const void* vertexData;
+	unsigned int vertexStride;
+	unsigned int numInterleavedVertices;
+	std::vector<unsigned char> interleavedData;		// Owned copy made by interleaveAttributes
+
+	// Frees interleavedData once it is uploaded
+	void freeInterleavedData();
+
 public:
 	VertexBufferObject();
 	~VertexBufferObject();
@@ -66,12 +121,111 @@ public:
 	// this object will have.
 	int addAttributeArray(AttributeDescriptor attrib);
 
+	// Pass in the indices if the attribute arrays are indexed.
+	// 32-bit indices are narrowed to 16-bit in createVBO if every index fits.
+	// The data must stay valid until createVBO is called.
+	void setIndexArray(unsigned int* indices, unsigned int count);
+	void setIndexArray(unsigned short* indices, unsigned int count);
+
+	// Description:
+	// If set, the attribute arrays are packed into a single buffer, one whole vertex after
+	// another, so fetching a vertex touches one place in memory instead of one per attribute.
+	// Takes effect in interleaveAttributes / createVBO.
+	void setInterleaved(bool interleave) { interleaved = interleave; }
+	bool isInterleaved() { return interleaved; }
+
+	// Description:
+	// Copies the attribute arrays into one interleaved array, if setInterleaved(true) was called.
+	// Does not touch OpenGL, so it can be done on a worker thread ahead of createVBO.
+	void interleaveAttributes();
+
+	// Description:
+	// Uses an array of ready made vertices, laid out as VertexLayout<Vertex> says, instead of
+	// attribute arrays. The array must stay valid until createVBO is called.
+	template <typename Vertex>
+	void setVertexArray(const Vertex* vertices, unsigned int count)
+	{
+		setVertexArray(vertices, count, sizeof(Vertex), VertexLayout<Vertex>::getElements(), VertexLayout<Vertex>::numElements);
+	}
+
+	void setVertexArray(const void* vertices, unsigned int count, unsigned int stride,
+		const VertexElement* elements, unsigned int numElements);
+
 	// Call this once you add all the AttributeDescriptor objects
-	void createVBO();
+	// If uploadData is false the buffers are only allocated, their contents are then sent
+	// a piece at a time with uploadBufferRange / uploadIndexRange and draw() does
+	// nothing until finishUpload() is called. The data must stay valid until then.
+	void createVBO(bool uploadData = true);
+
+	// Vertex buffers made by createVBO: one per attribute array, or a single one if interleaved
+	unsigned int getNumBuffers() { return vboHandles.size(); }
+	size_t getBufferSize(unsigned int buffer);
+
+	// Sends size bytes starting at byte offset of vertex buffer index
+	void uploadBufferRange(unsigned int buffer, size_t offset, size_t size);
+
+	// Sends count indices starting at index first
+	void uploadIndexRange(unsigned int first, unsigned int count);
+
+	void finishUpload();
+	bool isUploading() const { return uploading; }
+
+	// Description:
+	// Forgets the arrays given to addAttributeArray, setIndexArray and setVertexArray. Call it
+	// before freeing them once the buffers are filled, uploadBufferRange and uploadIndexRange
+	// then send nothing instead of reading freed memory.
+	void releaseSourceData();
+
+	// Points attribute array index at another copy of the same data, or forgets it if data is null
+	void setAttributeData(unsigned int index, void* data);
+	bool isCreated() const { return vaoHandle != 0; }
 
 	// Call this when you want to draw the object
 	void draw();
 
+	// Draws count indices starting at index first, for objects with an index array
+	void drawRange(unsigned int first, unsigned int count);
+
+	// Description:
+	// Points per instance attributes at buffer, starting offset bytes in, one stride sized
+	// element per instance (glVertexAttribDivisor 1). The attributes become part of this
+	// object's VAO, so call it again whenever the instances move to another buffer or offset.
+	// Does nothing before createVBO.
+	template <typename Instance>
+	void setInstanceArray(unsigned int buffer, size_t offset)
+	{
+		setInstanceArray(buffer, offset, sizeof(Instance), VertexLayout<Instance>::getElements(), VertexLayout<Instance>::numElements);
+	}
+
+	void setInstanceArray(unsigned int buffer, size_t offset, unsigned int stride,
+		const VertexElement* elements, unsigned int numElements);
+
+	// Same as draw / drawRange, but draws instanceCount copies in one call
+	void drawInstanced(unsigned int instanceCount);
+	void drawRangeInstanced(unsigned int first, unsigned int count, unsigned int instanceCount);
+
+	// Maps attribute array i (in the order they were added) so it can be written directly,
+	// the old contents are discarded. Returns null if it could not be mapped or the vbo is interleaved.
+	// The pointer may be written from any thread, but map/unmap must be called on the GL thread.
+	// unmap returns false if the buffer was not mapped or its contents were lost while mapped
+	// (glUnmapBuffer returned GL_FALSE), it then has to be written again.
+	void* mapAttributeArray(unsigned int index);
+	bool unmapAttributeArray(unsigned int index);
+
+	// Descriptors passed to addAttributeArray.
+	// Note: the data pointers are only valid as long as the arrays they point to
+	const std::vector<AttributeDescriptor>& getAttributeDescriptors() { return attributeDescriptors; }
+
+	// Type the index buffer has (or will have, before createVBO) on the GPU
+	GLenum getIndexType();
+	unsigned int getNumIndices() { return numIndices; }
+
+	// Number of vertices in the attribute arrays added so far
+	unsigned int getNumVertices();
+
+	// Exchanges everything, GL objects and array pointers included, with other
+	void swap(VertexBufferObject& other);
+
 	// Call this when you want to destroy the object
 	// Tip: Might want to put this in the destructor  
 	void destroy();
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "VertexBufferObject.h"
+#include "GLM/glm.hpp"
+#include <cstddef>
+
+// Ready made vertex structs for VertexBufferObject::setVertexArray.
+// Each one is stored as is in a single buffer, the VertexLayout specialization
+// below it tells GL where each attribute is inside the struct.
+
+// Position and uv, for quads and sprites
+struct VertexPositionUV
+{
+	glm::vec3 position;
+	glm::vec2 uv;
+};
+
+template <>
+struct VertexLayout<VertexPositionUV>
+{
+	static const unsigned int numElements = 2;
+
+	static const VertexElement* getElements()
+	{
+		static const VertexElement elements[numElements] =
+		{
+			{ AttributeLocations::VERTEX,	 GL_FLOAT, 3, false, offsetof(VertexPositionUV, position) },
+			{ AttributeLocations::TEX_COORD, GL_FLOAT, 2, false, offsetof(VertexPositionUV, uv) }
+		};
+
+		return elements;
+	}
+};
+
+// Position, normal and uv as floats, 32 bytes
+struct VertexPositionNormalUV
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+};
+
+template <>
+struct VertexLayout<VertexPositionNormalUV>
+{
+	static const unsigned int numElements = 3;
+
+	static const VertexElement* getElements()
+	{
+		static const VertexElement elements[numElements] =
+		{
+			{ AttributeLocations::VERTEX,	 GL_FLOAT, 3, false, offsetof(VertexPositionNormalUV, position) },
+			{ AttributeLocations::NORMAL,	 GL_FLOAT, 3, false, offsetof(VertexPositionNormalUV, normal) },
+			{ AttributeLocations::TEX_COORD, GL_FLOAT, 2, false, offsetof(VertexPositionNormalUV, uv) }
+		};
+
+		return elements;
+	}
+};
+
+// Position, normal and uv packed into 16 bytes, see TTK/VertexPacking.h:
+// POSITION_SNORM16, NORMAL_OCT16 and TEX_COORD_HALF.
+// Positions need MeshBase::positionScale / positionOffset and normals need u_octNormals in the shader.
+struct PackedVertex
+{
+	short position[4];
+	short normal[2];
+	unsigned short uv[2];
+};
+
+template <>
+struct VertexLayout<PackedVertex>
+{
+	static const unsigned int numElements = 3;
+
+	static const VertexElement* getElements()
+	{
+		static const VertexElement elements[numElements] =
+		{
+			{ AttributeLocations::VERTEX,	 GL_SHORT,		4, true,  offsetof(PackedVertex, position) },
+			{ AttributeLocations::NORMAL,	 GL_SHORT,		2, true,  offsetof(PackedVertex, normal) },
+			{ AttributeLocations::TEX_COORD, GL_HALF_FLOAT, 2, false, offsetof(PackedVertex, uv) }
+		};
+
+		return elements;
+	}
+};
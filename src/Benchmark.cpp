@@ -0,0 +1,578 @@
+// Headless benchmark
+//
+// Runs the tutorial's scene update and draw (see Scene.h) for a fixed number of frames
+// with a fixed timestep, without a window, and writes frame time percentiles, draw calls
+// and CPU time as JSON. Meant for machines with no display or GPU, like a CI render farm,
+// where Mesa's llvmpipe does the rendering.
+//
+//	Benchmark [scene file] [--frames N] [--warmup N] [--timestep seconds] [--width W] [--height H]
+//		[--mode each|sorted|instanced|indirect] [--assets path] [--output file.json]
+//
+// The GL context comes from one of (pick with the preprocessor definition):
+//	TTK_BENCHMARK_EGL		EGL with no surface (EGL_MESA_platform_surfaceless), the default off Windows.
+//							GLEW needs to be built with GLEW_EGL for glewInit to work without GLX
+//	TTK_BENCHMARK_OSMESA	Mesa's off screen renderer, links against OSMesa
+//	TTK_BENCHMARK_GLUT		A hidden GLUT window, the default on Windows
+// Either way the frames are drawn into a frame buffer object, never to a window.
+// Build without TTK_PROFILE, the CPU profiler's zones would be timed along with the frames.
+
+// Core Libraries
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(TTK_BENCHMARK_EGL) && !defined(TTK_BENCHMARK_OSMESA) && !defined(TTK_BENCHMARK_GLUT)
+#ifdef _WIN32
+#define TTK_BENCHMARK_GLUT
+#else
+#define TTK_BENCHMARK_EGL
+#endif
+#endif
+
+// 3rd Party Libraries
+#include <GLEW/glew.h>
+#include <TTK/Camera.h>
+#include <TTK/GLState.h>
+#include <TTK/GPUProfiler.h>
+#include <TTK/GeometryArena.h>
+
+#if defined(TTK_BENCHMARK_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(TTK_BENCHMARK_OSMESA)
+#include <GL/osmesa.h>
+#else
+#include <GLUT/glut.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// User Libraries
+#include "ShaderBatch.h"
+#include "ShaderPermutations.h"
+#include "FrameBufferObject.h"
+#include "Scene.h"
+
+// What to run, set from the command line
+struct BenchmarkOptions
+{
+public:
+	BenchmarkOptions()
+	{
+		sceneFile = "../../Assets/Scenes/benchmark.scene";
+		assetPath = "../../Assets/";
+		outputFile = "benchmark.json";
+		numFrames = 600;
+		numWarmupFrames = 30;
+		timestep = 1.0f / 60.0f;
+		width = 1280;
+		height = 720;
+		drawMode = DRAW_INSTANCED;
+	}
+
+	std::string sceneFile;
+	std::string assetPath;		// Holds Shaders/ and Models/
+	std::string outputFile;		// "-" writes to std::cout
+	unsigned int numFrames;
+	unsigned int numWarmupFrames;	// Run before timing starts, so first use costs (shader compiles in the driver...) aren't counted
+	float timestep;				// Seconds passed to Scene::update each frame
+	unsigned int width;
+	unsigned int height;
+	ObjectDrawMode drawMode;
+};
+
+// Average, percentiles (nearest rank) and extremes of a set of samples
+struct SampleStats
+{
+public:
+	double average;
+	double min;
+	double median;
+	double p90;
+	double p95;
+	double p99;
+	double max;
+};
+
+namespace
+{
+#if defined(TTK_BENCHMARK_EGL)
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	EGLContext eglContext = EGL_NO_CONTEXT;
+#elif defined(TTK_BENCHMARK_OSMESA)
+	OSMesaContext osMesaContext = nullptr;
+	std::vector<unsigned char> osMesaBuffer;
+#endif
+
+	std::string escapeJSON(const std::string& str)
+	{
+		std::string escaped;
+
+		for (size_t i = 0; i < str.length(); i++)
+		{
+			if (str[i] == '"' || str[i] == '\\')
+				escaped += '\\';
+
+			escaped += str[i];
+		}
+
+		return escaped;
+	}
+}
+
+// Description:
+// Makes a GL context current without opening a window and initializes GLEW.
+// Returns false (and says why) if there is no context to be had.
+bool createOffscreenContext(int argc, char** argv, unsigned int width, unsigned int height)
+{
+#if defined(TTK_BENCHMARK_EGL)
+	// A display that isn't connected to any window system, Mesa only
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (getPlatformDisplay)
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor) || !eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "Benchmark Error: No EGL display with desktop OpenGL" << std::endl;
+		return false;
+	}
+
+	// 4.5 compatibility for MultiDrawRenderer, otherwise whatever the driver has
+	const EGLint contextAttributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+
+	if (eglContext == EGL_NO_CONTEXT)
+		eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, nullptr);
+
+	// No surface, everything is drawn into frame buffer objects
+	if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		std::cout << "Benchmark Error: Cannot create a surfaceless EGL context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		return false;
+	}
+#elif defined(TTK_BENCHMARK_OSMESA)
+	const int contextAttributes[] =
+	{
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_DEPTH_BITS, 24,
+		OSMESA_PROFILE, OSMESA_COMPAT_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 4,
+		OSMESA_CONTEXT_MINOR_VERSION, 5,
+		0
+	};
+
+	osMesaContext = OSMesaCreateContextAttribs(contextAttributes, nullptr);
+
+	if (!osMesaContext)
+		osMesaContext = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, nullptr);
+
+	// OSMesa always needs a colour buffer to be current, even though nothing is drawn to it
+	osMesaBuffer.resize(width * height * 4);
+
+	if (!osMesaContext || !OSMesaMakeCurrent(osMesaContext, &osMesaBuffer[0], GL_UNSIGNED_BYTE, width, height))
+	{
+		std::cout << "Benchmark Error: Cannot create an OSMesa context" << std::endl;
+		return false;
+	}
+#else
+	glutInit(&argc, argv);
+	glutInitWindowSize(width, height);
+	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
+	glutCreateWindow("Benchmark");
+	glutHideWindow();
+#endif
+
+	// Core profile contexts need this for GLEW to load anything
+	glewExperimental = GL_TRUE;
+
+	GLenum err = glewInit();
+	if (err != GLEW_OK)
+	{
+		std::cout << "Benchmark Error: GLEW failed to init: " << glewGetErrorString(err) << std::endl;
+		return false;
+	}
+
+	// GLEW can leave an error behind from probing extensions
+	glGetError();
+
+	return true;
+}
+
+void destroyOffscreenContext()
+{
+#if defined(TTK_BENCHMARK_EGL)
+	if (eglDisplay != EGL_NO_DISPLAY)
+	{
+		eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+		if (eglContext != EGL_NO_CONTEXT)
+			eglDestroyContext(eglDisplay, eglContext);
+
+		eglTerminate(eglDisplay);
+	}
+#elif defined(TTK_BENCHMARK_OSMESA)
+	if (osMesaContext)
+		OSMesaDestroyContext(osMesaContext);
+#endif
+}
+
+// CPU time used by every thread in the process so far, in seconds. With llvmpipe
+// this includes the rendering, which runs on the driver's own threads
+double getProcessCPUSeconds()
+{
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+
+	// 100 ns ticks
+	ULARGE_INTEGER kernel, user;
+	kernel.LowPart = kernelTime.dwLowDateTime;
+	kernel.HighPart = kernelTime.dwHighDateTime;
+	user.LowPart = userTime.dwLowDateTime;
+	user.HighPart = userTime.dwHighDateTime;
+
+	return (kernel.QuadPart + user.QuadPart) / 10000000.0;
+#else
+	return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+SampleStats getSampleStats(std::vector<double> samples)
+{
+	SampleStats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	if (samples.size() == 0)
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0.0;
+
+	for (unsigned int i = 0; i < samples.size(); i++)
+		total += samples[i];
+
+	// Nearest rank, as in TTK::GPUProfiler
+	unsigned int n = samples.size();
+	stats.average = total / n;
+	stats.min = samples[0];
+	stats.median = samples[(n - 1) / 2];
+	stats.p90 = samples[std::min(n - 1, (unsigned int)(n * 0.90))];
+	stats.p95 = samples[std::min(n - 1, (unsigned int)(n * 0.95))];
+	stats.p99 = samples[std::min(n - 1, (unsigned int)(n * 0.99))];
+	stats.max = samples[n - 1];
+
+	return stats;
+}
+
+void writeSampleStats(std::ostream& out, const char* name, const SampleStats& stats)
+{
+	out << "\t\"" << name << "\": { \"average\": " << stats.average << ", \"min\": " << stats.min
+		<< ", \"median\": " << stats.median << ", \"p90\": " << stats.p90 << ", \"p95\": " << stats.p95
+		<< ", \"p99\": " << stats.p99 << ", \"max\": " << stats.max << " }";
+}
+
+// Returns false (and prints the usage) if an argument is not understood
+bool parseArguments(int argc, char** argv, BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg[0] != '-' || arg == "-")
+		{
+			options.sceneFile = arg;
+			continue;
+		}
+
+		if (!hasValue)
+		{
+			std::cout << "Benchmark Error: " << arg << " needs a value" << std::endl;
+			return false;
+		}
+
+		std::string value = argv[++i];
+
+		if (arg == "--frames")
+			options.numFrames = std::max(1, atoi(value.c_str()));
+		else if (arg == "--warmup")
+			options.numWarmupFrames = std::max(0, atoi(value.c_str()));
+		else if (arg == "--timestep")
+			options.timestep = (float)atof(value.c_str());
+		else if (arg == "--width")
+			options.width = std::max(1, atoi(value.c_str()));
+		else if (arg == "--height")
+			options.height = std::max(1, atoi(value.c_str()));
+		else if (arg == "--assets")
+			options.assetPath = value;
+		else if (arg == "--output")
+			options.outputFile = value;
+		else if (arg == "--mode")
+		{
+			int mode = 0;
+
+			while (mode < NUM_DRAW_MODES && value != Scene::getDrawModeName((ObjectDrawMode)mode))
+				mode++;
+
+			if (mode == NUM_DRAW_MODES)
+			{
+				std::cout << "Benchmark Error: Unknown draw mode: " << value << std::endl;
+				return false;
+			}
+
+			options.drawMode = (ObjectDrawMode)mode;
+		}
+		else
+		{
+			std::cout << "Benchmark Error: Unknown argument: " << arg << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Description:
+// Loads the scene, runs it and writes the results. Every GL object it makes is gone
+// by the time it returns, so the context can be destroyed after.
+// Returns the process exit code, 0 if the frames ran without errors.
+int runBenchmark(const BenchmarkOptions& options)
+{
+	std::string renderer = (const char*)glGetString(GL_RENDERER);
+	std::string version = (const char*)glGetString(GL_VERSION);
+	std::cout << "OpenGL version: " << version << ", renderer: " << renderer << std::endl;
+
+	if (options.drawMode == DRAW_MULTI_INDIRECT && !MultiDrawRenderer::isSupported())
+	{
+		std::cout << "Benchmark Error: indirect needs GL 4.3, the driver has " << version << std::endl;
+		return 1;
+	}
+
+	TTK::GLState::shared().enable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+
+	// The same shaders main.cpp gives its default material
+	std::string shaderPath = options.assetPath + "Shaders/";
+
+	ShaderPermutations defaultShaders;
+	defaultShaders.loadShadersFromFile(shaderPath + "default_v.glsl", shaderPath + "default_f.glsl");
+
+	Shader v_defaultIndirect, f_defaultLit;
+
+	if (MultiDrawRenderer::isSupported())
+	{
+		v_defaultIndirect.loadShaderFromFile(shaderPath + "default_indirect_v.glsl", GL_VERTEX_SHADER);
+		f_defaultLit.loadShaderFromFile(shaderPath + "default_f.glsl", GL_FRAGMENT_SHADER, FEATURE_LIT);
+	}
+
+	ShaderBatch batch;
+
+	std::shared_ptr<Material> defaultMaterial = std::make_shared<Material>();
+	defaultMaterial->shader = defaultShaders.get(FEATURE_LIT, batch);
+	defaultMaterial->instancedShader = defaultShaders.get(FEATURE_LIT | FEATURE_INSTANCED, batch);
+
+	if (MultiDrawRenderer::isSupported())
+	{
+		defaultMaterial->indirectShader = std::make_shared<ShaderProgram>();
+		defaultMaterial->indirectShader->attachShader(v_defaultIndirect);
+		defaultMaterial->indirectShader->attachShader(f_defaultLit);
+		batch.add(defaultMaterial->indirectShader);
+	}
+
+	batch.submit();
+	unsigned int numShaderErrors = batch.finish();
+
+	// Loaded on this thread so every mesh is on the GPU before the first frame
+	TTK::OBJLoadOptions loadOptions;
+	loadOptions.interleaved = true;
+	loadOptions.numLODs = 3;
+	loadOptions.reportThroughput = false;
+
+	Scene scene;
+	scene.drawMode = options.drawMode;
+
+	bool sceneLoaded = scene.loadFromFile(options.sceneFile, options.assetPath + "Models/", defaultMaterial, loadOptions, false);
+
+	if (numShaderErrors > 0 || !sceneLoaded)
+	{
+		std::cout << "Benchmark Error: Could not load " << options.sceneFile << ", not running" << std::endl;
+		scene.destroy();
+		return 1;
+	}
+
+	FrameBufferObject fbo;
+	fbo.createFrameBuffer(options.width, options.height, 1, true);
+
+	TTK::Camera camera;
+	camera.winWidth = (float)options.width;
+	camera.winHeight = (float)options.height;
+
+	TTK::GPUProfiler::shared().setEnabled(true);
+
+	std::vector<double> frameTimes, submitTimes, drawCalls;
+	unsigned long long totalDrawCalls = 0;
+	frameTimes.reserve(options.numFrames);
+	submitTimes.reserve(options.numFrames);
+	drawCalls.reserve(options.numFrames);
+
+	double cpuStart = 0.0;
+	std::chrono::high_resolution_clock::time_point wallStart;
+
+	for (unsigned int frame = 0; frame < options.numWarmupFrames + options.numFrames; frame++)
+	{
+		if (frame == options.numWarmupFrames)
+		{
+			cpuStart = getProcessCPUSeconds();
+			wallStart = std::chrono::high_resolution_clock::now();
+		}
+
+		std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
+
+		TTK::GPUProfiler::shared().beginFrame();
+
+		camera.update();
+		scene.update(options.timestep);
+
+		{
+			TTK::GPUZone zone("Scene");
+
+			fbo.bindFrameBufferForDrawing();
+			fbo.clearFrameBuffer(glm::vec4(0.8f, 0.8f, 0.8f, 0.0f));
+
+			scene.draw(camera);
+		}
+
+		TTK::GPUProfiler::shared().endFrame();
+
+		std::chrono::high_resolution_clock::time_point submitEnd = std::chrono::high_resolution_clock::now();
+
+		// There is no swap to wait on, so wait for the GPU here or the frames would only time queuing the GL calls
+		glFinish();
+
+		std::chrono::high_resolution_clock::time_point frameEnd = std::chrono::high_resolution_clock::now();
+
+		if (frame >= options.numWarmupFrames)
+		{
+			frameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+			submitTimes.push_back(std::chrono::duration<double, std::milli>(submitEnd - frameStart).count());
+			drawCalls.push_back(scene.getNumDrawCalls());
+			totalDrawCalls += scene.getNumDrawCalls();
+		}
+	}
+
+	double cpuSeconds = getProcessCPUSeconds() - cpuStart;
+	double wallSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - wallStart).count();
+
+	GLenum glError = glGetError();
+
+	// Write the results
+	std::ofstream file;
+
+	if (options.outputFile != "-")
+	{
+		file.open(options.outputFile);
+
+		if (!file.is_open())
+			std::cout << "Benchmark Error: Cannot write file: " << options.outputFile << std::endl;
+	}
+
+	std::ostream& out = file.is_open() ? file : std::cout;
+
+	SampleStats frameStats = getSampleStats(frameTimes);
+	SampleStats drawCallStats = getSampleStats(drawCalls);
+
+	out << "{" << std::endl;
+	out << "\t\"scene\": \"" << escapeJSON(options.sceneFile) << "\"," << std::endl;
+	out << "\t\"renderer\": \"" << escapeJSON(renderer) << "\"," << std::endl;
+	out << "\t\"version\": \"" << escapeJSON(version) << "\"," << std::endl;
+	out << "\t\"drawMode\": \"" << Scene::getDrawModeName(options.drawMode) << "\"," << std::endl;
+	out << "\t\"width\": " << options.width << ", \"height\": " << options.height << "," << std::endl;
+	out << "\t\"frames\": " << options.numFrames << ", \"warmupFrames\": " << options.numWarmupFrames
+		<< ", \"timestep\": " << options.timestep << "," << std::endl;
+	out << "\t\"objects\": " << scene.gameobjects.size() << "," << std::endl;
+	out << "\t\"glError\": " << glError << "," << std::endl;
+
+	// Milliseconds, frame is update + draw + glFinish, submit is update + draw
+	writeSampleStats(out, "frameTimeMs", frameStats);
+	out << "," << std::endl;
+	writeSampleStats(out, "submitTimeMs", getSampleStats(submitTimes));
+	out << "," << std::endl;
+	writeSampleStats(out, "drawCalls", drawCallStats);
+	out << "," << std::endl;
+	out << "\t\"totalDrawCalls\": " << totalDrawCalls << "," << std::endl;
+
+	// Every thread in the process, the driver's included
+	out << "\t\"cpuTimeMs\": { \"total\": " << cpuSeconds * 1000.0 << ", \"perFrame\": " << cpuSeconds * 1000.0 / options.numFrames
+		<< ", \"utilization\": " << (wallSeconds > 0.0 ? cpuSeconds / wallSeconds : 0.0) << " }," << std::endl;
+	out << "\t\"wallTimeMs\": " << wallSeconds * 1000.0 << "," << std::endl;
+
+	// Timer query results for the frames the profiler kept, empty if the driver has no timer queries
+	std::vector<TTK::GPUZoneStats> gpuStats = TTK::GPUProfiler::shared().getStats();
+
+	out << "\t\"gpuTimeMs\": [";
+
+	for (unsigned int i = 0; i < gpuStats.size(); i++)
+	{
+		out << (i > 0 ? ", " : " ") << "{ \"zone\": \"" << escapeJSON(gpuStats[i].name) << "\", \"samples\": " << gpuStats[i].numSamples
+			<< ", \"average\": " << gpuStats[i].average << ", \"median\": " << gpuStats[i].median
+			<< ", \"p95\": " << gpuStats[i].p95 << ", \"p99\": " << gpuStats[i].p99 << ", \"max\": " << gpuStats[i].max << " }";
+	}
+
+	out << (gpuStats.size() > 0 ? " " : "") << "]" << std::endl;
+	out << "}" << std::endl;
+
+	std::cout << options.numFrames << " frames of " << options.sceneFile << " (" << Scene::getDrawModeName(options.drawMode) << "): "
+		<< frameStats.median << " ms median, " << frameStats.p99 << " ms p99, " << drawCallStats.average << " draw calls" << std::endl;
+
+	TTK::GPUProfiler::shared().destroy();
+	fbo.destroy();
+	scene.destroy();
+
+	// The context goes before static destructors run
+	TTK::GeometryArena::shared().destroy();
+
+	return glError == GL_NO_ERROR ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+
+	if (!parseArguments(argc, argv, options))
+	{
+		std::cout << "Usage: Benchmark [scene file] [--frames N] [--warmup N] [--timestep seconds] [--width W] [--height H]" << std::endl
+			<< "\t[--mode each|sorted|instanced|indirect] [--assets path] [--output file.json]" << std::endl;
+		return 1;
+	}
+
+	if (!createOffscreenContext(argc, argv, options.width, options.height))
+		return 1;
+
+	int result = runBenchmark(options);
+
+	destroyOffscreenContext();
+
+	return result;
+}
@@ -1,4 +1,5 @@
 #include "FrameBufferObject.h"
+#include "TTK/GLState.h"
 #include <iostream>
  
 FrameBufferObject::FrameBufferObject()
@@ -32,14 +33,14 @@ void FrameBufferObject::createFrameBuffer(unsigned int fboWidth, unsigned int fb
 
 	glGenFramebuffers(1, &handle); // create the frame buffer object
 
-	glBindFramebuffer(GL_FRAMEBUFFER, handle);
+	TTK::GLState::shared().bindFramebuffer(GL_FRAMEBUFFER, handle);
 
 	glGenTextures(numColourTex, colourTexHandles);
 
 	for (int i = 0; i < numColourTex; i++)
 	{
 		// need to bind before we allocate memory
-		glBindTexture(GL_TEXTURE_2D, colourTexHandles[i]);
+		TTK::GLState::shared().bindTexture(GL_TEXTURE_2D, colourTexHandles[i]);
 
 		// allocate memory but don't pass to the CPU
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
@@ -56,7 +57,7 @@ void FrameBufferObject::createFrameBuffer(unsigned int fboWidth, unsigned int fb
 	if (useDepth) {
 		glGenTextures(1, &depthTexHandle);
 
-		glBindTexture(GL_TEXTURE_2D, depthTexHandle);
+		TTK::GLState::shared().bindTexture(GL_TEXTURE_2D, depthTexHandle);
 
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
 
@@ -73,20 +74,20 @@ void FrameBufferObject::createFrameBuffer(unsigned int fboWidth, unsigned int fb
 		std::cout << "Error Creating FBO" << fboStatus << std::endl;
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0); // unbind - use the backbuffer
+	TTK::GLState::shared().bindFramebuffer(GL_FRAMEBUFFER, 0); // unbind - use the backbuffer
 }
 
 void FrameBufferObject::bindFrameBufferForDrawing()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, handle);
-	glViewport(0, 0, width, height);
+	TTK::GLState::shared().bindFramebuffer(GL_FRAMEBUFFER, handle);
+	TTK::GLState::shared().viewport(0, 0, width, height);
 
 }
 
 void FrameBufferObject::unbindFrameBuffer(int backBufferWidth, int backBufferHeight)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, backBufferWidth, backBufferHeight);
+	TTK::GLState::shared().bindFramebuffer(GL_FRAMEBUFFER, 0);
+	TTK::GLState::shared().viewport(0, 0, backBufferWidth, backBufferHeight);
 
 }
 
@@ -98,31 +99,34 @@ void FrameBufferObject::clearFrameBuffer(glm::vec4 clearColour)
 
 void FrameBufferObject::bindTextureForSampling(int textureIndex, GLenum textureUnit)
 {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, colourTexHandles[textureIndex]);
+	TTK::GLState::shared().bindTexture(textureUnit, GL_TEXTURE_2D, colourTexHandles[textureIndex]);
 }
 
 void FrameBufferObject::unbindTexture(GLenum textureUnit)
 {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	TTK::GLState::shared().bindTexture(textureUnit, GL_TEXTURE_2D, 0);
 }
 
 void FrameBufferObject::destroy()
 {
 	// free up all texures allocated 
 	if (numColourTex > 0) {
+		for (int i = 0; i < numColourTex; i++)
+			TTK::GLState::shared().forgetTexture(colourTexHandles[i]);
+
 		glDeleteTextures(numColourTex, colourTexHandles);
 		memset(colourTexHandles, 0, MAX_BUFFERS);
 		numColourTex = 0;
 	}
 
 	if (depthTexHandle > 0) {
+		TTK::GLState::shared().forgetTexture(depthTexHandle);
 		glDeleteTextures(1, &depthTexHandle);
 		depthTexHandle = 0;
 	}
 
 	if (handle) {
+		TTK::GLState::shared().forgetFramebuffer(handle);
 		glDeleteFramebuffers(1, &handle);
 	}
 }
@@ -1,4 +1,7 @@
 #include "GameObject.h"
+#include "ObjectRenderer.h"
+#include "UniformBlocks.h"
+#include "TTK/Profiler.h"
 #include <iostream>
 
 GameObject::GameObject(glm::vec3 position, std::shared_ptr<TTK::OBJMesh> _mesh, std::shared_ptr<Material> _material)
@@ -8,7 +11,10 @@ GameObject::GameObject(glm::vec3 position, std::shared_ptr<TTK::OBJMesh> _mesh,
 	mesh(_mesh),
 	material(_material),
 	m_pParent(nullptr),
-	m_pRotX(0.0f), m_pRotY(0.0f), m_pRotZ(0.0f)
+	m_pRotX(0.0f), m_pRotY(0.0f), m_pRotZ(0.0f),
+	m_pLOD(0),
+	lodPixelError(1.0f),
+	lodHysteresis(0.25f)
 {
 }
 
@@ -46,6 +52,8 @@ glm::mat4 GameObject::getLocalToWorldMatrix()
 
 void GameObject::update(float dt)
 {
+	TTK_PROFILE_ZONE("GameObject::update");
+
 	// Create 4x4 transformation matrix
 
 	// Create rotation matrix
@@ -80,21 +88,36 @@ void GameObject::update(float dt)
 
 void GameObject::draw(TTK::Camera &camera)
 {
-	material->shader->bind();
+	TTK_PROFILE_ZONE("GameObject::draw");
+
+	// A mesh still loading pops in once it is uploaded, the children are drawn either way
+	if (mesh->isUploaded())
+	{
+		material->shader->bind();
+		material->sendUniforms();
 
-	material->mat4Uniforms["u_mvp"] = camera.viewProjMatrix * m_pLocalToWorldMatrix;
-	material->mat4Uniforms["u_mv"] = camera.viewMatrix * m_pLocalToWorldMatrix;
-	material->vec4Uniforms["u_colour"] = colour;
-	material->sendUniforms();
+		// Matrices and colour go in the object uniform block, the camera is already in the frame block
+		UniformBlocks::shared().setObject(m_pLocalToWorldMatrix, colour, *mesh);
 
-	//mesh->draw_1_0();
-	mesh->draw();
+		//mesh->draw_1_0();
+		mesh->drawLOD(selectLOD(camera));
+	}
 
 	// Draw children
 	for (int i = 0; i < m_pChildren.size(); ++i)
 		m_pChildren[i]->draw(camera);
 }
 
+void GameObject::submit(ObjectRenderer &renderer, TTK::Camera &camera)
+{
+	if (mesh->isUploaded())
+		renderer.add(mesh, material, selectLOD(camera), m_pLocalToWorldMatrix, colour);
+
+	// Submit children
+	for (int i = 0; i < m_pChildren.size(); ++i)
+		m_pChildren[i]->submit(renderer, camera);
+}
+
 void GameObject::setParent(GameObject* newParent)
 {
 	m_pParent = newParent;
@@ -145,3 +168,43 @@ bool GameObject::isRoot()
 		return true;
 }
 
+unsigned int GameObject::selectLOD(TTK::Camera &camera)
+{
+	// The levels and bounds of a mesh still loading can change under us
+	if (!mesh->isUploaded())
+		return 0;
+
+	unsigned int numLODs = mesh->getNumLODs();
+
+	if (numLODs < 2)
+		return 0;
+
+	// Bounding sphere of the mesh in world space
+	glm::vec3 centre = glm::vec3(m_pLocalToWorldMatrix * glm::vec4((mesh->boundsMin + mesh->boundsMax) * 0.5f, 1.0f));
+	float scale = glm::max(glm::length(glm::vec3(m_pLocalToWorldMatrix[0])),
+		glm::max(glm::length(glm::vec3(m_pLocalToWorldMatrix[1])), glm::length(glm::vec3(m_pLocalToWorldMatrix[2]))));
+	float radius = glm::length(mesh->boundsMax - mesh->boundsMin) * 0.5f * scale;
+
+	float depth = -(camera.viewMatrix * glm::vec4(centre, 1.0f)).z;
+
+	// Camera inside the sphere, anything but full detail would show
+	if (depth <= radius)
+	{
+		m_pLOD = 0;
+		return m_pLOD;
+	}
+
+	// Height of the sphere's radius on screen, in pixels
+	float pixelsPerRadius = radius * camera.projMatrix[1][1] / depth * camera.winHeight * 0.5f;
+
+	m_pLOD = glm::min(m_pLOD, numLODs - 1);
+
+	// Finer while the current level's error shows, coarser only once the next one is well under
+	while (m_pLOD > 0 && mesh->lods[m_pLOD].error * pixelsPerRadius > lodPixelError)
+		m_pLOD--;
+
+	while (m_pLOD + 1 < numLODs && mesh->lods[m_pLOD + 1].error * pixelsPerRadius < lodPixelError * (1.0f - lodHysteresis))
+		m_pLOD++;
+
+	return m_pLOD;
+}
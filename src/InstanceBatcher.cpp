@@ -0,0 +1,157 @@
+#include "InstanceBatcher.h"
+#include "UniformBlocks.h"
+
+InstanceBatcher::InstanceBatcher()
+{
+	instanceBuffer = 0;
+	instanceBufferSize = 0;
+	numDrawCalls = 0;
+	numInstances = 0;
+}
+
+InstanceBatcher::~InstanceBatcher()
+{
+	destroy();
+}
+
+void InstanceBatcher::add(std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material, unsigned int lod,
+	const glm::mat4& model, const glm::vec4& colour)
+{
+	// Nothing to draw until it is uploaded, and its packing may still change
+	if (!mesh->isUploaded())
+		return;
+
+	Batch& batch = batches[BatchKey(mesh.get(), material.get(), lod)];
+
+	if (!batch.mesh)
+	{
+		batch.mesh = mesh;
+		batch.material = material;
+		batch.lod = lod;
+	}
+
+	ObjectInstance instance;
+	instance.model = model;
+	instance.colour = colour;
+	batch.instances.push_back(instance);
+}
+
+void InstanceBatcher::draw(TTK::Camera&)
+{
+	numDrawCalls = 0;
+	numInstances = 0;
+
+	// Lay every instanced batch out in one array so it can all go to the GPU at once
+	instanceData.clear();
+
+	for (auto itr = batches.begin(); itr != batches.end(); ++itr)
+	{
+		Batch& batch = itr->second;
+		batch.firstInstance = instanceData.size();
+
+		if (batch.material->instancedShader)
+			instanceData.insert(instanceData.end(), batch.instances.begin(), batch.instances.end());
+	}
+
+	uploadInstances();
+
+	for (auto itr = batches.begin(); itr != batches.end(); ++itr)
+	{
+		Batch& batch = itr->second;
+		Material& material = *batch.material;
+		TTK::MeshBase& mesh = *batch.mesh;
+
+		if (batch.instances.empty())
+			continue;
+
+		numInstances += batch.instances.size();
+
+		if (material.instancedShader)
+		{
+			material.instancedShader->bind();
+
+			setMeshUniforms(material, mesh);
+			material.sendUniforms(*material.instancedShader);
+
+			mesh.vbo.setInstanceArray<ObjectInstance>(instanceBuffer, batch.firstInstance * sizeof(ObjectInstance));
+			mesh.drawLODInstanced(batch.lod, batch.instances.size());
+			numDrawCalls++;
+		}
+		else
+		{
+			// No instanced shader, same as GameObject::draw
+			material.shader->bind();
+			material.sendUniforms();
+
+			for (unsigned int i = 0; i < batch.instances.size(); i++)
+			{
+				ObjectInstance& instance = batch.instances[i];
+				UniformBlocks::shared().setObject(instance.model, instance.colour, mesh);
+
+				mesh.drawLOD(batch.lod);
+				numDrawCalls++;
+			}
+		}
+	}
+
+	// Keep the batches that were used for next frame, let go of the rest
+	for (auto itr = batches.begin(); itr != batches.end();)
+	{
+		if (itr->second.instances.empty())
+		{
+			itr = batches.erase(itr);
+		}
+		else
+		{
+			itr->second.instances.clear();
+			++itr;
+		}
+	}
+}
+
+void InstanceBatcher::uploadInstances()
+{
+	if (instanceData.empty())
+		return;
+
+	size_t size = instanceData.size() * sizeof(ObjectInstance);
+
+	if (!instanceBuffer)
+		glGenBuffers(1, &instanceBuffer);
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	// Grow by half again so a slowly growing scene doesn't reallocate every frame
+	if (size > instanceBufferSize)
+		instanceBufferSize = size + size / 2;
+
+	// Orphan last frame's storage rather than waiting for the GPU to finish reading it
+	glBufferData(GL_ARRAY_BUFFER, instanceBufferSize, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, &instanceData[0]);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatcher::setMeshUniforms(Material& material, TTK::MeshBase& mesh)
+{
+	static const ParameterId U_POSITION_SCALE = Material::getParameterId("u_positionScale");
+	static const ParameterId U_POSITION_OFFSET = Material::getParameterId("u_positionOffset");
+	static const ParameterId U_OCT_NORMALS = Material::getParameterId("u_octNormals");
+
+	material.setVec4(U_POSITION_SCALE, glm::vec4(mesh.positionScale, 1.0f));
+	material.setVec4(U_POSITION_OFFSET, glm::vec4(mesh.positionOffset, 0.0f));
+	material.setInt(U_OCT_NORMALS, mesh.vertexFormat.normals == TTK::NORMAL_OCT16 ? 1 : 0);
+}
+
+void InstanceBatcher::destroy()
+{
+	if (instanceBuffer)
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+		instanceBuffer = 0;
+	}
+
+	instanceBufferSize = 0;
+	batches.clear();
+	instanceData.clear();
+}
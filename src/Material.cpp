@@ -0,0 +1,288 @@
+#include "Material.h"
+#include "TTK/Profiler.h"
+#include <iostream>
+#include <map>
+#include <cstring>
+
+namespace
+{
+	// Every name given an id so far, shared by all materials
+	struct ParameterNames
+	{
+		std::map<std::string, ParameterId> ids;
+		std::vector<std::string> names;	// By id
+	};
+
+	ParameterNames& getParameterNames()
+	{
+		static ParameterNames names;
+		return names;
+	}
+
+	template <typename T>
+	void sendValue(ShaderProgram& program, int uniformIndex, const unsigned char* data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+
+		UniformHandle<T> uniform;
+		uniform.program = program.getHandle();
+		uniform.index = uniformIndex;
+		program.sendUniform(uniform, value);
+	}
+}
+
+ParameterId Material::getParameterId(const std::string& uniformName)
+{
+	ParameterNames& names = getParameterNames();
+	auto itr = names.ids.find(uniformName);
+
+	if (itr != names.ids.end())
+		return itr->second;
+
+	ParameterId id = names.names.size();
+	names.ids[uniformName] = id;
+	names.names.push_back(uniformName);
+
+	return id;
+}
+
+void Material::setInt(ParameterId id, int value)
+{
+	setParameter(id, PARAMETER_INT, &value);
+}
+
+void Material::setFloat(ParameterId id, float value)
+{
+	setParameter(id, PARAMETER_FLOAT, &value);
+}
+
+void Material::setVec2(ParameterId id, const glm::vec2& value)
+{
+	setParameter(id, PARAMETER_VEC2, &value);
+}
+
+void Material::setVec3(ParameterId id, const glm::vec3& value)
+{
+	setParameter(id, PARAMETER_VEC3, &value);
+}
+
+void Material::setVec4(ParameterId id, const glm::vec4& value)
+{
+	setParameter(id, PARAMETER_VEC4, &value);
+}
+
+void Material::setMat3(ParameterId id, const glm::mat3& value)
+{
+	setParameter(id, PARAMETER_MAT3, &value);
+}
+
+void Material::setMat4(ParameterId id, const glm::mat4& value)
+{
+	setParameter(id, PARAMETER_MAT4, &value);
+}
+
+void Material::setParameter(ParameterId id, ParameterType type, const void* value)
+{
+	int index = findParameter(id, type);
+
+	if (index < 0)
+		return;
+
+	Parameter& parameter = parameters[index];
+	unsigned int size = getParameterSize(type);
+
+	if (parameter.isSet && memcmp(&values[parameter.offset], value, size) == 0)
+		return;
+
+	memcpy(&values[parameter.offset], value, size);
+	parameter.isSet = true;
+	parameter.dirty = 0xFFFFFFFF;
+}
+
+int Material::findParameter(ParameterId id, ParameterType type)
+{
+	if (id < parameterIndices.size() && parameterIndices[id] >= 0)
+	{
+		int index = parameterIndices[id];
+
+		if (parameters[index].type != type)
+		{
+			std::cout << "Material: " << getParameterNames().names[id] << " set as a different type than the shader's" << std::endl;
+			return -1;
+		}
+
+		return index;
+	}
+
+	if (id >= parameterIndices.size())
+		parameterIndices.resize(id + 1, -1);
+
+	Parameter parameter;
+	parameter.id = id;
+	parameter.type = type;
+	parameter.offset = values.size();
+	parameter.isSet = false;
+	parameter.dirty = 0;
+
+	values.resize(values.size() + getParameterSize(type));
+	parameterIndices[id] = parameters.size();
+	parameters.push_back(parameter);
+
+	return parameterIndices[id];
+}
+
+void Material::layoutParameters(ShaderProgram& program)
+{
+	for (unsigned int i = 0; i < program.getNumUniforms(); i++)
+	{
+		ParameterId id = getParameterId(program.getUniformName(i));
+		ParameterType type = getParameterType(program.getUniformType(i));
+
+		// Types there is no setter for, ivec3 say, are left out
+		if ((id >= parameterIndices.size() || parameterIndices[id] < 0) && isCompatible(type, program.getUniformType(i)))
+			findParameter(id, type);
+	}
+}
+
+Material::ProgramState& Material::getProgramState(ShaderProgram& program, unsigned int& programBit)
+{
+	for (unsigned int i = 0; i < programs.size(); i++)
+	{
+		if (programs[i].program == &program)
+		{
+			programBit = i;
+			return programs[i];
+		}
+	}
+
+	ProgramState state;
+	state.program = &program;
+	state.numLinks = 0;
+	state.numUploads = 0;
+
+	// Out of dirty bits, take over the last program's. It just gets everything sent again
+	if (programs.size() == MAX_PROGRAMS)
+	{
+		programBit = MAX_PROGRAMS - 1;
+		programs[programBit] = state;
+		return programs[programBit];
+	}
+
+	programBit = programs.size();
+	programs.push_back(state);
+	return programs.back();
+}
+
+void Material::sendUniforms(ShaderProgram& program)
+{
+	TTK_PROFILE_ZONE("Material::sendUniforms");
+
+	unsigned int programBit;
+	ProgramState& state = getProgramState(program, programBit);
+
+	// Something else has sent uniforms to this program, the values in it may not be ours any more.
+	// Sending them all again is cheap, the program skips the ones that didn't change
+	bool sendAll = state.numUploads != program.getNumUploads();
+
+	// Nothing of this program's is known yet, or it has been linked again
+	if (state.numLinks != program.getNumLinks())
+	{
+		layoutParameters(program);
+		state.uniformIndices.clear();
+		state.numLinks = program.getNumLinks();
+		sendAll = true;
+	}
+
+	// Find the program's uniform for parameters added since the last send
+	for (unsigned int i = state.uniformIndices.size(); i < parameters.size(); i++)
+	{
+		int uniformIndex = -1;
+
+		for (unsigned int j = 0; j < program.getNumUniforms(); j++)
+		{
+			if (program.getUniformName(j) == getParameterNames().names[parameters[i].id] &&
+				isCompatible(parameters[i].type, program.getUniformType(j)))
+			{
+				uniformIndex = j;
+				break;
+			}
+		}
+
+		state.uniformIndices.push_back(uniformIndex);
+	}
+
+	unsigned int mask = 1u << programBit;
+
+	for (unsigned int i = 0; i < parameters.size(); i++)
+	{
+		Parameter& parameter = parameters[i];
+
+		if (!parameter.isSet || (!sendAll && !(parameter.dirty & mask)))
+			continue;
+
+		parameter.dirty &= ~mask;
+
+		int uniformIndex = state.uniformIndices[i];
+
+		if (uniformIndex < 0)
+			continue;
+
+		const unsigned char* data = &values[parameter.offset];
+
+		switch (parameter.type)
+		{
+		case PARAMETER_INT:		sendValue<int>(program, uniformIndex, data); break;
+		case PARAMETER_FLOAT:	sendValue<float>(program, uniformIndex, data); break;
+		case PARAMETER_VEC2:	sendValue<glm::vec2>(program, uniformIndex, data); break;
+		case PARAMETER_VEC3:	sendValue<glm::vec3>(program, uniformIndex, data); break;
+		case PARAMETER_VEC4:	sendValue<glm::vec4>(program, uniformIndex, data); break;
+		case PARAMETER_MAT3:	sendValue<glm::mat3>(program, uniformIndex, data); break;
+		case PARAMETER_MAT4:	sendValue<glm::mat4>(program, uniformIndex, data); break;
+		}
+	}
+
+	state.numUploads = program.getNumUploads();
+}
+
+ParameterType Material::getParameterType(GLenum uniformType)
+{
+	switch (uniformType)
+	{
+	case GL_FLOAT:		return PARAMETER_FLOAT;
+	case GL_FLOAT_VEC2:	return PARAMETER_VEC2;
+	case GL_FLOAT_VEC3:	return PARAMETER_VEC3;
+	case GL_FLOAT_VEC4:	return PARAMETER_VEC4;
+	case GL_FLOAT_MAT3:	return PARAMETER_MAT3;
+	case GL_FLOAT_MAT4:	return PARAMETER_MAT4;
+	default:			return PARAMETER_INT;
+	}
+}
+
+bool Material::isCompatible(ParameterType type, GLenum uniformType)
+{
+	switch (type)
+	{
+	case PARAMETER_FLOAT:	return UniformType<float>::matches(uniformType);
+	case PARAMETER_VEC2:	return UniformType<glm::vec2>::matches(uniformType);
+	case PARAMETER_VEC3:	return UniformType<glm::vec3>::matches(uniformType);
+	case PARAMETER_VEC4:	return UniformType<glm::vec4>::matches(uniformType);
+	case PARAMETER_MAT3:	return UniformType<glm::mat3>::matches(uniformType);
+	case PARAMETER_MAT4:	return UniformType<glm::mat4>::matches(uniformType);
+	default:				return UniformType<int>::matches(uniformType);
+	}
+}
+
+unsigned int Material::getParameterSize(ParameterType type)
+{
+	switch (type)
+	{
+	case PARAMETER_FLOAT:	return sizeof(float);
+	case PARAMETER_VEC2:	return sizeof(glm::vec2);
+	case PARAMETER_VEC3:	return sizeof(glm::vec3);
+	case PARAMETER_VEC4:	return sizeof(glm::vec4);
+	case PARAMETER_MAT3:	return sizeof(glm::mat3);
+	case PARAMETER_MAT4:	return sizeof(glm::mat4);
+	default:				return sizeof(int);
+	}
+}
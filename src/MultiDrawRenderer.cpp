@@ -0,0 +1,210 @@
+#include "MultiDrawRenderer.h"
+#include "TTK/GLState.h"
+#include "UniformBlocks.h"
+
+MultiDrawRenderer::MultiDrawRenderer(TTK::GeometryArena& arena)
+	: arena(arena)
+{
+	commandBuffer = 0;
+	drawDataBuffer = 0;
+	commandBufferSize = 0;
+	drawDataBufferSize = 0;
+	numDrawCalls = 0;
+	numObjects = 0;
+}
+
+MultiDrawRenderer::~MultiDrawRenderer()
+{
+	destroy();
+}
+
+bool MultiDrawRenderer::isSupported()
+{
+	return GLEW_VERSION_4_3 && GLEW_ARB_shader_draw_parameters;
+}
+
+void MultiDrawRenderer::add(std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material, unsigned int lod,
+	const glm::mat4& model, const glm::vec4& colour)
+{
+	ObjectInstance instance;
+	instance.model = model;
+	instance.colour = colour;
+
+	const TTK::ArenaMesh* arenaMesh = nullptr;
+
+	if (material->indirectShader && isSupported())
+		arenaMesh = findArenaMesh(mesh.get());
+
+	if (!arenaMesh)
+	{
+		SingleDraw single;
+		single.mesh = mesh;
+		single.material = material;
+		single.lod = lod;
+		single.instance = instance;
+		singleDraws.push_back(single);
+		return;
+	}
+
+	DrawGroup& group = groups[std::make_pair(material.get(), arenaMesh->block)];
+
+	if (!group.material)
+	{
+		group.material = material;
+		group.block = arenaMesh->block;
+	}
+
+	DrawElementsIndirectCommand command;
+	arena.getLODRange(*arenaMesh, lod, command.firstIndex, command.count);
+	command.instanceCount = 1;
+	command.baseVertex = arenaMesh->baseVertex;
+	command.baseInstance = 0;
+
+	group.commands.push_back(command);
+	group.drawData.push_back(instance);
+}
+
+void MultiDrawRenderer::draw(TTK::Camera&)
+{
+	numDrawCalls = 0;
+	numObjects = 0;
+
+	// Lay every group out in one array so the commands and draw data each go to the GPU at once
+	commandData.clear();
+	drawData.clear();
+
+	for (auto itr = groups.begin(); itr != groups.end(); ++itr)
+	{
+		DrawGroup& group = itr->second;
+		group.firstDraw = commandData.size();
+
+		commandData.insert(commandData.end(), group.commands.begin(), group.commands.end());
+		drawData.insert(drawData.end(), group.drawData.begin(), group.drawData.end());
+	}
+
+	if (commandData.size() > 0)
+	{
+		uploadBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer, commandBufferSize,
+			&commandData[0], commandData.size() * sizeof(DrawElementsIndirectCommand));
+		uploadBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer, drawDataBufferSize,
+			&drawData[0], drawData.size() * sizeof(ObjectInstance));
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer);
+
+		for (auto itr = groups.begin(); itr != groups.end(); ++itr)
+		{
+			DrawGroup& group = itr->second;
+			Material& material = *group.material;
+
+			if (group.commands.empty())
+				continue;
+
+			material.indirectShader->bind();
+
+			// gl_DrawID starts from 0 for every glMultiDrawElementsIndirect
+			static const ParameterId U_FIRST_DRAW = Material::getParameterId("u_firstDraw");
+			material.setInt(U_FIRST_DRAW, group.firstDraw);
+			material.sendUniforms(*material.indirectShader);
+
+			arena.bindBlock(group.block);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+				(const void*)(group.firstDraw * sizeof(DrawElementsIndirectCommand)), group.commands.size(), 0);
+
+			numDrawCalls++;
+			numObjects += group.commands.size();
+		}
+
+		TTK::GLState::shared().bindVertexArray(0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	// Same as GameObject::draw
+	for (unsigned int i = 0; i < singleDraws.size(); i++)
+	{
+		SingleDraw& single = singleDraws[i];
+		Material& material = *single.material;
+		TTK::MeshBase& mesh = *single.mesh;
+
+		material.shader->bind();
+		material.sendUniforms();
+		UniformBlocks::shared().setObject(single.instance.model, single.instance.colour, mesh);
+
+		mesh.drawLOD(single.lod);
+
+		numDrawCalls++;
+		numObjects++;
+	}
+
+	// Keep the groups that were used for next frame, let go of the rest
+	for (auto itr = groups.begin(); itr != groups.end();)
+	{
+		if (itr->second.commands.empty())
+		{
+			itr = groups.erase(itr);
+		}
+		else
+		{
+			itr->second.commands.clear();
+			itr->second.drawData.clear();
+			++itr;
+		}
+	}
+
+	singleDraws.clear();
+}
+
+const TTK::ArenaMesh* MultiDrawRenderer::findArenaMesh(TTK::MeshBase* mesh)
+{
+	const TTK::ArenaMesh* arenaMesh = arena.findMesh(mesh);
+
+	if (arenaMesh)
+		return arenaMesh;
+
+	// A mesh still loading has nothing on the GPU to copy yet
+	if (!mesh->isUploaded())
+		return nullptr;
+
+	if (!arena.addMesh(mesh))
+		return nullptr;
+
+	return arena.findMesh(mesh);
+}
+
+void MultiDrawRenderer::uploadBuffer(GLenum target, unsigned int& buffer, size_t& bufferSize, const void* data, size_t size)
+{
+	if (!buffer)
+		glGenBuffers(1, &buffer);
+
+	glBindBuffer(target, buffer);
+
+	// Grow by half again so a slowly growing scene doesn't reallocate every frame
+	if (size > bufferSize)
+		bufferSize = size + size / 2;
+
+	// Orphan last frame's storage rather than waiting for the GPU to finish reading it
+	glBufferData(target, bufferSize, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(target, 0, size, data);
+
+	glBindBuffer(target, 0);
+}
+
+void MultiDrawRenderer::destroy()
+{
+	if (commandBuffer)
+	{
+		glDeleteBuffers(1, &commandBuffer);
+		commandBuffer = 0;
+	}
+
+	if (drawDataBuffer)
+	{
+		glDeleteBuffers(1, &drawDataBuffer);
+		drawDataBuffer = 0;
+	}
+
+	commandBufferSize = 0;
+	drawDataBufferSize = 0;
+	groups.clear();
+	singleDraws.clear();
+}
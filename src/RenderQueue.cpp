@@ -0,0 +1,237 @@
+#include "RenderQueue.h"
+#include "TTK/GLState.h"
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	const unsigned int PASS_BITS = 2;
+	const unsigned int SHADER_BITS = 10;
+	const unsigned int MATERIAL_BITS = 12;
+	const unsigned int MESH_BITS = 16;
+	const unsigned int DEPTH_BITS = 24;
+
+	const uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+	// A positive float's bits count up in the same order as the float, so the top
+	// bits are a depth that sorts right without knowing the camera's near and far
+	uint64_t quantizeDepth(float depth)
+	{
+		if (!(depth > 0.0f))
+			depth = 0.0f;
+
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+
+		return (bits >> (31 - DEPTH_BITS)) & DEPTH_MASK;
+	}
+}
+
+RenderQueue::RenderQueue()
+{
+	numDrawCalls = 0;
+	numShaderChanges = 0;
+	numMaterialChanges = 0;
+}
+
+void RenderQueue::add(std::shared_ptr<TTK::MeshBase> mesh, std::shared_ptr<Material> material, unsigned int lod,
+	const glm::mat4& model, const glm::vec4& colour)
+{
+	// draw reads the bounds, which a mesh still loading doesn't have yet
+	if (!mesh->isUploaded())
+		return;
+
+	DrawPacket packet;
+	packet.mesh = mesh;
+	packet.material = material;
+	packet.lod = lod;
+	packet.instance.model = model;
+	packet.instance.colour = colour;
+
+	packets.push_back(packet);
+}
+
+void RenderQueue::draw(TTK::Camera& camera)
+{
+	numDrawCalls = 0;
+	numShaderChanges = 0;
+	numMaterialChanges = 0;
+
+	// Depth needs the camera, so the keys are made here rather than in add
+	sortEntries.resize(packets.size());
+
+	for (unsigned int i = 0; i < packets.size(); i++)
+	{
+		DrawPacket& packet = packets[i];
+		glm::vec3 centre = (packet.mesh->boundsMin + packet.mesh->boundsMax) * 0.5f;
+		float depth = -(camera.viewMatrix * packet.instance.model * glm::vec4(centre, 1.0f)).z;
+
+		sortEntries[i].key = makeKey(packet, depth);
+		sortEntries[i].packet = i;
+	}
+
+	radixSort();
+
+	// Every object's uniform block goes to the GPU in one write, in draw order
+	objectData.resize(sortEntries.size());
+
+	for (unsigned int i = 0; i < sortEntries.size(); i++)
+	{
+		DrawPacket& packet = packets[sortEntries[i].packet];
+		objectData[i] = UniformBlocks::shared().makeObject(packet.instance.model, packet.instance.colour, *packet.mesh);
+	}
+
+	size_t firstObject = UniformBlocks::shared().writeObjects(objectData.empty() ? nullptr : &objectData[0], objectData.size());
+
+	ShaderProgram* boundShader = nullptr;
+	Material* currentMaterial = nullptr;
+	bool blending = false;
+
+	for (unsigned int i = 0; i < sortEntries.size(); i++)
+	{
+		DrawPacket& packet = packets[sortEntries[i].packet];
+		Material& material = *packet.material;
+		TTK::MeshBase& mesh = *packet.mesh;
+
+		// Keys are sorted by pass first, so this only happens once
+		if (material.transparent && !blending)
+		{
+			TTK::GLState::shared().enable(GL_BLEND);
+			TTK::GLState::shared().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_FALSE);
+			blending = true;
+		}
+
+		if (material.shader.get() != boundShader)
+		{
+			boundShader = material.shader.get();
+			boundShader->bind();
+			numShaderChanges++;
+		}
+
+		// Material uniforms only change between materials, the per object ones are in the block
+		if (&material != currentMaterial)
+		{
+			currentMaterial = &material;
+			material.sendUniforms();
+			numMaterialChanges++;
+		}
+
+		UniformBlocks::shared().bindObject(firstObject, i);
+
+		mesh.drawLOD(packet.lod);
+		numDrawCalls++;
+	}
+
+	if (blending)
+	{
+		glDepthMask(GL_TRUE);
+		TTK::GLState::shared().disable(GL_BLEND);
+	}
+
+	packets.clear();
+}
+
+uint64_t RenderQueue::makeKey(const DrawPacket& packet, float depth)
+{
+	uint64_t shader = getId(shaderIds, packet.material->shader.get(), SHADER_BITS);
+	uint64_t material = getId(materialIds, packet.material.get(), MATERIAL_BITS);
+	uint64_t mesh = getId(meshIds, packet.mesh.get(), MESH_BITS);
+	uint64_t quantizedDepth = quantizeDepth(depth);
+
+	if (packet.material->transparent)
+	{
+		// Furthest first
+		uint64_t key = (uint64_t)PASS_TRANSPARENT << (64 - PASS_BITS);
+		key |= (DEPTH_MASK - quantizedDepth) << (SHADER_BITS + MATERIAL_BITS + MESH_BITS);
+		key |= shader << (MATERIAL_BITS + MESH_BITS);
+		key |= material << MESH_BITS;
+		key |= mesh;
+		return key;
+	}
+
+	uint64_t key = (uint64_t)PASS_OPAQUE << (64 - PASS_BITS);
+	key |= shader << (MATERIAL_BITS + MESH_BITS + DEPTH_BITS);
+	key |= material << (MESH_BITS + DEPTH_BITS);
+	key |= mesh << DEPTH_BITS;
+	key |= quantizedDepth;
+	return key;
+}
+
+void RenderQueue::radixSort()
+{
+	size_t count = sortEntries.size();
+
+	if (count < 2)
+		return;
+
+	sortScratch.resize(count);
+
+	// Count every byte of every key in one go
+	unsigned int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = sortEntries[i].key;
+
+		for (unsigned int byte = 0; byte < 8; byte++)
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+	}
+
+	SortEntry* source = &sortEntries[0];
+	SortEntry* destination = &sortScratch[0];
+
+	for (unsigned int byte = 0; byte < 8; byte++)
+	{
+		unsigned int* histogram = histograms[byte];
+		unsigned int shift = byte * 8;
+
+		// Every key has the same byte here, the order would not change
+		if (histogram[(source[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		// Where each bucket starts
+		unsigned int offsets[256];
+		unsigned int total = 0;
+
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			offsets[bucket] = total;
+			total += histogram[bucket];
+		}
+
+		// Stable, so the order of the lower bytes is kept
+		for (size_t i = 0; i < count; i++)
+			destination[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+
+		std::swap(source, destination);
+	}
+
+	if (source != &sortEntries[0])
+		sortEntries.swap(sortScratch);
+}
+
+unsigned int RenderQueue::getId(std::map<const void*, unsigned int>& ids, const void* object, unsigned int numBits)
+{
+	auto itr = ids.find(object);
+
+	if (itr != ids.end())
+		return itr->second;
+
+	unsigned int maxId = (1u << numBits) - 1;
+	unsigned int id = ids.size() < maxId ? ids.size() : maxId;
+
+	ids[object] = id;
+	return id;
+}
+
+void RenderQueue::destroy()
+{
+	packets.clear();
+	sortEntries.clear();
+	sortScratch.clear();
+	shaderIds.clear();
+	materialIds.clear();
+	meshIds.clear();
+}
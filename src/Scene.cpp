@@ -0,0 +1,246 @@
+#include "Scene.h"
+#include "UniformBlocks.h"
+#include "TTK/Profiler.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+Scene::Scene()
+{
+	lightPos = glm::vec4(0.0f, 10.0f, 0.0f, 1.0f);
+	drawMode = DRAW_INSTANCED;
+	lightAngle = 0.0f;
+	numDrawCalls = 0;
+}
+
+bool Scene::loadFromFile(const std::string& fileName, const std::string& meshPath, std::shared_ptr<Material> material,
+	const TTK::OBJLoadOptions& loadOptions, bool async)
+{
+	std::ifstream file(fileName);
+
+	if (!file.is_open())
+	{
+		std::cout << "Scene Error: Cannot read file: " << fileName << std::endl;
+		return false;
+	}
+
+	std::string line;
+	unsigned int lineNumber = 0;
+	bool ok = true;
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		std::istringstream words(line.substr(0, line.find('#')));
+		std::string keyword;
+
+		if (!(words >> keyword))
+			continue;
+
+		bool lineOk = false;
+
+		if (keyword == "mesh")
+		{
+			std::string name, meshFile;
+
+			if (words >> name >> meshFile)
+			{
+				std::shared_ptr<TTK::OBJMesh> mesh = std::make_shared<TTK::OBJMesh>();
+
+				if (async)
+					mesh->loadMeshAsync(meshPath + meshFile, loadOptions);
+				else
+					mesh->loadMesh(meshPath + meshFile, loadOptions);
+
+				meshes[name] = mesh;
+				objMeshes[name] = mesh;
+				lineOk = true;
+			}
+		}
+		else if (keyword == "object")
+		{
+			std::string name, meshName;
+			glm::vec3 position;
+			glm::vec4 colour(1.0f);
+
+			if (words >> name >> meshName >> position.x >> position.y >> position.z)
+			{
+				words >> colour.r >> colour.g >> colour.b >> colour.a;
+				lineOk = addObject(name, meshName, position, colour, material) != nullptr;
+			}
+		}
+		else if (keyword == "grid")
+		{
+			std::string name, meshName;
+			unsigned int columns, rows;
+			float spacing, y;
+			glm::vec4 colour(1.0f);
+
+			if (words >> name >> meshName >> columns >> rows >> spacing >> y)
+			{
+				words >> colour.r >> colour.g >> colour.b >> colour.a;
+				lineOk = true;
+
+				glm::vec3 corner = glm::vec3((columns - 1) * spacing, 0.0f, (rows - 1) * spacing) * -0.5f;
+
+				for (unsigned int i = 0; i < columns * rows && lineOk; i++)
+				{
+					glm::vec3 position = corner + glm::vec3((i % columns) * spacing, y, (i / columns) * spacing);
+					lineOk = addObject(name + "_" + std::to_string(i), meshName, position, colour, material) != nullptr;
+				}
+			}
+		}
+		else if (keyword == "parent")
+		{
+			std::string name, parentName;
+
+			if (words >> name >> parentName)
+			{
+				auto child = gameobjects.find(name);
+				auto parent = gameobjects.find(parentName);
+
+				if (child != gameobjects.end() && parent != gameobjects.end())
+				{
+					parent->second->addChild(child->second.get());
+					lineOk = true;
+				}
+			}
+		}
+		else if (keyword == "light")
+		{
+			std::string name;
+
+			if (words >> name && gameobjects.count(name) > 0)
+			{
+				lightObject = name;
+				lineOk = true;
+			}
+		}
+
+		if (!lineOk)
+		{
+			std::cout << "Scene Error: " << fileName << " line " << lineNumber << ": " << line << std::endl;
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+void Scene::update(float dt)
+{
+	TTK_PROFILE_ZONE("Scene::update");
+
+	// Move light in simple circular path
+	lightAngle += dt;
+	lightPos.x = cos(lightAngle) * 15.0f;
+	lightPos.y = 10.0f;
+	lightPos.z = sin(lightAngle) * 15.0f;
+	lightPos.w = 1.0f;
+
+	if (lightObject.length() > 0)
+		gameobjects[lightObject]->setPosition(glm::vec3(lightPos));
+
+	// Update all game objects
+	for (auto itr = gameobjects.begin(); itr != gameobjects.end(); ++itr)
+	{
+		auto gameobject = itr->second;
+
+		// Remember: root nodes are responsible for updating all of its children
+		// So we need to make sure to only invoke update() for the root nodes.
+		// Otherwise some objects would get updated twice in a frame!
+		if (gameobject->isRoot())
+			gameobject->update(dt);
+	}
+}
+
+void Scene::draw(TTK::Camera& cam)
+{
+	TTK_PROFILE_ZONE("Scene::draw");
+
+	// Camera and light go in the frame uniform block, every shader reads them from there
+	UniformBlocks::shared().setFrame(cam, cam.viewMatrix * lightPos);
+
+	numDrawCalls = 0;
+
+	for (auto itr = gameobjects.begin(); itr != gameobjects.end(); ++itr)
+	{
+		auto gameobject = itr->second;
+
+		// Drawn one at a time, each object whose mesh is on the GPU is a draw call
+		if (drawMode == DRAW_EACH_OBJECT && gameobject->mesh->isUploaded())
+			numDrawCalls++;
+
+		if (!gameobject->isRoot())
+			continue;
+
+		if (drawMode == DRAW_SORTED)
+			gameobject->submit(renderQueue, cam);
+		else if (drawMode == DRAW_INSTANCED)
+			gameobject->submit(instanceBatcher, cam);
+		else if (drawMode == DRAW_MULTI_INDIRECT)
+			gameobject->submit(multiDrawRenderer, cam);
+		else
+			gameobject->draw(cam);
+	}
+
+	if (drawMode == DRAW_SORTED)
+	{
+		renderQueue.draw(cam);
+		numDrawCalls = renderQueue.getNumDrawCalls();
+	}
+	else if (drawMode == DRAW_INSTANCED)
+	{
+		instanceBatcher.draw(cam);
+		numDrawCalls = instanceBatcher.getNumDrawCalls();
+	}
+	else if (drawMode == DRAW_MULTI_INDIRECT)
+	{
+		multiDrawRenderer.draw(cam);
+		numDrawCalls = multiDrawRenderer.getNumDrawCalls();
+	}
+}
+
+const char* Scene::getDrawModeName(ObjectDrawMode mode)
+{
+	const char* names[] = { "each", "sorted", "instanced", "indirect" };
+
+	return mode < NUM_DRAW_MODES ? names[mode] : "unknown";
+}
+
+void Scene::destroy()
+{
+	instanceBatcher.destroy();
+	multiDrawRenderer.destroy();
+	renderQueue.destroy();
+
+	// The arena knows meshes by address, a mesh allocated at the same address later must not find these
+	for (auto itr = meshes.begin(); itr != meshes.end(); ++itr)
+		TTK::GeometryArena::shared().removeMesh(itr->second.get());
+
+	gameobjects.clear();
+	meshes.clear();
+	objMeshes.clear();
+	lightObject.clear();
+}
+
+std::shared_ptr<GameObject> Scene::addObject(const std::string& name, const std::string& meshName,
+	glm::vec3 position, glm::vec4 colour, std::shared_ptr<Material> material)
+{
+	auto mesh = objMeshes.find(meshName);
+
+	if (mesh == objMeshes.end())
+	{
+		std::cout << "Scene Error: object " << name << " uses mesh " << meshName << ", which is not loaded before it" << std::endl;
+		return nullptr;
+	}
+
+	std::shared_ptr<GameObject> gameobject = std::make_shared<GameObject>(position, mesh->second, material);
+	gameobject->name = name;
+	gameobject->colour = colour;
+
+	gameobjects[name] = gameobject;
+
+	return gameobject;
+}
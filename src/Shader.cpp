@@ -1,11 +1,18 @@
 #include "Shader.h"
 #include <iostream>
+#include <cstring>
+#include <cctype>
 #include "GLEW/glew.h"
 #include "TTK/io.h"
+#include "ShaderBatch.h"
+#include "TTK/Profiler.h"
 
 Shader::Shader()
 {
 	handle = 0;
+	shaderType = 0;
+	features = 0;
+	compileChecked = false;
 }
 
 Shader::~Shader()
@@ -13,29 +20,186 @@ Shader::~Shader()
 	destroy();
 }
 
-unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type)
+namespace
 {
+	const char* featureNames[NUM_SHADER_FEATURES] =
+	{
+		"INSTANCED",
+		"LIT",
+		"TEXTURED"
+	};
+
+	bool isNameChar(char c)
+	{
+		return isalnum((unsigned char)c) || c == '_';
+	}
+
+	// True if word is in line on its own, so LIT doesn't match SPLIT
+	bool containsWord(const std::string& line, const char* word)
+	{
+		size_t length = strlen(word);
+
+		for (size_t pos = line.find(word); pos != std::string::npos; pos = line.find(word, pos + 1))
+		{
+			bool startOk = pos == 0 || !isNameChar(line[pos - 1]);
+			bool endOk = pos + length == line.length() || !isNameChar(line[pos + length]);
+
+			if (startOk && endOk)
+				return true;
+		}
+
+		return false;
+	}
+}
+
+bool Shader::loadShaderFromFile(std::string file, GLenum type, unsigned int featureMask)
+{
+	TTK_PROFILE_ZONE("Shader::loadShaderFromFile");
+
 	// Load shader file into memory
-	std::string shaderCode = TTK::IO::loadFile(fileName).c_str();
+	return loadShaderFromSource(TTK::IO::loadFile(file).c_str(), file, type, featureMask);
+}
+
+bool Shader::loadShaderFromSource(const std::string& text, const std::string& name, GLenum type, unsigned int featureMask)
+{
+	destroy();
+
+	fileName = name;
+	shaderType = type;
+	features = featureMask;
+	source.clear();
 
 	// Could not load file
-	if (shaderCode.length() == 0)
-		return 0;
+	if (text.length() == 0)
+		return false;
+
+	std::string defines;
+
+	for (unsigned int i = 0; i < NUM_SHADER_FEATURES; i++)
+	{
+		if (features & (1u << i))
+			defines += std::string("#define ") + featureNames[i] + "\n";
+	}
+
+	// #version has to come first, the defines go on the line after it
+	size_t version = text.find("#version");
+	size_t insertAt = 0;
+
+	if (version != std::string::npos)
+	{
+		size_t endOfLine = text.find('\n', version);
+		insertAt = endOfLine == std::string::npos ? text.length() : endOfLine + 1;
+	}
+
+	source = text.substr(0, insertAt);
+
+	if (insertAt == text.length() && insertAt > 0 && text[insertAt - 1] != '\n')
+		source += "\n";
+
+	source += defines + text.substr(insertAt);
+
+	return true;
+}
+
+std::string Shader::getVariantName()
+{
+	std::string name = fileName;
+
+	for (unsigned int i = 0; i < NUM_SHADER_FEATURES; i++)
+	{
+		if (features & (1u << i))
+			name += std::string(".") + featureNames[i];
+	}
+
+	return name;
+}
+
+const char* Shader::getFeatureName(unsigned int feature)
+{
+	for (unsigned int i = 0; i < NUM_SHADER_FEATURES; i++)
+	{
+		if (feature == (1u << i))
+			return featureNames[i];
+	}
+
+	return "";
+}
+
+unsigned int Shader::getUsedFeatures(const std::string& text)
+{
+	unsigned int used = 0;
+	size_t lineStart = 0;
+
+	while (lineStart < text.length())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+
+		if (lineEnd == std::string::npos)
+			lineEnd = text.length();
+
+		size_t first = text.find_first_not_of(" \t", lineStart);
+
+		// Only preprocessor lines, the names are also in comments
+		if (first < lineEnd && text[first] == '#')
+		{
+			std::string line = text.substr(first, lineEnd - first);
+
+			for (unsigned int i = 0; i < NUM_SHADER_FEATURES; i++)
+			{
+				if (containsWord(line, featureNames[i]))
+					used |= 1u << i;
+			}
+		}
+
+		lineStart = lineEnd + 1;
+	}
+
+	return used;
+}
+
+unsigned int Shader::submitCompile()
+{
+	if (handle || source.length() == 0)
+		return handle;
 
 	// Create shader
 	// Makes an empty shader program with nothing in it
-	handle = glCreateShader(type);
+	handle = glCreateShader(shaderType);
 
 	// Load shader code into shader program
 	// [0] - which shader program to load code into
 	// [1] - number of source files for the shader
 	// [2] - pointer to an array of strings (pointer to pointer)
 	// [3] - terminating character for source files
-	const char* cstr = shaderCode.c_str();
+	const char* cstr = source.c_str();
 	glShaderSource(handle, 1, &cstr, 0);
 
 	// Compile the shader program
+	// The result isn't asked for here, that would wait for the compile to finish
 	glCompileShader(handle);
+	compileChecked = false;
+
+	return handle;
+}
+
+bool Shader::isCompileComplete()
+{
+	if (!handle || compileChecked || !ShaderBatch::isParallelCompileSupported())
+		return true;
+
+	int complete = GL_TRUE;
+	glGetShaderiv(handle, GL_COMPLETION_STATUS_ARB, &complete);
+	return complete == GL_TRUE;
+}
+
+unsigned int Shader::finishCompile()
+{
+	TTK_PROFILE_ZONE("Shader::finishCompile");
+
+	if (!handle || compileChecked)
+		return handle;
+
+	compileChecked = true;
 
 	// Check to see if shader compiled
 	// Returns 1 if success
@@ -44,11 +208,11 @@ unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type)
 
 	if (compileStatus)
 	{
-		std::cout << "Shader Compiled Successfully: " << fileName << std::endl;
+		std::cout << "Shader Compiled Successfully: " << getVariantName() << std::endl;
 		return handle;
 	}
 
-	std::cout << "Shader Failed to Compile: " << fileName << std::endl;
+	std::cout << "Shader Failed to Compile: " << getVariantName() << std::endl;
 
 	// If shader failed to compile, output the errors
 	// First need to get length of error message
@@ -66,6 +230,9 @@ unsigned int Shader::loadShaderFromFile(std::string fileName, GLenum type)
 	// Output log to screen
 	std::cout << log << std::endl;
 
+	glDeleteShader(handle);
+	handle = 0;
+
 	return 0;
 }
 
@@ -0,0 +1,91 @@
+#include "ShaderBatch.h"
+#include <iostream>
+#include <cstring>
+
+namespace
+{
+	bool hasExtension(const char* name)
+	{
+		GLint numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+		for (GLint i = 0; i < numExtensions; i++)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+
+			if (extension && strcmp(extension, name) == 0)
+				return true;
+		}
+
+		return false;
+	}
+}
+
+void ShaderBatch::add(std::shared_ptr<ShaderProgram> program)
+{
+	if (program)
+		added.push_back(program);
+}
+
+void ShaderBatch::submit()
+{
+	isParallelCompileSupported();
+
+	// Every compile and link goes in before any status is asked for
+	for (unsigned int i = 0; i < added.size(); i++)
+	{
+		if (added[i]->submitLink())
+			submitted.push_back(added[i]);
+	}
+
+	added.clear();
+}
+
+bool ShaderBatch::isComplete()
+{
+	for (unsigned int i = 0; i < submitted.size(); i++)
+	{
+		if (!submitted[i]->isLinkComplete())
+			return false;
+	}
+
+	return true;
+}
+
+unsigned int ShaderBatch::finish()
+{
+	unsigned int numFailed = 0;
+
+	for (unsigned int i = 0; i < submitted.size(); i++)
+	{
+		if (!submitted[i]->finishLink())
+			numFailed++;
+	}
+
+	submitted.clear();
+
+	return numFailed;
+}
+
+bool ShaderBatch::isParallelCompileSupported()
+{
+	static int supported = -1;
+
+	if (supported < 0)
+	{
+		// KHR and ARB share the GL_COMPLETION_STATUS enum. GLEW only loads the ARB thread count
+		// function, with just KHR the driver picks the number of threads itself
+		bool hasKHR = GLEW_VERSION_3_0 && hasExtension("GL_KHR_parallel_shader_compile");
+		bool hasARB = GLEW_ARB_parallel_shader_compile && glMaxShaderCompilerThreadsARB;
+
+		// 0xFFFFFFFF lets the driver use as many threads as it likes
+		if (hasARB)
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+		supported = hasKHR || hasARB;
+
+		std::cout << "ShaderBatch: parallel shader compile " << (supported ? "on" : "not supported") << std::endl;
+	}
+
+	return supported != 0;
+}
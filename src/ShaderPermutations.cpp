@@ -0,0 +1,100 @@
+#include "ShaderPermutations.h"
+#include "TTK/IO.h"
+#include "TTK/Profiler.h"
+#include <iostream>
+
+bool ShaderPermutations::loadShadersFromFile(const std::string& vertexFile, const std::string& fragmentFile)
+{
+	TTK_PROFILE_ZONE("ShaderPermutations::loadShadersFromFile");
+
+	destroy();
+
+	stages[0].fileName = vertexFile;
+	stages[0].type = GL_VERTEX_SHADER;
+	stages[1].fileName = fragmentFile;
+	stages[1].type = GL_FRAGMENT_SHADER;
+
+	bool ok = true;
+
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		stages[i].source = TTK::IO::loadFile(stages[i].fileName).c_str();
+		stages[i].usedFeatures = Shader::getUsedFeatures(stages[i].source);
+
+		if (stages[i].source.length() == 0)
+		{
+			std::cout << "ShaderPermutations Error: Cannot read file: " << stages[i].fileName << std::endl;
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+std::shared_ptr<ShaderProgram> ShaderPermutations::get(unsigned int features)
+{
+	auto itr = programs.find(features);
+
+	if (itr != programs.end())
+		return itr->second;
+
+	std::shared_ptr<ShaderProgram> program = makeProgram(features);
+	program->linkProgram();
+
+	return program;
+}
+
+std::shared_ptr<ShaderProgram> ShaderPermutations::get(unsigned int features, ShaderBatch& batch)
+{
+	auto itr = programs.find(features);
+
+	if (itr != programs.end())
+		return itr->second;
+
+	std::shared_ptr<ShaderProgram> program = makeProgram(features);
+	batch.add(program);
+
+	return program;
+}
+
+unsigned int ShaderPermutations::getNumShaders()
+{
+	return stages[0].variants.size() + stages[1].variants.size();
+}
+
+void ShaderPermutations::destroy()
+{
+	// Programs first, they may still be linking with the shaders
+	programs.clear();
+
+	for (unsigned int i = 0; i < 2; i++)
+		stages[i].variants.clear();
+}
+
+std::shared_ptr<ShaderProgram> ShaderPermutations::makeProgram(unsigned int features)
+{
+	std::shared_ptr<ShaderProgram> program = std::make_shared<ShaderProgram>();
+
+	for (unsigned int i = 0; i < 2; i++)
+		program->attachShader(getVariant(stages[i], features));
+
+	programs[features] = program;
+
+	return program;
+}
+
+Shader& ShaderPermutations::getVariant(Stage& stage, unsigned int features)
+{
+	// A feature the stage doesn't test would compile to the same shader again
+	unsigned int stageFeatures = features & stage.usedFeatures;
+
+	std::unique_ptr<Shader>& shader = stage.variants[stageFeatures];
+
+	if (!shader)
+	{
+		shader.reset(new Shader());
+		shader->loadShaderFromSource(stage.source, stage.fileName, stage.type, stageFeatures);
+	}
+
+	return *shader;
+}
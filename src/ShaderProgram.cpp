@@ -1,9 +1,19 @@
 #include "ShaderProgram.h"
+#include "TTK/GLState.h"
+#include "TTK/ProgramBinaryCache.h"
+#include "UniformBlocks.h"
+#include "ShaderBatch.h"
+#include "TTK/Profiler.h"
 #include <iostream>
 
 ShaderProgram::ShaderProgram()
 {
 	handle = 0;
+	numUploads = 0;
+	numLinks = 0;
+	linkPending = false;
+	linkedFromCache = false;
+	saveToCache = false;
 }
 
 ShaderProgram::~ShaderProgram()
@@ -11,96 +21,284 @@ ShaderProgram::~ShaderProgram()
 	destroy();
 }
 
-void ShaderProgram::attachShader(Shader shader)
+void ShaderProgram::attachShader(Shader& shader)
 {
 	if (handle == 0)
 	{
 		handle = glCreateProgram();
 	}
 
-	if (shader.getHandle())
+	// Compiled and attached in linkProgram, unless the program comes out of the binary cache
+	if (shader.getSource().length() > 0)
 	{
-		glAttachShader(handle, shader.getHandle());
+		attachedShaders.push_back(&shader);
 	}
 }
 
-int ShaderProgram::linkProgram()
+bool ShaderProgram::submitLink()
 {
-	if (handle)
+	TTK_PROFILE_ZONE("ShaderProgram::submitLink");
+
+	if (!handle)
 	{
-		// Link the shaders together into a single program
-		glLinkProgram(handle);
+		std::cout << "Shader program failed to link: handle not set" << std::endl;
+		return false;
+	}
+
+	if (linkPending)
+		return true;
 
-		// Check to see if shader program linked
-		// Returns 1 if success
-		int linkStatus;
-		glGetProgramiv(handle, GL_LINK_STATUS, &linkStatus);
+	linkPending = true;
+	linkedFromCache = false;
+	linkStartTime = std::chrono::high_resolution_clock::now();
 
-		if (linkStatus)
+	cacheFileName.clear();
+	saveToCache = TTK::ProgramBinaryCache::isEnabled() && attachedShaders.size() > 0 && TTK::ProgramBinaryCache::isSupported();
+
+	if (saveToCache)
+	{
+		std::vector<std::string> fileNames, sources;
+		std::vector<GLenum> types;
+
+		for (unsigned int i = 0; i < attachedShaders.size(); i++)
 		{
-			std::cout << "Shader linked Successfully." << std::endl;
-			return handle;
+			fileNames.push_back(attachedShaders[i]->getVariantName());
+			sources.push_back(attachedShaders[i]->getSource());
+			types.push_back(attachedShaders[i]->getType());
 		}
 
-		// If shader failed to link, output the errors
-		// First need to get length of error message
-		int logLength;
-		glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &logLength);
+		cacheFileName = TTK::ProgramBinaryCache::getCacheFileName(fileNames);
+		cacheKey = TTK::ProgramBinaryCache::makeKey(types, sources);
+
+		double compileMilliseconds = 0.0;
+
+		if (TTK::ProgramBinaryCache::load(cacheFileName, cacheKey, handle, compileMilliseconds))
+		{
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - linkStartTime;
 
-		// Make string for log
-		// Note: type of quotes is important
-		std::string log(logLength, ' ');
+			std::cout << "ProgramBinaryCache: hit " << cacheFileName << ", loaded in " << elapsed.count() * 1000.0
+				<< " ms, saved " << compileMilliseconds - elapsed.count() * 1000.0 << " ms of compiling" << std::endl;
 
-		// Get error log from OpenGL and store into string
-		// Remember string is an array of characters internally
-		glGetShaderInfoLog(handle, logLength, &logLength, &log[0]);
+			attachedShaders.clear();
+			linkedFromCache = true;
+			return true;
+		}
 
-		// Output log to screen
-		std::cout << log << std::endl;
+		std::cout << "ProgramBinaryCache: miss " << cacheFileName << std::endl;
 	}
-	else
+
+	// Start compiling each shader (once, even if it is in several programs) and link them together.
+	// Nothing here asks for a status, so none of it waits on the driver
+	for (unsigned int i = 0; i < attachedShaders.size(); i++)
 	{
-		std::cout << "Shader program failed to link: handle not set" << std::endl;
+		if (attachedShaders[i]->submitCompile())
+			glAttachShader(handle, attachedShaders[i]->getHandle());
 	}
+
+	// Some drivers only keep what glGetProgramBinary needs if asked before linking
+	if (saveToCache)
+		glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	// Link the shaders together into a single program
+	glLinkProgram(handle);
+
+	return true;
+}
+
+bool ShaderProgram::isLinkComplete()
+{
+	if (!linkPending || linkedFromCache || !ShaderBatch::isParallelCompileSupported())
+		return true;
+
+	int complete = GL_TRUE;
+	glGetProgramiv(handle, GL_COMPLETION_STATUS_ARB, &complete);
+	return complete == GL_TRUE;
+}
+
+int ShaderProgram::finishLink()
+{
+	TTK_PROFILE_ZONE("ShaderProgram::finishLink");
+
+	if (!linkPending)
+		return 0;
+
+	linkPending = false;
+
+	if (linkedFromCache)
+	{
+		reflectUniforms();
+		bindUniformBlocks();
+		numLinks++;
+		return handle;
+	}
+
+	// Shader compile logs first, a failed shader is why the link fails
+	for (unsigned int i = 0; i < attachedShaders.size(); i++)
+	{
+		if (!attachedShaders[i]->finishCompile())
+			saveToCache = false; // A program missing a stage can still link, don't keep it
+	}
+
+	attachedShaders.clear();
+
+	// Check to see if shader program linked
+	// Returns 1 if success
+	int linkStatus;
+	glGetProgramiv(handle, GL_LINK_STATUS, &linkStatus);
+
+	if (linkStatus)
+	{
+		std::cout << "Shader linked Successfully." << std::endl;
+
+		if (saveToCache)
+		{
+			// From submitLink, so in a batch this includes time spent on the other programs
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - linkStartTime;
+
+			if (TTK::ProgramBinaryCache::write(cacheFileName, cacheKey, handle, elapsed.count() * 1000.0))
+				std::cout << "ProgramBinaryCache: compiled and linked in " << elapsed.count() * 1000.0 << " ms, saved " << cacheFileName << std::endl;
+		}
+
+		reflectUniforms();
+		bindUniformBlocks();
+		numLinks++;
+		return handle;
+	}
+
+	// If shader failed to link, output the errors
+	// First need to get length of error message
+	int logLength;
+	glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &logLength);
+
+	// Make string for log
+	// Note: type of quotes is important
+	std::string log(logLength, ' ');
+
+	// Get error log from OpenGL and store into string
+	// Remember string is an array of characters internally
+	glGetProgramInfoLog(handle, logLength, &logLength, &log[0]);
+
+	// Output log to screen
+	std::cout << log << std::endl;
+
+	return 0;
 }
 
 void ShaderProgram::bind()
 {
-	glUseProgram(handle);
+	TTK::GLState::shared().useProgram(handle);
 }
 
 void ShaderProgram::unbind()
 {
-	glUseProgram(0);
+	TTK::GLState::shared().useProgram(0);
 }
 
 void ShaderProgram::sendUniformInt(const std::string& uniformName, int intVal)
 {
-	int uniformLocation = getUniformLocation(uniformName);
-	glUniform1i(uniformLocation, intVal);
+	sendUniformByName(uniformName, intVal);
 }
 
 void ShaderProgram::sendUniformVec4(const std::string& uniformName, glm::vec4& vec4)
 {
-	int uniformLocation = getUniformLocation(uniformName);
-	glUniform4fv(uniformLocation, 1, &vec4[0]);
+	sendUniformByName(uniformName, vec4);
 }
 
 void ShaderProgram::sendUniformMat4(const std::string& uniformName, glm::mat4& mat4)
 {
-	int uniformLocation = getUniformLocation(uniformName);
-	glUniformMatrix4fv(uniformLocation, 1, false, &mat4[0][0]);
+	sendUniformByName(uniformName, mat4);
 }
 
 void ShaderProgram::destroy()
 {
 	if (handle)
 	{
+		TTK::GLState::shared().forgetProgram(handle);
 		glDeleteProgram(handle);
 	}
+
+	uniforms.clear();
+	uniformIndices.clear();
+	attachedShaders.clear();
+	linkPending = false;
+}
+
+void ShaderProgram::reflectUniforms()
+{
+	uniforms.clear();
+	uniformIndices.clear();
+
+	int numUniforms = 0;
+	int maxNameLength = 0;
+	glGetProgramiv(handle, GL_ACTIVE_UNIFORMS, &numUniforms);
+	glGetProgramiv(handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> name(maxNameLength + 1);
+
+	for (int i = 0; i < numUniforms; i++)
+	{
+		UniformInfo info;
+		int nameLength = 0;
+		glGetActiveUniform(handle, i, name.size(), &nameLength, &info.arraySize, &info.type, &name[0]);
+
+		info.name.assign(&name[0], nameLength);
+		info.location = glGetUniformLocation(handle, info.name.c_str());
+		info.hasValue = false;
+
+		// Uniforms in blocks have no location, they are set through their buffer
+		if (info.location < 0)
+			continue;
+
+		// Arrays are listed as "name[0]", look them up by "name" like glGetUniformLocation does
+		size_t bracket = info.name.find('[');
+
+		if (bracket != std::string::npos)
+			info.name.erase(bracket);
+
+		uniformIndices[info.name] = uniforms.size();
+		uniforms.push_back(info);
+	}
+}
+
+void ShaderProgram::bindUniformBlocks()
+{
+	int numBlocks = 0;
+	glGetProgramiv(handle, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+
+	for (int i = 0; i < numBlocks; i++)
+	{
+		int nameLength = 0;
+		glGetActiveUniformBlockiv(handle, i, GL_UNIFORM_BLOCK_NAME_LENGTH, &nameLength);
+
+		std::string name(nameLength, '\0');
+		glGetActiveUniformBlockName(handle, i, nameLength, &nameLength, &name[0]);
+		name.resize(nameLength);
+
+		int binding = getUniformBlockBinding(name);
+
+		if (binding >= 0)
+			glUniformBlockBinding(handle, i, binding);
+		else
+			std::cout << "Shader program: no binding for uniform block " << name << std::endl;
+	}
+}
+
+int ShaderProgram::findUniform(const std::string& uniformName)
+{
+	auto itr = uniformIndices.find(uniformName);
+
+	if (itr == uniformIndices.end())
+		return -1;
+
+	return itr->second;
 }
 
 int ShaderProgram::getUniformLocation(const std::string& uniformName)
 {
-	return glGetUniformLocation(handle, uniformName.c_str());
+	int index = findUniform(uniformName);
+
+	if (index < 0)
+		return -1;
+
+	return uniforms[index].location;
 }
@@ -0,0 +1,195 @@
+#include "TTK/GLState.h"
+
+TTK::GLState::GLState()
+{
+	invalidate();
+	resetCounters();
+}
+
+TTK::GLState& TTK::GLState::shared()
+{
+	static GLState state;
+	return state;
+}
+
+bool TTK::GLState::changed(bool isDifferent)
+{
+	if (isDifferent)
+		numIssued++;
+	else
+		numElided++;
+
+	return isDifferent;
+}
+
+void TTK::GLState::useProgram(GLuint newProgram)
+{
+	if (changed(program != newProgram))
+	{
+		glUseProgram(newProgram);
+		program = newProgram;
+	}
+}
+
+void TTK::GLState::bindVertexArray(GLuint vao)
+{
+	if (changed(vertexArray != vao))
+	{
+		glBindVertexArray(vao);
+		vertexArray = vao;
+	}
+}
+
+void TTK::GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+	bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+
+	if (changed((draw && drawFramebuffer != framebuffer) || (read && readFramebuffer != framebuffer)))
+	{
+		glBindFramebuffer(target, framebuffer);
+
+		if (draw)
+			drawFramebuffer = framebuffer;
+		if (read)
+			readFramebuffer = framebuffer;
+	}
+}
+
+void TTK::GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (changed(viewportRect[0] != x || viewportRect[1] != y || viewportRect[2] != width || viewportRect[3] != height))
+	{
+		glViewport(x, y, width, height);
+		viewportRect[0] = x;
+		viewportRect[1] = y;
+		viewportRect[2] = width;
+		viewportRect[3] = height;
+	}
+}
+
+void TTK::GLState::activeTexture(GLenum unit)
+{
+	if (changed(activeUnit != unit))
+	{
+		glActiveTexture(unit);
+		activeUnit = unit;
+	}
+}
+
+void TTK::GLState::bindTexture(GLenum unit, GLenum target, GLuint texture)
+{
+	unsigned int index = unit - GL_TEXTURE0;
+
+	// Only 2D textures on the first few units are remembered
+	bool remembered = target == GL_TEXTURE_2D && index < MAX_TEXTURE_UNITS;
+
+	if (!changed(!remembered || textures[index] != texture))
+		return;
+
+	activeTexture(unit);
+	glBindTexture(target, texture);
+
+	if (remembered)
+		textures[index] = texture;
+}
+
+void TTK::GLState::bindTexture(GLenum target, GLuint texture)
+{
+	// Nothing to compare against if the active unit is unknown
+	if (activeUnit == UNKNOWN)
+	{
+		changed(true);
+		glBindTexture(target, texture);
+		return;
+	}
+
+	bindTexture(activeUnit, target, texture);
+}
+
+void TTK::GLState::enable(GLenum capability)
+{
+	setCapability(capability, true);
+}
+
+void TTK::GLState::disable(GLenum capability)
+{
+	setCapability(capability, false);
+}
+
+void TTK::GLState::setCapability(GLenum capability, bool enabled)
+{
+	auto itr = capabilities.find(capability);
+
+	if (!changed(itr == capabilities.end() || itr->second != enabled))
+		return;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+
+	capabilities[capability] = enabled;
+}
+
+void TTK::GLState::blendFunc(GLenum source, GLenum destination)
+{
+	if (changed(blendSource != source || blendDestination != destination))
+	{
+		glBlendFunc(source, destination);
+		blendSource = source;
+		blendDestination = destination;
+	}
+}
+
+void TTK::GLState::forgetProgram(GLuint oldProgram)
+{
+	if (program == oldProgram)
+		program = UNKNOWN;
+}
+
+void TTK::GLState::forgetVertexArray(GLuint vao)
+{
+	if (vertexArray == vao)
+		vertexArray = UNKNOWN;
+}
+
+void TTK::GLState::forgetFramebuffer(GLuint framebuffer)
+{
+	if (drawFramebuffer == framebuffer)
+		drawFramebuffer = UNKNOWN;
+	if (readFramebuffer == framebuffer)
+		readFramebuffer = UNKNOWN;
+}
+
+void TTK::GLState::forgetTexture(GLuint texture)
+{
+	for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		if (textures[i] == texture)
+			textures[i] = UNKNOWN;
+	}
+}
+
+void TTK::GLState::invalidate()
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	drawFramebuffer = UNKNOWN;
+	readFramebuffer = UNKNOWN;
+	viewportRect[0] = viewportRect[1] = -1;
+	viewportRect[2] = viewportRect[3] = -1;
+	activeUnit = UNKNOWN;
+	blendSource = UNKNOWN;
+	blendDestination = UNKNOWN;
+	capabilities.clear();
+
+	for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+		textures[i] = UNKNOWN;
+}
+
+void TTK::GLState::resetCounters()
+{
+	numIssued = 0;
+	numElided = 0;
+}
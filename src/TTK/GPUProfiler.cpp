@@ -0,0 +1,285 @@
+#include "TTK/GPUProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+// std::min takes its arguments by reference, which needs the constant defined somewhere
+const unsigned int TTK::GPUProfiler::HISTORY_SIZE;
+
+// Marks a zone begun outside beginFrame / endFrame or while disabled, so endZone still pairs up
+static const unsigned int NOT_RECORDED = 0xFFFFFFFF;
+
+TTK::GPUProfiler::GPUProfiler()
+{
+	enabled = false;
+	inFrame = false;
+	frameIndex = 0;
+	numDroppedFrames = 0;
+
+	for (unsigned int i = 0; i < MAX_FRAME_LATENCY; i++)
+		frames[i].numUsed = 0;
+}
+
+TTK::GPUProfiler::~GPUProfiler()
+{
+	destroy();
+}
+
+TTK::GPUProfiler& TTK::GPUProfiler::shared()
+{
+	static GPUProfiler profiler;
+	return profiler;
+}
+
+bool TTK::GPUProfiler::isSupported()
+{
+	return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+void TTK::GPUProfiler::setEnabled(bool enable)
+{
+	enabled = enable && isSupported();
+}
+
+void TTK::GPUProfiler::beginFrame()
+{
+	if (!enabled)
+		return;
+
+	frameIndex++;
+	FrameQueries& frame = frames[frameIndex % MAX_FRAME_LATENCY];
+
+	// These queries were issued MAX_FRAME_LATENCY frames ago, take their results before reusing them
+	if (frame.zones.size() > 0 && !collect(frame))
+		numDroppedFrames++;
+
+	frame.numUsed = 0;
+	frame.zones.clear();
+	openZones.clear();
+	inFrame = true;
+}
+
+void TTK::GPUProfiler::endFrame()
+{
+	if (!inFrame)
+		return;
+
+	if (openZones.size() > 0)
+	{
+		std::cout << "GPUProfiler: " << openZones.size() << " zone(s) not ended this frame" << std::endl;
+
+		while (openZones.size() > 0)
+			endZone();
+	}
+
+	inFrame = false;
+}
+
+void TTK::GPUProfiler::beginZone(const char* name)
+{
+	if (!inFrame)
+	{
+		openZones.push_back(NOT_RECORDED);
+		return;
+	}
+
+	FrameQueries& frame = frames[frameIndex % MAX_FRAME_LATENCY];
+
+	ZoneQuery zoneQuery;
+	zoneQuery.zone = findZone(name, openZones.size());
+	issueTimestamp(frame, zoneQuery.beginQuery);
+	zoneQuery.endQuery = zoneQuery.beginQuery;
+
+	openZones.push_back(frame.zones.size());
+	frame.zones.push_back(zoneQuery);
+}
+
+void TTK::GPUProfiler::endZone()
+{
+	if (openZones.size() == 0)
+		return;
+
+	unsigned int open = openZones.back();
+	openZones.pop_back();
+
+	if (open == NOT_RECORDED || !inFrame)
+		return;
+
+	FrameQueries& frame = frames[frameIndex % MAX_FRAME_LATENCY];
+	issueTimestamp(frame, frame.zones[open].endQuery);
+}
+
+std::vector<TTK::GPUZoneStats> TTK::GPUProfiler::getStats()
+{
+	std::vector<GPUZoneStats> stats;
+	std::vector<float> sorted;
+
+	for (unsigned int i = 0; i < zones.size(); i++)
+	{
+		Zone& zone = zones[i];
+
+		GPUZoneStats zoneStats;
+		zoneStats.name = zone.name;
+		zoneStats.depth = zone.depth;
+		zoneStats.numSamples = std::min(zone.numSamples, HISTORY_SIZE);
+		zoneStats.average = zoneStats.median = zoneStats.p95 = zoneStats.p99 = zoneStats.max = 0.0;
+
+		if (zoneStats.numSamples > 0)
+		{
+			sorted.assign(zone.history.begin(), zone.history.begin() + zoneStats.numSamples);
+			std::sort(sorted.begin(), sorted.end());
+
+			double total = 0.0;
+
+			for (unsigned int j = 0; j < sorted.size(); j++)
+				total += sorted[j];
+
+			// Nearest rank
+			unsigned int n = sorted.size();
+			zoneStats.average = total / n;
+			zoneStats.median = sorted[(n - 1) / 2];
+			zoneStats.p95 = sorted[std::min(n - 1, (unsigned int)(n * 0.95))];
+			zoneStats.p99 = sorted[std::min(n - 1, (unsigned int)(n * 0.99))];
+			zoneStats.max = sorted[n - 1];
+		}
+
+		stats.push_back(zoneStats);
+	}
+
+	return stats;
+}
+
+void TTK::GPUProfiler::printReport(std::ostream& out)
+{
+	std::vector<GPUZoneStats> stats = getStats();
+
+	out << "GPU times (ms) over the last " << HISTORY_SIZE << " frames, " << numDroppedFrames << " frame(s) dropped" << std::endl;
+	out << std::left << std::setw(24) << "zone" << std::right
+		<< std::setw(9) << "average" << std::setw(9) << "median" << std::setw(9) << "p95"
+		<< std::setw(9) << "p99" << std::setw(9) << "max" << std::setw(9) << "samples" << std::endl;
+
+	std::ios::fmtflags flags = out.flags();
+	out << std::fixed << std::setprecision(3);
+
+	for (unsigned int i = 0; i < stats.size(); i++)
+	{
+		std::string name = std::string(stats[i].depth * 2, ' ') + stats[i].name;
+
+		out << std::left << std::setw(24) << name << std::right
+			<< std::setw(9) << stats[i].average << std::setw(9) << stats[i].median << std::setw(9) << stats[i].p95
+			<< std::setw(9) << stats[i].p99 << std::setw(9) << stats[i].max << std::setw(9) << stats[i].numSamples << std::endl;
+	}
+
+	out.flags(flags);
+}
+
+bool TTK::GPUProfiler::writeCSV(const std::string& fileName)
+{
+	std::ofstream file(fileName);
+
+	if (!file.is_open())
+	{
+		std::cout << "GPUProfiler Error: Cannot write file: " << fileName << std::endl;
+		return false;
+	}
+
+	std::vector<GPUZoneStats> stats = getStats();
+
+	file << "zone,depth,samples,average_ms,median_ms,p95_ms,p99_ms,max_ms" << std::endl;
+
+	for (unsigned int i = 0; i < stats.size(); i++)
+	{
+		file << stats[i].name << "," << stats[i].depth << "," << stats[i].numSamples << ","
+			<< stats[i].average << "," << stats[i].median << "," << stats[i].p95 << ","
+			<< stats[i].p99 << "," << stats[i].max << std::endl;
+	}
+
+	return file.good();
+}
+
+void TTK::GPUProfiler::destroy()
+{
+	for (unsigned int i = 0; i < MAX_FRAME_LATENCY; i++)
+	{
+		if (frames[i].queries.size() > 0)
+			glDeleteQueries(frames[i].queries.size(), &frames[i].queries[0]);
+
+		frames[i].queries.clear();
+		frames[i].zones.clear();
+		frames[i].numUsed = 0;
+	}
+
+	zones.clear();
+	zoneIndices.clear();
+	openZones.clear();
+	inFrame = false;
+}
+
+unsigned int TTK::GPUProfiler::findZone(const char* name, unsigned int depth)
+{
+	auto itr = zoneIndices.find(name);
+
+	if (itr != zoneIndices.end())
+		return itr->second;
+
+	Zone zone;
+	zone.name = name;
+	zone.depth = depth;
+	zone.history.resize(HISTORY_SIZE);
+	zone.numSamples = 0;
+
+	zoneIndices[name] = zones.size();
+	zones.push_back(zone);
+
+	return zones.size() - 1;
+}
+
+GLuint TTK::GPUProfiler::issueTimestamp(FrameQueries& frame, unsigned int& queryIndex)
+{
+	if (frame.numUsed == frame.queries.size())
+	{
+		GLuint query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+
+	queryIndex = frame.numUsed++;
+
+	// Written when the GPU gets to this point in the command stream
+	glQueryCounter(frame.queries[queryIndex], GL_TIMESTAMP);
+
+	return frame.queries[queryIndex];
+}
+
+bool TTK::GPUProfiler::collect(FrameQueries& frame)
+{
+	if (frame.numUsed == 0)
+		return true;
+
+	// Queries finish in order, once the last one is in they all are
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.numUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if (!available)
+		return false;
+
+	for (unsigned int i = 0; i < frame.zones.size(); i++)
+	{
+		ZoneQuery& zoneQuery = frame.zones[i];
+
+		// Never ended
+		if (zoneQuery.endQuery == zoneQuery.beginQuery)
+			continue;
+
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(frame.queries[zoneQuery.beginQuery], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[zoneQuery.endQuery], GL_QUERY_RESULT, &end);
+
+		// Nanoseconds
+		Zone& zone = zones[zoneQuery.zone];
+		zone.history[zone.numSamples % HISTORY_SIZE] = (float)((end - begin) / 1000000.0);
+		zone.numSamples++;
+	}
+
+	return true;
+}
@@ -0,0 +1,189 @@
+#include "TTK/GeometryArena.h"
+#include "TTK/GLState.h"
+#include "VertexLayout.h"
+#include <iostream>
+#include <algorithm>
+
+TTK::GeometryArena::GeometryArena(unsigned int verticesPerBlock, unsigned int indicesPerBlock)
+	: verticesPerBlock(verticesPerBlock),
+	indicesPerBlock(indicesPerBlock)
+{
+}
+
+TTK::GeometryArena::~GeometryArena()
+{
+	destroy();
+}
+
+TTK::GeometryArena& TTK::GeometryArena::shared()
+{
+	static GeometryArena arena;
+	return arena;
+}
+
+bool TTK::GeometryArena::addMesh(const MeshBase* mesh)
+{
+	if (!mesh || mesh->vertices.size() == 0 || meshes.count(mesh))
+		return false;
+
+	unsigned int numVertices = mesh->vertices.size();
+	unsigned int numIndices = mesh->indices.size() > 0 ? mesh->indices.size() : numVertices;
+
+	// Everything goes in as plain floats, so one VAO can read every mesh
+	std::vector<VertexPositionNormalUV> vertexData(numVertices);
+	bool hasNormals = mesh->normals.size() == numVertices;
+	bool hasTexCoords = mesh->textureCoordinates.size() == numVertices;
+
+	for (unsigned int i = 0; i < numVertices; i++)
+	{
+		vertexData[i].position = mesh->vertices[i];
+		vertexData[i].normal = hasNormals ? mesh->normals[i] : glm::vec3(0.0f);
+		vertexData[i].uv = hasTexCoords ? mesh->textureCoordinates[i] : glm::vec2(0.0f);
+	}
+
+	// Non indexed meshes just count up
+	std::vector<unsigned int> sequentialIndices;
+	const unsigned int* indexData = mesh->indices.size() > 0 ? &mesh->indices[0] : nullptr;
+
+	if (!indexData)
+	{
+		sequentialIndices.resize(numIndices);
+
+		for (unsigned int i = 0; i < numIndices; i++)
+			sequentialIndices[i] = i;
+
+		indexData = &sequentialIndices[0];
+	}
+
+	unsigned int blockIndex = allocateBlock(numVertices, numIndices);
+	Block& block = blocks[blockIndex];
+
+	ArenaMesh& arenaMesh = meshes[mesh];
+	arenaMesh.block = blockIndex;
+	arenaMesh.baseVertex = block.numVertices;
+	arenaMesh.firstIndex = block.numIndices;
+	arenaMesh.numIndices = numIndices;
+	arenaMesh.lods = mesh->lods;
+
+	glBindBuffer(GL_ARRAY_BUFFER, block.vboHandle);
+	glBufferSubData(GL_ARRAY_BUFFER, (size_t)block.numVertices * sizeof(VertexPositionNormalUV),
+		(size_t)numVertices * sizeof(VertexPositionNormalUV), &vertexData[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Same as VertexBufferObject::uploadIndexRange, the copy target leaves the bound VAO alone
+	glBindBuffer(GL_COPY_WRITE_BUFFER, block.iboHandle);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)block.numIndices * sizeof(unsigned int),
+		(size_t)numIndices * sizeof(unsigned int), indexData);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	block.numVertices += numVertices;
+	block.numIndices += numIndices;
+
+	return true;
+}
+
+void TTK::GeometryArena::removeMesh(const MeshBase* mesh)
+{
+	meshes.erase(mesh);
+}
+
+const TTK::ArenaMesh* TTK::GeometryArena::findMesh(const MeshBase* mesh)
+{
+	auto itr = meshes.find(mesh);
+
+	if (itr == meshes.end())
+		return nullptr;
+
+	return &itr->second;
+}
+
+void TTK::GeometryArena::getLODRange(const ArenaMesh& mesh, unsigned int level, unsigned int& firstIndex, unsigned int& numIndices)
+{
+	if (mesh.lods.size() == 0)
+	{
+		firstIndex = mesh.firstIndex;
+		numIndices = mesh.numIndices;
+		return;
+	}
+
+	const MeshLOD& lod = mesh.lods[std::min(level, (unsigned int)mesh.lods.size() - 1)];
+	firstIndex = mesh.firstIndex + lod.firstIndex;
+	numIndices = lod.numIndices;
+}
+
+void TTK::GeometryArena::bindBlock(unsigned int block)
+{
+	if (block < blocks.size())
+		GLState::shared().bindVertexArray(blocks[block].vaoHandle);
+}
+
+size_t TTK::GeometryArena::getBytesUsed()
+{
+	size_t bytes = 0;
+
+	for (unsigned int i = 0; i < blocks.size(); i++)
+		bytes += (size_t)blocks[i].numVertices * sizeof(VertexPositionNormalUV) + (size_t)blocks[i].numIndices * sizeof(unsigned int);
+
+	return bytes;
+}
+
+unsigned int TTK::GeometryArena::allocateBlock(unsigned int numVertices, unsigned int numIndices)
+{
+	for (unsigned int i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i].numVertices + numVertices <= blocks[i].vertexCapacity &&
+			blocks[i].numIndices + numIndices <= blocks[i].indexCapacity)
+			return i;
+	}
+
+	Block block;
+	block.vertexCapacity = std::max(verticesPerBlock, numVertices);
+	block.indexCapacity = std::max(indicesPerBlock, numIndices);
+	block.numVertices = 0;
+	block.numIndices = 0;
+
+	glGenVertexArrays(1, &block.vaoHandle);
+	GLState::shared().bindVertexArray(block.vaoHandle);
+
+	glGenBuffers(1, &block.vboHandle);
+	glBindBuffer(GL_ARRAY_BUFFER, block.vboHandle);
+	glBufferData(GL_ARRAY_BUFFER, (size_t)block.vertexCapacity * sizeof(VertexPositionNormalUV), nullptr, GL_STATIC_DRAW);
+
+	const VertexElement* elements = VertexLayout<VertexPositionNormalUV>::getElements();
+
+	for (unsigned int i = 0; i < VertexLayout<VertexPositionNormalUV>::numElements; i++)
+	{
+		glEnableVertexAttribArray(elements[i].attributeLocation);
+		glVertexAttribPointer(elements[i].attributeLocation, elements[i].numComponents, elements[i].elementType,
+			elements[i].normalized ? GL_TRUE : GL_FALSE, sizeof(VertexPositionNormalUV), (const void*)(size_t)elements[i].offset);
+	}
+
+	// The element array binding is stored in the VAO
+	glGenBuffers(1, &block.iboHandle);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.iboHandle);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)block.indexCapacity * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+
+	GLState::shared().bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	std::cout << "GeometryArena: new block " << blocks.size() << ", " << block.vertexCapacity << " vertices, "
+		<< block.indexCapacity << " indices" << std::endl;
+
+	blocks.push_back(block);
+	return blocks.size() - 1;
+}
+
+void TTK::GeometryArena::destroy()
+{
+	for (unsigned int i = 0; i < blocks.size(); i++)
+	{
+		GLState::shared().forgetVertexArray(blocks[i].vaoHandle);
+		glDeleteVertexArrays(1, &blocks[i].vaoHandle);
+		glDeleteBuffers(1, &blocks[i].vboHandle);
+		glDeleteBuffers(1, &blocks[i].iboHandle);
+	}
+
+	blocks.clear();
+	meshes.clear();
+}
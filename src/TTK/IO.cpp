@@ -1,6 +1,16 @@
 #include <TTK/IO.h>
 #include <iostream>
 #include <fstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
 
 std::string TTK::IO::loadFile(std::string fileName)
 {
@@ -38,3 +48,38 @@ std::string TTK::IO::loadFile(std::string fileName)
 	 return ret;
 }
 
+bool TTK::IO::getFileInfo(std::string fileName, unsigned long long& size, unsigned long long& modifiedTime)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(fileName.c_str(), &info) != 0)
+		return false;
+#else
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0)
+		return false;
+#endif
+
+	size = (unsigned long long)info.st_size;
+	modifiedTime = (unsigned long long)info.st_mtime;
+	return true;
+}
+
+size_t TTK::IO::getPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss; // bytes on macOS
+#else
+	return (size_t)usage.ru_maxrss * 1024; // kilobytes on Linux
+#endif
+#endif
+}
@@ -0,0 +1,174 @@
+#include "TTK/MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+TTK::MappedFile::MappedFile()
+{
+	dataPtr = nullptr;
+	fileSize = 0;
+	opened = false;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+#else
+	fileDescriptor = -1;
+#endif
+}
+
+TTK::MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool TTK::MappedFile::open(std::string fileName)
+{
+	close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(fileHandle, &size))
+	{
+		close();
+		return false;
+	}
+
+	fileSize = (size_t)size.QuadPart;
+
+	// Windows refuses to map zero length files
+	if (fileSize > 0)
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (mappingHandle == nullptr)
+		{
+			std::cout << "MappedFile Error: Cannot map file: " << fileName << std::endl;
+			close();
+			return false;
+		}
+
+		dataPtr = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileInfo;
+	if (fstat(fileDescriptor, &fileInfo) != 0)
+	{
+		close();
+		return false;
+	}
+
+	fileSize = (size_t)fileInfo.st_size;
+
+	// mmap refuses to map zero length files
+	if (fileSize > 0)
+	{
+		void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+		if (mapping != MAP_FAILED)
+		{
+			// We read front to back, let the kernel read ahead aggressively
+			madvise(mapping, fileSize, MADV_SEQUENTIAL);
+			dataPtr = (const char*)mapping;
+		}
+	}
+#endif
+
+	if (fileSize > 0 && dataPtr == nullptr)
+	{
+		std::cout << "MappedFile Error: Cannot map file: " << fileName << std::endl;
+		close();
+		return false;
+	}
+
+	opened = true;
+	return true;
+}
+
+void TTK::MappedFile::close()
+{
+#ifdef _WIN32
+	if (dataPtr)
+		UnmapViewOfFile(dataPtr);
+
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (dataPtr)
+		munmap((void*)dataPtr, fileSize);
+
+	if (fileDescriptor >= 0)
+		::close(fileDescriptor);
+
+	fileDescriptor = -1;
+#endif
+
+	dataPtr = nullptr;
+	fileSize = 0;
+	opened = false;
+}
+
+bool TTK::MappedFile::isOpen()
+{
+	return opened;
+}
+
+const char* TTK::MappedFile::data()
+{
+	return dataPtr;
+}
+
+size_t TTK::MappedFile::size()
+{
+	return fileSize;
+}
+
+void TTK::MappedFile::release(const char* begin, const char* end)
+{
+	const size_t pageSize = 4096;
+
+	if (!dataPtr || begin >= end)
+		return;
+
+	// Only whole pages can be released, shrink the range to page boundaries
+	size_t first = ((begin - dataPtr) + pageSize - 1) & ~(pageSize - 1);
+	size_t last = (end - dataPtr) & ~(pageSize - 1);
+
+	if (end == dataPtr + fileSize)
+		last = fileSize;
+
+	if (first >= last)
+		return;
+
+#ifdef _WIN32
+	// Unlocking pages which are not locked removes them from the working set
+	VirtualUnlock((void*)(dataPtr + first), last - first);
+#else
+	madvise((void*)(dataPtr + first), last - first, MADV_DONTNEED);
+#endif
+}
@@ -1,10 +1,51 @@
 #include "TTK/MeshBase.h"
+#include "TTK/GLState.h"
 #include "GLUT/glut.h"
 #include <iostream>
+#include <algorithm>
+
+TTK::MeshBase::MeshBase()
+	: primitiveType(Triangles),
+	boundsMin(0.0f),
+	boundsMax(0.0f),
+	positionScale(1.0f),
+	positionOffset(0.0f)
+{
+}
 
 void TTK::MeshBase::draw()
 {
-	vbo.draw();
+	drawLOD(0);
+}
+
+void TTK::MeshBase::drawLOD(unsigned int level)
+{
+	if (!isUploaded())
+		return;
+
+	if (lods.size() == 0)
+	{
+		vbo.draw();
+		return;
+	}
+
+	const MeshLOD& lod = lods[std::min(level, (unsigned int)lods.size() - 1)];
+	vbo.drawRange(lod.firstIndex, lod.numIndices);
+}
+
+void TTK::MeshBase::drawLODInstanced(unsigned int level, unsigned int instanceCount)
+{
+	if (!isUploaded())
+		return;
+
+	if (lods.size() == 0)
+	{
+		vbo.drawInstanced(instanceCount);
+		return;
+	}
+
+	const MeshLOD& lod = lods[std::min(level, (unsigned int)lods.size() - 1)];
+	vbo.drawRangeInstanced(lod.firstIndex, lod.numIndices, instanceCount);
 }
 
 void TTK::MeshBase::draw_1_0()
@@ -36,8 +77,8 @@ void TTK::MeshBase::draw_1_0()
 		}
 	}
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLState::shared().enable(GL_BLEND);
+	GLState::shared().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_ADD);
 
 	if (primitiveType == TTK::PrimitiveType::Quads)
@@ -45,8 +86,12 @@ void TTK::MeshBase::draw_1_0()
 	else
 		glBegin(GL_TRIANGLES);
 
-	for (unsigned int i = 0; i < vertices.size(); i++)
+	unsigned int numCorners = indices.size() > 0 ? indices.size() : vertices.size();
+
+	for (unsigned int corner = 0; corner < numCorners; corner++)
 	{
+		unsigned int i = indices.size() > 0 ? indices[corner] : corner;
+
 		glTexCoord2f(textureCoordinates[i].x, textureCoordinates[i].y);
 
 		if (useColours)
@@ -60,7 +105,7 @@ void TTK::MeshBase::draw_1_0()
 
 	glEnd();
 
-	glDisable(GL_BLEND);
+	GLState::shared().disable(GL_BLEND);
 }
 
 void TTK::MeshBase::setAllColours(glm::vec4 colour)
@@ -71,56 +116,141 @@ void TTK::MeshBase::setAllColours(glm::vec4 colour)
 	}
 }
 
+void TTK::MeshBase::computeBounds()
+{
+	if (vertices.size() == 0)
+	{
+		boundsMin = boundsMax = glm::vec3(0.0f);
+		return;
+	}
+
+	boundsMin = boundsMax = vertices[0];
+
+	for (unsigned int i = 1; i < vertices.size(); i++)
+	{
+		boundsMin = glm::min(boundsMin, vertices[i]);
+		boundsMax = glm::max(boundsMax, vertices[i]);
+	}
+}
+
+void TTK::MeshBase::addAttribute(AttributeLocations location, std::string name, void* data, unsigned int numVertices, unsigned int numComponents)
+{
+	AttributeDescriptor attrib;
+	attrib.attributeLocation = location;
+	attrib.attributeName = name;
+	attrib.data = data;
+	attrib.elementSize = sizeof(float);
+	attrib.elementType = GL_FLOAT;
+	attrib.numElements = numVertices * numComponents;
+	attrib.numElementsPerAttrib = numComponents;
+	vbo.addAttributeArray(attrib);
+}
+
 void TTK::MeshBase::createVBO()
 {
-	int numTris = vertices.size() / 3; // todo: handle non-triangulated meshes
+	prepareVBO();
+	vbo.createVBO();
+	freePackedArrays();
+}
+
+void TTK::MeshBase::prepareVBO()
+{
+	int numVertices = vertices.size();
 
 	// Setup VBO
-	
+
+	AttributeDescriptor packed;
+	updatePositionQuantization();
+
 	// Set up position (vertex) attribute
-	if (vertices.size() > 0)
+	if (vertices.size() > 0 && vertexFormat.positions == POSITION_FLOAT)
+		addAttribute(AttributeLocations::VERTEX, "vertex", &vertices[0], numVertices, 3);
+	else if (vertices.size() > 0)
 	{
-		AttributeDescriptor positionAttrib;
-		positionAttrib.attributeLocation = AttributeLocations::VERTEX;
-		positionAttrib.attributeName = "vertex";
-		positionAttrib.data = &vertices[0];
-		positionAttrib.elementSize = sizeof(float);
-		positionAttrib.elementType = GL_FLOAT;
-		positionAttrib.numElements = numTris * 3 * 3; // (num triangles * three vertices per triangle * three floats per vertex)
-		positionAttrib.numElementsPerAttrib = 3;
-		vbo.addAttributeArray(positionAttrib);
-
+		VertexPacking::packPositions(vertices, vertexFormat.positions, positionScale, positionOffset, packedPositions, packed);
+		vbo.addAttributeArray(packed);
 	}
 
 	// Set up UV attribute
-	if (textureCoordinates.size() > 0)
+	if (textureCoordinates.size() > 0 && vertexFormat.texCoords == TEX_COORD_FLOAT)
+		addAttribute(AttributeLocations::TEX_COORD, "uv", &textureCoordinates[0], numVertices, 2);
+	else if (textureCoordinates.size() > 0)
 	{
-		AttributeDescriptor uvAttrib;
-		uvAttrib.attributeLocation = AttributeLocations::TEX_COORD;
-		uvAttrib.attributeName = "uv";
-		uvAttrib.data = &textureCoordinates[0];
-		uvAttrib.elementSize = sizeof(float);
-		uvAttrib.elementType = GL_FLOAT;
-		uvAttrib.numElements = numTris * 3 * 2;
-		uvAttrib.numElementsPerAttrib = 2;
-		vbo.addAttributeArray(uvAttrib);
+		VertexPacking::packTexCoords(textureCoordinates, vertexFormat.texCoords, packedTexCoords, packed);
+		vbo.addAttributeArray(packed);
 	}
 
 	// Set up normal attribute
-	if (normals.size() > 0)
+	if (normals.size() > 0 && vertexFormat.normals == NORMAL_FLOAT)
+		addAttribute(AttributeLocations::NORMAL, "normal", &normals[0], numVertices, 3);
+	else if (normals.size() > 0)
 	{
-		AttributeDescriptor normalAttrib;
-		normalAttrib.attributeLocation = AttributeLocations::NORMAL;
-		normalAttrib.attributeName = "normal";
-		normalAttrib.data = &normals[0];
-		normalAttrib.elementSize = sizeof(float);
-		normalAttrib.elementType = GL_FLOAT;
-		normalAttrib.numElements = numTris * 3 * 3;
-		normalAttrib.numElementsPerAttrib = 3;
-		vbo.addAttributeArray(normalAttrib);
+		VertexPacking::packNormals(normals, vertexFormat.normals, packedNormals, packed);
+		vbo.addAttributeArray(packed);
 	}
 
 	// set up other attributes...
 
-	vbo.createVBO();
+	// Set up index array
+	if (indices.size() > 0)
+	{
+		vbo.setIndexArray(&indices[0], indices.size());
+	}
+
+	// Does nothing unless vbo.setInterleaved(true) was called
+	vbo.interleaveAttributes();
+}
+
+void TTK::MeshBase::updatePositionQuantization()
+{
+	VertexPacking::getPositionQuantization(vertexFormat.positions, boundsMin, boundsMax, positionScale, positionOffset);
+}
+
+void TTK::MeshBase::freePackedArrays()
+{
+	// Don't leave the vbo pointing at them
+	const std::vector<AttributeDescriptor>& attributes = vbo.getAttributeDescriptors();
+
+	for (unsigned int i = 0; i < attributes.size(); i++)
+	{
+		const void* data = attributes[i].data;
+
+		if (data && (data == packedPositions.data() || data == packedNormals.data() || data == packedTexCoords.data()))
+			vbo.setAttributeData(i, nullptr);
+	}
+
+	std::vector<unsigned char>().swap(packedPositions);
+	std::vector<unsigned char>().swap(packedNormals);
+	std::vector<unsigned char>().swap(packedTexCoords);
+}
+
+void TTK::MeshBase::swapData(MeshBase& other)
+{
+	vertices.swap(other.vertices);
+	normals.swap(other.normals);
+	textureCoordinates.swap(other.textureCoordinates);
+	colours.swap(other.colours);
+	indices.swap(other.indices);
+	lods.swap(other.lods);
+	std::swap(primitiveType, other.primitiveType);
+	std::swap(boundsMin, other.boundsMin);
+	std::swap(boundsMax, other.boundsMax);
+	std::swap(vertexFormat, other.vertexFormat);
+	std::swap(positionScale, other.positionScale);
+	std::swap(positionOffset, other.positionOffset);
+	packedPositions.swap(other.packedPositions);
+	packedNormals.swap(other.packedNormals);
+	packedTexCoords.swap(other.packedTexCoords);
+	vbo.swap(other.vbo);
+}
+
+void TTK::MeshBase::freeCPUData()
+{
+	std::vector<glm::vec3>().swap(vertices);
+	std::vector<glm::vec3>().swap(normals);
+	std::vector<glm::vec2>().swap(textureCoordinates);
+	std::vector<glm::vec4>().swap(colours);
+	std::vector<unsigned int>().swap(indices);
+	freePackedArrays();
+	vbo.releaseSourceData();
 }
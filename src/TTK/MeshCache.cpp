@@ -0,0 +1,449 @@
+#include "TTK/MeshCache.h"
+#include "TTK/MappedFile.h"
+#include "TTK/IO.h"
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+
+// On disk layout:
+//   FileHeader
+//   FileAttribute * numAttributes
+//   FileLOD * numLODs
+//   attribute arrays and index array, each starting on a 16 byte boundary
+// Everything is stored in the byte order of the machine that wrote it.
+
+typedef struct
+{
+	char magic[8];					// "TTKMESH"
+	unsigned int version;
+	unsigned int contentFlags;
+	unsigned long long sourceSize;
+	unsigned long long sourceModifiedTime;
+	unsigned long long sourceHash;
+	unsigned int numAttributes;
+	unsigned int numVertices;
+	unsigned int numIndices;
+	unsigned int indexType;			// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	unsigned long long indexOffset;	// From start of file
+	float boundsMin[3];
+	float boundsMax[3];
+	unsigned int numLODs;
+	unsigned int reserved;
+}FileHeader;
+
+typedef struct
+{
+	unsigned int attributeLocation;
+	unsigned int elementType;
+	unsigned int elementSize;
+	unsigned int numElementsPerAttrib;
+	unsigned int numElements;
+	unsigned int normalized;
+	unsigned long long dataOffset;	// From start of file
+	char attributeName[32];
+}FileAttribute;
+
+typedef struct
+{
+	unsigned int firstIndex;
+	unsigned int numIndices;
+	float error;
+	unsigned int padding;
+}FileLOD;
+
+static_assert(sizeof(FileHeader) == 96, "FileHeader layout changed, bump MeshCache::VERSION");
+static_assert(sizeof(FileAttribute) == 64, "FileAttribute layout changed, bump MeshCache::VERSION");
+static_assert(sizeof(FileLOD) == 16, "FileLOD layout changed, bump MeshCache::VERSION");
+
+static const char cacheMagic[8] = { 'T', 'T', 'K', 'M', 'E', 'S', 'H', '\0' };
+
+static inline unsigned long long alignOffset(unsigned long long offset)
+{
+	return (offset + 15) & ~15ull;
+}
+
+// 64-bit FNV-1a
+static unsigned long long hashBytes(const char* data, size_t size)
+{
+	unsigned long long hash = 14695981039346656037ull;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+std::string TTK::MeshCache::getCacheFileName(std::string sourceFileName)
+{
+	return sourceFileName + ".ttkmesh";
+}
+
+bool TTK::MeshCache::makeKey(std::string sourceFileName, bool hashContents, unsigned int contentFlags, MeshCacheKey& key)
+{
+	if (!TTK::IO::getFileInfo(sourceFileName, key.sourceSize, key.sourceModifiedTime))
+		return false;
+
+	key.contentFlags = contentFlags;
+	key.sourceHash = 0;
+
+	if (hashContents)
+	{
+		MappedFile file;
+		if (!file.open(sourceFileName))
+			return false;
+
+		key.sourceHash = hashBytes(file.data(), file.size());
+	}
+
+	return true;
+}
+
+bool TTK::MeshCache::write(std::string cacheFileName, const MeshCacheKey& key, MeshBase& mesh)
+{
+	const std::vector<AttributeDescriptor>& attributes = mesh.vbo.getAttributeDescriptors();
+
+	if (attributes.size() == 0)
+		return false;
+
+	// Indices are stored in the same width the GPU got
+	std::vector<unsigned short> shortIndices;
+	const void* indexData = nullptr;
+	unsigned int indexSize = 0;
+
+	if (mesh.indices.size() > 0)
+	{
+		if (mesh.vbo.getIndexType() == GL_UNSIGNED_SHORT)
+		{
+			shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+			indexData = &shortIndices[0];
+			indexSize = sizeof(unsigned short);
+		}
+		else
+		{
+			indexData = &mesh.indices[0];
+			indexSize = sizeof(unsigned int);
+		}
+	}
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = VERSION;
+	header.contentFlags = key.contentFlags;
+	header.sourceSize = key.sourceSize;
+	header.sourceModifiedTime = key.sourceModifiedTime;
+	header.sourceHash = key.sourceHash;
+	header.numAttributes = attributes.size();
+	header.numVertices = mesh.vbo.getNumVertices();
+	header.numIndices = mesh.indices.size();
+	header.indexType = mesh.vbo.getIndexType();
+	memcpy(header.boundsMin, &mesh.boundsMin[0], sizeof(header.boundsMin));
+	memcpy(header.boundsMax, &mesh.boundsMax[0], sizeof(header.boundsMax));
+	header.numLODs = mesh.lods.size();
+
+	std::vector<FileLOD> fileLODs(mesh.lods.size());
+
+	for (unsigned int i = 0; i < mesh.lods.size(); i++)
+	{
+		memset(&fileLODs[i], 0, sizeof(FileLOD));
+		fileLODs[i].firstIndex = mesh.lods[i].firstIndex;
+		fileLODs[i].numIndices = mesh.lods[i].numIndices;
+		fileLODs[i].error = mesh.lods[i].error;
+	}
+
+	// Lay out the data blocks after the attribute and LOD tables
+	std::vector<FileAttribute> fileAttributes(attributes.size());
+	unsigned long long offset = sizeof(FileHeader) + sizeof(FileAttribute) * attributes.size() + sizeof(FileLOD) * fileLODs.size();
+
+	for (unsigned int i = 0; i < attributes.size(); i++)
+	{
+		const AttributeDescriptor& attrib = attributes[i];
+		FileAttribute& fileAttrib = fileAttributes[i];
+
+		memset(&fileAttrib, 0, sizeof(fileAttrib));
+		fileAttrib.attributeLocation = attrib.attributeLocation;
+		fileAttrib.elementType = attrib.elementType;
+		fileAttrib.elementSize = attrib.elementSize;
+		fileAttrib.numElementsPerAttrib = attrib.numElementsPerAttrib;
+		fileAttrib.numElements = attrib.numElements;
+		fileAttrib.normalized = attrib.normalized ? 1 : 0;
+		strncpy(fileAttrib.attributeName, attrib.attributeName.c_str(), sizeof(fileAttrib.attributeName) - 1);
+
+		offset = alignOffset(offset);
+		fileAttrib.dataOffset = offset;
+		offset += (unsigned long long)attrib.numElements * attrib.elementSize;
+	}
+
+	offset = alignOffset(offset);
+	header.indexOffset = offset;
+
+	// Write to a temporary file first so a crash never leaves a half written cache behind
+	std::string tempFileName = cacheFileName + ".tmp";
+	std::ofstream file(tempFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "MeshCache Error: Cannot write file: " << cacheFileName << std::endl;
+		return false;
+	}
+
+	const char padding[16] = { 0 };
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&fileAttributes[0], sizeof(FileAttribute) * fileAttributes.size());
+
+	if (fileLODs.size() > 0)
+		file.write((const char*)&fileLODs[0], sizeof(FileLOD) * fileLODs.size());
+
+	for (unsigned int i = 0; i < attributes.size(); i++)
+	{
+		file.write(padding, fileAttributes[i].dataOffset - file.tellp());
+		file.write((const char*)attributes[i].data, (size_t)attributes[i].numElements * attributes[i].elementSize);
+	}
+
+	file.write(padding, header.indexOffset - file.tellp());
+
+	if (indexData)
+		file.write((const char*)indexData, (size_t)header.numIndices * indexSize);
+
+	bool ok = file.good();
+	file.close();
+
+	if (ok)
+	{
+		remove(cacheFileName.c_str());
+		ok = rename(tempFileName.c_str(), cacheFileName.c_str()) == 0;
+	}
+
+	if (!ok)
+	{
+		std::cout << "MeshCache Error: Cannot write file: " << cacheFileName << std::endl;
+		remove(tempFileName.c_str());
+	}
+
+	return ok;
+}
+
+// Maps a cache file and checks it against the key and its own size.
+// On success header is filled and file stays open.
+static bool openCacheFile(std::string cacheFileName, const TTK::MeshCacheKey& key, TTK::MappedFile& file, FileHeader& header)
+{
+	if (!file.open(cacheFileName) || file.size() < sizeof(FileHeader))
+		return false;
+
+	const char* fileData = file.data();
+	unsigned long long fileSize = file.size();
+
+	memcpy(&header, fileData, sizeof(header));
+
+	if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != TTK::MeshCache::VERSION)
+		return false;
+
+	// Stale cache, source has changed or was loaded with different settings
+	if (header.contentFlags != key.contentFlags ||
+		header.sourceSize != key.sourceSize ||
+		header.sourceModifiedTime != key.sourceModifiedTime ||
+		header.sourceHash != key.sourceHash)
+		return false;
+
+	unsigned long long tableEnd = sizeof(FileHeader) + (unsigned long long)sizeof(FileAttribute) * header.numAttributes
+		+ (unsigned long long)sizeof(FileLOD) * header.numLODs;
+	unsigned int indexSize = header.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	if (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)
+		return false;
+
+	if (header.numAttributes == 0 || tableEnd > fileSize ||
+		header.indexOffset + (unsigned long long)header.numIndices * indexSize > fileSize)
+		return false;
+
+	const FileAttribute* fileAttributes = (const FileAttribute*)(fileData + sizeof(FileHeader));
+
+	for (unsigned int i = 0; i < header.numAttributes; i++)
+	{
+		const FileAttribute& fileAttrib = fileAttributes[i];
+
+		// The vertex count is numElements / numElementsPerAttrib, a zero here would divide by it
+		if (fileAttrib.numElementsPerAttrib == 0 || fileAttrib.numElementsPerAttrib > 4 ||
+			(fileAttrib.elementSize != 1 && fileAttrib.elementSize != 2 && fileAttrib.elementSize != 4) ||
+			fileAttrib.numElements % fileAttrib.numElementsPerAttrib != 0 ||
+			fileAttrib.numElements / fileAttrib.numElementsPerAttrib != header.numVertices)
+			return false;
+
+		if (fileAttrib.dataOffset + (unsigned long long)fileAttrib.numElements * fileAttrib.elementSize > fileSize)
+			return false;
+	}
+
+	const FileLOD* fileLODs = (const FileLOD*)(fileAttributes + header.numAttributes);
+
+	for (unsigned int i = 0; i < header.numLODs; i++)
+	{
+		if ((unsigned long long)fileLODs[i].firstIndex + fileLODs[i].numIndices > header.numIndices)
+			return false;
+	}
+
+	return true;
+}
+
+// Describes one of the arrays in an open cache file
+static AttributeDescriptor makeDescriptor(const char* fileData, const FileAttribute& fileAttrib)
+{
+	AttributeDescriptor attrib;
+	attrib.attributeLocation = (AttributeLocations)fileAttrib.attributeLocation;
+	attrib.attributeName = std::string(fileAttrib.attributeName, strnlen(fileAttrib.attributeName, sizeof(fileAttrib.attributeName)));
+	attrib.data = (void*)(fileData + fileAttrib.dataOffset);
+	attrib.elementSize = fileAttrib.elementSize;
+	attrib.elementType = fileAttrib.elementType;
+	attrib.numElements = fileAttrib.numElements;
+	attrib.numElementsPerAttrib = fileAttrib.numElementsPerAttrib;
+	attrib.normalized = fileAttrib.normalized != 0;
+	return attrib;
+}
+
+// Sets the mesh's bounds and vertex format to match the arrays in the file
+static void setMeshFormat(const FileHeader& header, const std::vector<AttributeDescriptor>& attributes, TTK::MeshBase& mesh)
+{
+	mesh.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	mesh.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	mesh.vertexFormat = TTK::VertexPacking::getVertexFormat(attributes);
+	mesh.updatePositionQuantization();
+}
+
+static void copyLODs(const char* fileData, const FileHeader& header, TTK::MeshBase& mesh)
+{
+	const FileLOD* fileLODs = (const FileLOD*)(fileData + sizeof(FileHeader) + sizeof(FileAttribute) * header.numAttributes);
+
+	mesh.lods.resize(header.numLODs);
+
+	for (unsigned int i = 0; i < header.numLODs; i++)
+	{
+		mesh.lods[i].firstIndex = fileLODs[i].firstIndex;
+		mesh.lods[i].numIndices = fileLODs[i].numIndices;
+		mesh.lods[i].error = fileLODs[i].error;
+	}
+}
+
+// Copies the arrays of an open cache file into the mesh's CPU side arrays,
+// packed arrays are turned back into floats
+static void copyToMesh(const char* fileData, const FileHeader& header, const std::vector<AttributeDescriptor>& attributes, TTK::MeshBase& mesh)
+{
+	for (unsigned int i = 0; i < attributes.size(); i++)
+	{
+		const AttributeDescriptor& attrib = attributes[i];
+
+		if (attrib.attributeLocation == VERTEX)
+			TTK::VertexPacking::unpackPositions(attrib, mesh.positionScale, mesh.positionOffset, mesh.vertices);
+		else if (attrib.attributeLocation == NORMAL)
+			TTK::VertexPacking::unpackNormals(attrib, mesh.normals);
+		else if (attrib.attributeLocation == TEX_COORD)
+			TTK::VertexPacking::unpackTexCoords(attrib, mesh.textureCoordinates);
+	}
+
+	if (header.numIndices > 0)
+	{
+		const char* indexData = fileData + header.indexOffset;
+
+		if (header.indexType == GL_UNSIGNED_SHORT)
+			mesh.indices.assign((const unsigned short*)indexData, (const unsigned short*)indexData + header.numIndices);
+		else
+			mesh.indices.assign((const unsigned int*)indexData, (const unsigned int*)indexData + header.numIndices);
+	}
+}
+
+// Points the VBO's float attributes and its indices at the mesh's CPU side arrays,
+// packed attributes have no CPU copy in the same format and stay forgotten
+static void useCPUArrays(const std::vector<AttributeDescriptor>& attributes, TTK::MeshBase& mesh)
+{
+	for (unsigned int i = 0; i < attributes.size(); i++)
+	{
+		const AttributeDescriptor& attrib = attributes[i];
+
+		if (attrib.elementType != GL_FLOAT)
+			continue;
+
+		if (attrib.attributeLocation == VERTEX && mesh.vertices.size() > 0)
+			mesh.vbo.setAttributeData(i, &mesh.vertices[0]);
+		else if (attrib.attributeLocation == NORMAL && mesh.normals.size() > 0)
+			mesh.vbo.setAttributeData(i, &mesh.normals[0]);
+		else if (attrib.attributeLocation == TEX_COORD && mesh.textureCoordinates.size() > 0)
+			mesh.vbo.setAttributeData(i, &mesh.textureCoordinates[0]);
+	}
+
+	if (mesh.indices.size() > 0)
+		mesh.vbo.setIndexArray(&mesh.indices[0], mesh.indices.size());
+}
+
+static std::vector<AttributeDescriptor> getAttributes(const char* fileData, const FileHeader& header)
+{
+	const FileAttribute* fileAttributes = (const FileAttribute*)(fileData + sizeof(FileHeader));
+	std::vector<AttributeDescriptor> attributes;
+
+	for (unsigned int i = 0; i < header.numAttributes; i++)
+		attributes.push_back(makeDescriptor(fileData, fileAttributes[i]));
+
+	return attributes;
+}
+
+bool TTK::MeshCache::load(std::string cacheFileName, const MeshCacheKey& key, MeshBase& mesh, bool keepCPUData)
+{
+	MappedFile file;
+	FileHeader header;
+
+	if (!openCacheFile(cacheFileName, key, file, header))
+		return false;
+
+	const char* fileData = file.data();
+	std::vector<AttributeDescriptor> attributes = getAttributes(fileData, header);
+
+	// Everything checks out, hand the mapped arrays straight to the VBO
+	for (unsigned int i = 0; i < attributes.size(); i++)
+		mesh.vbo.addAttributeArray(attributes[i]);
+
+	if (header.numIndices > 0)
+	{
+		void* indexData = (void*)(fileData + header.indexOffset);
+
+		if (header.indexType == GL_UNSIGNED_SHORT)
+			mesh.vbo.setIndexArray((unsigned short*)indexData, header.numIndices);
+		else
+			mesh.vbo.setIndexArray((unsigned int*)indexData, header.numIndices);
+	}
+
+	setMeshFormat(header, attributes, mesh);
+	copyLODs(fileData, header, mesh);
+
+	if (keepCPUData)
+		copyToMesh(fileData, header, attributes, mesh);
+
+	mesh.vbo.createVBO();
+
+	// The mapping is released when file goes out of scope, GL has its own copy now.
+	// Don't leave the VBO pointing into it, only at the CPU copies with the same layout
+	mesh.vbo.releaseSourceData();
+
+	if (keepCPUData)
+		useCPUArrays(attributes, mesh);
+
+	return true;
+}
+
+bool TTK::MeshCache::read(std::string cacheFileName, const MeshCacheKey& key, MeshBase& mesh)
+{
+	MappedFile file;
+	FileHeader header;
+
+	if (!openCacheFile(cacheFileName, key, file, header))
+		return false;
+
+	std::vector<AttributeDescriptor> attributes = getAttributes(file.data(), header);
+
+	setMeshFormat(header, attributes, mesh);
+	copyLODs(file.data(), header, mesh);
+	copyToMesh(file.data(), header, attributes, mesh);
+	return true;
+}
@@ -0,0 +1,310 @@
+#include "TTK/MeshOptimizer.h"
+#include <algorithm>
+
+TTK::VertexCacheStats TTK::MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int numVertices,
+	unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+
+	if (indices.size() < 3 || numVertices == 0)
+		return stats;
+
+	// A vertex is in the FIFO if fewer than cacheSize misses happened since it went in
+	std::vector<unsigned int> insertedAt(numVertices, 0);
+	std::vector<bool> used(numVertices, false);
+	unsigned int misses = 0;
+	unsigned int numUsed = 0;
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned int v = indices[i];
+
+		if (!used[v] || misses - insertedAt[v] >= cacheSize)
+		{
+			misses++;
+			insertedAt[v] = misses;
+		}
+
+		if (!used[v])
+		{
+			used[v] = true;
+			numUsed++;
+		}
+	}
+
+	stats.acmr = (float)misses / (indices.size() / 3);
+	stats.atvr = (float)misses / numUsed;
+	return stats;
+}
+
+// Skips to a vertex which still has triangles left, newest dead end first, then in vertex order.
+// Returns -1 once every triangle has been emitted.
+static int skipDeadEnd(const std::vector<unsigned int>& liveTriangles, std::vector<unsigned int>& deadEnds,
+	unsigned int& cursor)
+{
+	while (!deadEnds.empty())
+	{
+		unsigned int v = deadEnds.back();
+		deadEnds.pop_back();
+
+		if (liveTriangles[v] > 0)
+			return v;
+	}
+
+	while (cursor < liveTriangles.size())
+	{
+		if (liveTriangles[cursor] > 0)
+			return cursor;
+
+		cursor++;
+	}
+
+	return -1;
+}
+
+void TTK::MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int numVertices,
+	unsigned int cacheSize, std::vector<unsigned int>* clusters)
+{
+	size_t numTriangles = indices.size() / 3;
+
+	if (clusters)
+		clusters->clear();
+
+	if (numTriangles == 0 || numVertices == 0)
+		return;
+
+	// Triangles using each vertex, as one array with an offset per vertex
+	std::vector<unsigned int> liveTriangles(numVertices, 0);
+	std::vector<unsigned int> adjacencyOffsets(numVertices + 1, 0);
+	std::vector<unsigned int> adjacency(numTriangles * 3);
+
+	for (size_t i = 0; i < numTriangles * 3; i++)
+		liveTriangles[indices[i]]++;
+
+	for (unsigned int v = 0; v < numVertices; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < numTriangles * 3; i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<unsigned int> cacheTime(numVertices, 0);
+	std::vector<bool> emitted(numTriangles, false);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(numTriangles * 3);
+
+	unsigned int time = cacheSize + 1;
+	unsigned int cursor = 0;
+	int fanVertex = 0;
+
+	// The first fan always starts a cluster
+	bool newCluster = true;
+
+	while (fanVertex >= 0)
+	{
+		if (newCluster && clusters)
+			clusters->push_back((unsigned int)(output.size() / 3));
+
+		// Emit every remaining triangle around the fan vertex
+		candidates.clear();
+
+		for (unsigned int a = adjacencyOffsets[fanVertex]; a < adjacencyOffsets[fanVertex + 1]; a++)
+		{
+			unsigned int t = adjacency[a];
+
+			if (emitted[t])
+				continue;
+
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				unsigned int v = indices[t * 3 + corner];
+
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+
+			emitted[t] = true;
+		}
+
+		// Next fan: the candidate that will still be in the cache once its triangles are emitted,
+		// and of those the one that went in first
+		int best = -1;
+		int bestPriority = -1;
+
+		for (size_t c = 0; c < candidates.size(); c++)
+		{
+			unsigned int v = candidates[c];
+
+			if (liveTriangles[v] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = time - cacheTime[v];
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = v;
+			}
+		}
+
+		newCluster = best == -1;
+
+		if (best == -1)
+			best = skipDeadEnd(liveTriangles, deadEnds, cursor);
+
+		fanVertex = best;
+	}
+
+	indices.swap(output);
+}
+
+void TTK::MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+	const std::vector<unsigned int>& clusters)
+{
+	size_t numTriangles = indices.size() / 3;
+	size_t numClusters = clusters.size();
+
+	if (numClusters < 2)
+		return;
+
+	// Area weighted centre and normal of every cluster
+	std::vector<glm::vec3> clusterCentres(numClusters, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3(0.0f));
+	std::vector<float> clusterAreas(numClusters, 0.0f);
+	glm::vec3 meshCentre(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < numClusters; c++)
+	{
+		size_t first = clusters[c];
+		size_t last = c + 1 < numClusters ? clusters[c + 1] : numTriangles;
+
+		for (size_t t = first; t < last; t++)
+		{
+			const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+			const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+
+			clusterCentres[c] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[c] += normal;
+			clusterAreas[c] += area;
+		}
+
+		meshCentre += clusterCentres[c];
+		meshArea += clusterAreas[c];
+	}
+
+	if (meshArea > 0.0f)
+		meshCentre /= meshArea;
+
+	// Clusters pointing out of the mesh are more likely to be in front, draw them first
+	std::vector<float> sortKeys(numClusters);
+	std::vector<unsigned int> order(numClusters);
+
+	for (size_t c = 0; c < numClusters; c++)
+	{
+		glm::vec3 centre = clusterAreas[c] > 0.0f ? clusterCentres[c] / clusterAreas[c] : meshCentre;
+		float normalLength = glm::length(clusterNormals[c]);
+
+		sortKeys[c] = normalLength > 0.0f ? glm::dot(centre - meshCentre, clusterNormals[c] / normalLength) : 0.0f;
+		order[c] = (unsigned int)c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](unsigned int a, unsigned int b)
+	{
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	for (size_t i = 0; i < numClusters; i++)
+	{
+		unsigned int c = order[i];
+		size_t first = clusters[c];
+		size_t last = c + 1 < numClusters ? clusters[c + 1] : numTriangles;
+
+		output.insert(output.end(), indices.begin() + first * 3, indices.begin() + last * 3);
+	}
+
+	indices.swap(output);
+}
+
+// Moves array[v] to array[remap[v]] for every used vertex
+template <typename T>
+static void remapArray(std::vector<T>& array, const std::vector<unsigned int>& remap, unsigned int numUsed)
+{
+	if (array.size() != remap.size())
+		return;
+
+	std::vector<T> remapped(numUsed);
+
+	for (size_t v = 0; v < remap.size(); v++)
+	{
+		if (remap[v] != ~0u)
+			remapped[remap[v]] = array[v];
+	}
+
+	array.swap(remapped);
+}
+
+void TTK::MeshOptimizer::optimizeVertexFetch(MeshBase& mesh)
+{
+	unsigned int numVertices = mesh.vertices.size();
+
+	if (mesh.indices.size() == 0 || numVertices == 0)
+		return;
+
+	std::vector<unsigned int> remap(numVertices, ~0u);
+	unsigned int numUsed = 0;
+
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		unsigned int& index = mesh.indices[i];
+
+		if (remap[index] == ~0u)
+			remap[index] = numUsed++;
+
+		index = remap[index];
+	}
+
+	remapArray(mesh.vertices, remap, numUsed);
+	remapArray(mesh.normals, remap, numUsed);
+	remapArray(mesh.textureCoordinates, remap, numUsed);
+	remapArray(mesh.colours, remap, numUsed);
+}
+
+void TTK::MeshOptimizer::optimize(MeshBase& mesh, bool reduceOverdraw, unsigned int cacheSize,
+	VertexCacheStats* before, VertexCacheStats* after)
+{
+	unsigned int numVertices = mesh.vertices.size();
+
+	if (mesh.indices.size() == 0 || numVertices == 0)
+		return;
+
+	if (before)
+		*before = analyzeVertexCache(mesh.indices, numVertices, cacheSize);
+
+	std::vector<unsigned int> clusters;
+	optimizeVertexCache(mesh.indices, numVertices, cacheSize, reduceOverdraw ? &clusters : nullptr);
+
+	if (reduceOverdraw)
+		optimizeOverdraw(mesh.indices, mesh.vertices, clusters);
+
+	optimizeVertexFetch(mesh);
+
+	if (after)
+		*after = analyzeVertexCache(mesh.indices, mesh.vertices.size(), cacheSize);
+}
@@ -0,0 +1,565 @@
+#include "TTK/MeshSimplifier.h"
+#include "TTK/MeshOptimizer.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+// Constrained edges pull this much harder than the surface, relative to their length squared
+const double CONSTRAINED_EDGE_WEIGHT = 10.0;
+
+// Sum of squared distances to a set of planes, each weighted by the area it came from
+struct Quadric
+{
+public:
+	Quadric()
+	{
+		a00 = a01 = a02 = a11 = a12 = a22 = 0.0;
+		b0 = b1 = b2 = 0.0;
+		c = 0.0;
+		weight = 0.0;
+	}
+
+	// Plane dot(normal, p) + d = 0, normal must be unit length
+	void addPlane(glm::vec3 normal, double d, double w)
+	{
+		double x = normal.x, y = normal.y, z = normal.z;
+
+		a00 += w * x * x; a01 += w * x * y; a02 += w * x * z;
+		a11 += w * y * y; a12 += w * y * z; a22 += w * z * z;
+		b0 += w * x * d; b1 += w * y * d; b2 += w * z * d;
+		c += w * d * d;
+		weight += w;
+	}
+
+	void add(const Quadric& q)
+	{
+		a00 += q.a00; a01 += q.a01; a02 += q.a02;
+		a11 += q.a11; a12 += q.a12; a22 += q.a22;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		weight += q.weight;
+	}
+
+	// Average squared distance from p to the planes
+	double error(glm::vec3 p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double e = a00 * x * x + a11 * y * y + a22 * z * z
+			+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+		return weight > 0.0 ? fabs(e) / weight : 0.0;
+	}
+
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double weight;
+};
+
+// Neighbours of a vertex along constrained (border or seam) edges.
+// A vertex with two can slide along them, one with any other number stays where it is.
+struct ConstrainedNeighbours
+{
+public:
+	ConstrainedNeighbours()
+	{
+		count = 0;
+		neighbours[0] = neighbours[1] = ~0u;
+	}
+
+	void add(unsigned int v)
+	{
+		if ((count > 0 && neighbours[0] == v) || (count > 1 && neighbours[1] == v))
+			return;
+
+		if (count < 2)
+			neighbours[count] = v;
+
+		count++;
+	}
+
+	void replace(unsigned int from, unsigned int to)
+	{
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			if (neighbours[i] == from)
+				neighbours[i] = to;
+		}
+	}
+
+	bool has(unsigned int v) const
+	{
+		return count == 2 && (neighbours[0] == v || neighbours[1] == v);
+	}
+
+	unsigned int count;
+	unsigned int neighbours[2];
+};
+
+struct Collapse
+{
+	unsigned int from;
+	unsigned int to;
+	double error;
+};
+
+static inline unsigned int hashPosition(const glm::vec3& p)
+{
+	// + 0.0f turns -0 into 0, they compare equal so they must hash the same
+	float x = p.x + 0.0f, y = p.y + 0.0f, z = p.z + 0.0f;
+	unsigned int bits[3];
+	memcpy(bits, &x, 4);
+	memcpy(bits + 1, &y, 4);
+	memcpy(bits + 2, &z, 4);
+
+	return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+// Groups vertices with the same position (copies made for uv or normal seams).
+// positionOf[v] is the first vertex at v's position, and nextWedge links
+// all the vertices at one position into a ring.
+static void buildPositionRings(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& positionOf,
+	std::vector<unsigned int>& nextWedge)
+{
+	unsigned int numVertices = positions.size();
+
+	// Open addressing, the table is kept at most half full
+	unsigned int tableSize = 1;
+	while (tableSize < numVertices * 2)
+		tableSize *= 2;
+
+	std::vector<unsigned int> table(tableSize, ~0u);
+
+	positionOf.resize(numVertices);
+	nextWedge.resize(numVertices);
+
+	for (unsigned int v = 0; v < numVertices; v++)
+	{
+		unsigned int slot = hashPosition(positions[v]) & (tableSize - 1);
+
+		while (table[slot] != ~0u && positions[table[slot]] != positions[v])
+			slot = (slot + 1) & (tableSize - 1);
+
+		if (table[slot] == ~0u)
+		{
+			table[slot] = v;
+			positionOf[v] = v;
+			nextWedge[v] = v;
+		}
+		else
+		{
+			// Insert into the ring after the first vertex
+			unsigned int first = table[slot];
+			positionOf[v] = first;
+			nextWedge[v] = nextWedge[first];
+			nextWedge[first] = v;
+		}
+	}
+}
+
+// The vertex at position ring whose normal and uv are most like vertex v's
+static unsigned int closestWedge(const TTK::MeshBase& mesh, unsigned int v, unsigned int ring,
+	const std::vector<unsigned int>& nextWedge)
+{
+	bool hasNormals = mesh.normals.size() == mesh.vertices.size();
+	bool hasUVs = mesh.textureCoordinates.size() == mesh.vertices.size();
+
+	unsigned int best = ring;
+	float bestScore = 0.0f;
+	unsigned int w = ring;
+
+	do
+	{
+		float score = 0.0f;
+
+		if (hasNormals)
+			score += 1.0f - glm::dot(mesh.normals[v], mesh.normals[w]);
+
+		if (hasUVs)
+			score += glm::length(mesh.textureCoordinates[v] - mesh.textureCoordinates[w]);
+
+		if (w == ring || score < bestScore)
+		{
+			best = w;
+			bestScore = score;
+		}
+
+		w = nextWedge[w];
+	} while (w != ring);
+
+	return best;
+}
+
+// Triangles around each position, as one array with an offset per position
+static void buildAdjacency(const std::vector<unsigned int>& triangles, const std::vector<unsigned int>& positionOf,
+	std::vector<unsigned int>& offsets, std::vector<unsigned int>& adjacency)
+{
+	std::fill(offsets.begin(), offsets.end(), 0);
+
+	for (size_t i = 0; i < triangles.size(); i++)
+		offsets[positionOf[triangles[i]] + 1]++;
+
+	for (size_t v = 0; v + 1 < offsets.size(); v++)
+		offsets[v + 1] += offsets[v];
+
+	adjacency.resize(triangles.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+
+	for (size_t i = 0; i < triangles.size(); i++)
+		adjacency[fill[positionOf[triangles[i]]]++] = (unsigned int)(i / 3);
+}
+
+static inline size_t nextCorner(size_t i)
+{
+	return i % 3 == 2 ? i - 2 : i + 1;
+}
+
+// Finds the triangle corner whose edge runs from position p0 to position p1, or -1 if there is none
+static long long findHalfEdge(const std::vector<unsigned int>& triangles, const std::vector<unsigned int>& positionOf,
+	const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& adjacency, unsigned int p0, unsigned int p1)
+{
+	for (unsigned int a = offsets[p0]; a < offsets[p0 + 1]; a++)
+	{
+		size_t t = adjacency[a] * 3;
+
+		for (size_t corner = t; corner < t + 3; corner++)
+		{
+			if (positionOf[triangles[corner]] == p0 && positionOf[triangles[nextCorner(corner)]] == p1)
+				return (long long)corner;
+		}
+	}
+
+	return -1;
+}
+
+// Simplifies the triangles down to each of targets in turn (largest first).
+// outputs[i] receives the triangles once there are no more than targets[i] indices, and errors[i]
+// the largest distance the surface has moved by then. Collapsing carries on from one target
+// to the next, so every level is measured against the original surface.
+static void simplifyLevels(const TTK::MeshBase& mesh, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& targets,
+	std::vector<std::vector<unsigned int> >& outputs, std::vector<float>& errors)
+{
+	const std::vector<glm::vec3>& positions = mesh.vertices;
+	unsigned int numVertices = positions.size();
+
+	outputs.assign(targets.size(), std::vector<unsigned int>());
+	errors.assign(targets.size(), 0.0f);
+
+	if (numVertices == 0 || indices.size() < 3)
+		return;
+
+	std::vector<unsigned int> positionOf, nextWedge;
+	buildPositionRings(positions, positionOf, nextWedge);
+
+	// Triangles still alive, as vertex indices. Anything already degenerate is dropped.
+	std::vector<unsigned int> triangles;
+	triangles.reserve(indices.size());
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int p0 = positionOf[indices[i]], p1 = positionOf[indices[i + 1]], p2 = positionOf[indices[i + 2]];
+
+		if (p0 != p1 && p1 != p2 && p2 != p0)
+			triangles.insert(triangles.end(), indices.begin() + i, indices.begin() + i + 3);
+	}
+
+	// Every position starts with the planes of the triangles around it
+	std::vector<Quadric> quadrics(numVertices);
+
+	for (size_t i = 0; i < triangles.size(); i += 3)
+	{
+		unsigned int p0 = positionOf[triangles[i]], p1 = positionOf[triangles[i + 1]], p2 = positionOf[triangles[i + 2]];
+		glm::vec3 normal = glm::cross(positions[p1] - positions[p0], positions[p2] - positions[p0]);
+		float area = glm::length(normal);
+
+		if (area == 0.0f)
+			continue;
+
+		normal /= area;
+		double d = -glm::dot(normal, positions[p0]);
+
+		quadrics[p0].addPlane(normal, d, area);
+		quadrics[p1].addPlane(normal, d, area);
+		quadrics[p2].addPlane(normal, d, area);
+	}
+
+	std::vector<unsigned int> adjacencyOffsets(numVertices + 1);
+	std::vector<unsigned int> adjacency;
+	buildAdjacency(triangles, positionOf, adjacencyOffsets, adjacency);
+
+	// An edge with no triangle on the other side (a hole or outline), or with different
+	// vertices on each side (a uv or normal seam) is constrained. A plane through it, at
+	// right angles to its triangle, stops collapses from pulling it out of shape.
+	std::vector<ConstrainedNeighbours> constrained(numVertices);
+
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		size_t next = nextCorner(i);
+		unsigned int p0 = positionOf[triangles[i]], p1 = positionOf[triangles[next]];
+
+		long long opposite = findHalfEdge(triangles, positionOf, adjacencyOffsets, adjacency, p1, p0);
+		bool isConstrained = opposite < 0;
+
+		if (!isConstrained)
+			isConstrained = triangles[(size_t)opposite] != triangles[next] || triangles[nextCorner((size_t)opposite)] != triangles[i];
+
+		if (!isConstrained)
+			continue;
+
+		size_t t = i - i % 3;
+		glm::vec3 edge = positions[p1] - positions[p0];
+		glm::vec3 faceNormal = glm::cross(positions[positionOf[triangles[t + 1]]] - positions[positionOf[triangles[t]]],
+			positions[positionOf[triangles[t + 2]]] - positions[positionOf[triangles[t]]]);
+		glm::vec3 normal = glm::cross(edge, faceNormal);
+		float length = glm::length(normal);
+
+		if (length > 0.0f)
+		{
+			normal /= length;
+			double d = -glm::dot(normal, positions[p0]);
+			double w = glm::dot(edge, edge) * CONSTRAINED_EDGE_WEIGHT;
+
+			quadrics[p0].addPlane(normal, d, w);
+			quadrics[p1].addPlane(normal, d, w);
+		}
+
+		constrained[p0].add(p1);
+		constrained[p1].add(p0);
+	}
+
+	std::vector<unsigned int> vertexRemap(numVertices);
+	for (unsigned int v = 0; v < numVertices; v++)
+		vertexRemap[v] = v;
+
+	std::vector<Collapse> collapses;
+	std::vector<bool> locked(numVertices, false);
+	double maxError = 0.0;
+	bool stuck = false;
+
+	for (size_t level = 0; level < targets.size(); level++)
+	{
+		size_t targetNumIndices = targets[level];
+
+		// Each pass collapses the cheapest edges that don't share a vertex, then rebuilds
+		while (triangles.size() > targetNumIndices && !stuck)
+		{
+			size_t numTriangles = triangles.size() / 3;
+			buildAdjacency(triangles, positionOf, adjacencyOffsets, adjacency);
+
+			// Every edge once, from the end with the lower number, or from its only triangle
+			collapses.clear();
+
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				unsigned int a = positionOf[triangles[i]], b = positionOf[triangles[nextCorner(i)]];
+
+				if (a > b && findHalfEdge(triangles, positionOf, adjacencyOffsets, adjacency, b, a) >= 0)
+					continue;
+
+				bool aToB = constrained[a].count == 0 || constrained[a].has(b);
+				bool bToA = constrained[b].count == 0 || constrained[b].has(a);
+
+				if (!aToB && !bToA)
+					continue;
+
+				Quadric q = quadrics[a];
+				q.add(quadrics[b]);
+
+				Collapse collapse;
+				double errorAToB = aToB ? q.error(positions[b]) : 0.0;
+				double errorBToA = bToA ? q.error(positions[a]) : 0.0;
+
+				if (aToB && (!bToA || errorAToB <= errorBToA))
+				{
+					collapse.from = a;
+					collapse.to = b;
+					collapse.error = errorAToB;
+				}
+				else
+				{
+					collapse.from = b;
+					collapse.to = a;
+					collapse.error = errorBToA;
+				}
+
+				collapses.push_back(collapse);
+			}
+
+			// Only the cheaper half each pass, the costs of the rest are out of date once their neighbours move
+			size_t numCandidates = std::max(collapses.size() / 2, (size_t)1);
+			auto byError = [](const Collapse& a, const Collapse& b)
+			{
+				return a.error < b.error;
+			};
+
+			if (numCandidates < collapses.size())
+				std::nth_element(collapses.begin(), collapses.begin() + numCandidates, collapses.end(), byError);
+
+			numCandidates = std::min(numCandidates, collapses.size());
+			std::sort(collapses.begin(), collapses.begin() + numCandidates, byError);
+
+			size_t removeGoal = numTriangles - targetNumIndices / 3;
+			size_t removed = 0;
+			unsigned int numCollapsed = 0;
+
+			for (size_t i = 0; i < numCandidates && removed < removeGoal; i++)
+			{
+				const Collapse& collapse = collapses[i];
+
+				if (locked[collapse.from] || locked[collapse.to])
+					continue;
+
+				// Moving from onto to must not turn any of the triangles that are left over
+				bool valid = true;
+				size_t removedHere = 0;
+
+				for (unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && valid; a++)
+				{
+					unsigned int t = adjacency[a] * 3;
+					unsigned int p[3];
+
+					for (unsigned int corner = 0; corner < 3; corner++)
+						p[corner] = positionOf[vertexRemap[triangles[t + corner]]];
+
+					if (p[0] == p[1] || p[1] == p[2] || p[2] == p[0])
+						continue;
+
+					if (p[0] == collapse.to || p[1] == collapse.to || p[2] == collapse.to)
+					{
+						removedHere++;
+						continue;
+					}
+
+					glm::vec3 before = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+
+					for (unsigned int corner = 0; corner < 3; corner++)
+					{
+						if (p[corner] == collapse.from)
+							p[corner] = collapse.to;
+					}
+
+					glm::vec3 after = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+
+					if (glm::dot(before, after) <= 0.0f)
+						valid = false;
+				}
+
+				if (!valid)
+					continue;
+
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+
+				// Each vertex at from becomes the vertex at to that looks most like it
+				unsigned int w = collapse.from;
+				do
+				{
+					vertexRemap[w] = closestWedge(mesh, w, collapse.to, nextWedge);
+					w = nextWedge[w];
+				} while (w != collapse.from);
+
+				// Keep the chain of constrained edges joined up
+				if (constrained[collapse.from].count == 2)
+				{
+					const ConstrainedNeighbours& neighbours = constrained[collapse.from];
+					unsigned int other = neighbours.neighbours[0] == collapse.to ? neighbours.neighbours[1] : neighbours.neighbours[0];
+
+					constrained[collapse.to].replace(collapse.from, other);
+					constrained[other].replace(collapse.from, collapse.to);
+				}
+
+				locked[collapse.from] = true;
+				locked[collapse.to] = true;
+
+				removed += removedHere;
+				maxError = std::max(maxError, collapse.error);
+				numCollapsed++;
+			}
+
+			// Nothing left that can go without folding the surface over
+			if (numCollapsed == 0)
+				stuck = true;
+
+			// Rewrite the triangles with the collapsed vertices, dropping the ones that fell to a line
+			size_t numKept = 0;
+
+			for (size_t t = 0; t < triangles.size(); t += 3)
+			{
+				unsigned int v0 = vertexRemap[triangles[t]], v1 = vertexRemap[triangles[t + 1]], v2 = vertexRemap[triangles[t + 2]];
+				unsigned int p0 = positionOf[v0], p1 = positionOf[v1], p2 = positionOf[v2];
+
+				if (p0 == p1 || p1 == p2 || p2 == p0)
+					continue;
+
+				triangles[numKept++] = v0;
+				triangles[numKept++] = v1;
+				triangles[numKept++] = v2;
+			}
+
+			triangles.resize(numKept);
+			std::fill(locked.begin(), locked.end(), false);
+		}
+
+		outputs[level] = triangles;
+		errors[level] = (float)sqrt(maxError);
+	}
+}
+
+float TTK::MeshSimplifier::simplify(const MeshBase& mesh, const std::vector<unsigned int>& indices, unsigned int targetNumIndices,
+	std::vector<unsigned int>& out)
+{
+	std::vector<std::vector<unsigned int> > outputs;
+	std::vector<float> errors;
+
+	simplifyLevels(mesh, indices, std::vector<unsigned int>(1, targetNumIndices), outputs, errors);
+
+	out.swap(outputs[0]);
+	return errors[0];
+}
+
+void TTK::MeshSimplifier::generateLODs(MeshBase& mesh, unsigned int numLevels, float triangleRatio)
+{
+	mesh.lods.clear();
+
+	if (mesh.indices.size() == 0 || numLevels == 0)
+		return;
+
+	std::vector<unsigned int> targets;
+	std::vector<std::vector<unsigned int> > levels;
+	std::vector<float> errors;
+
+	for (unsigned int level = 1; level <= numLevels; level++)
+		targets.push_back((unsigned int)(mesh.indices.size() / 3 * pow(triangleRatio, (float)level)) * 3);
+
+	simplifyLevels(mesh, mesh.indices, targets, levels, errors);
+
+	float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+
+	MeshLOD lod;
+	lod.firstIndex = 0;
+	lod.numIndices = mesh.indices.size();
+	lod.error = 0.0f;
+	mesh.lods.push_back(lod);
+
+	for (unsigned int level = 0; level < levels.size(); level++)
+	{
+		std::vector<unsigned int>& simplified = levels[level];
+
+		// Not worth a level of its own if it barely removes anything
+		if (simplified.size() == 0 || simplified.size() > mesh.lods.back().numIndices * 0.8f)
+			break;
+
+		MeshOptimizer::optimizeVertexCache(simplified, mesh.vertices.size());
+
+		lod.firstIndex = mesh.indices.size();
+		lod.numIndices = simplified.size();
+		lod.error = radius > 0.0f ? errors[level] / radius : 0.0f;
+
+		mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+		mesh.lods.push_back(lod);
+	}
+
+	// Only the full mesh, no point keeping the table
+	if (mesh.lods.size() == 1)
+		mesh.lods.clear();
+}
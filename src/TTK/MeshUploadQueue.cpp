@@ -0,0 +1,137 @@
+#include "TTK/MeshUploadQueue.h"
+#include "TTK/GeometryArena.h"
+#include "TTK/Profiler.h"
+#include <algorithm>
+
+TTK::MeshUploadQueue::MeshUploadQueue()
+{
+	// About a millisecond of upload on most PCIe hardware
+	bytesPerFrame = 4 * 1024 * 1024;
+	bytesUploadedLastFrame = 0;
+}
+
+TTK::MeshUploadQueue& TTK::MeshUploadQueue::shared()
+{
+	static MeshUploadQueue queue;
+	return queue;
+}
+
+void TTK::MeshUploadQueue::setBytesPerFrame(size_t bytes)
+{
+	bytesPerFrame = bytes;
+}
+
+size_t TTK::MeshUploadQueue::getBytesPerFrame()
+{
+	return bytesPerFrame;
+}
+
+void TTK::MeshUploadQueue::push(std::shared_ptr<MeshBase> staging, MeshBase* mesh, MeshLoadHandle handle, bool keepCPUData)
+{
+	Upload upload;
+	upload.staging = staging;
+	upload.mesh = mesh;
+	upload.handle = handle;
+	upload.keepCPUData = keepCPUData;
+	upload.started = false;
+	upload.buffer = 0;
+	upload.offset = 0;
+
+	handle->setState(MESH_LOAD_UPLOADING);
+
+	std::lock_guard<std::mutex> lock(incomingMutex);
+	incoming.push_back(upload);
+}
+
+void TTK::MeshUploadQueue::update()
+{
+	TTK_PROFILE_ZONE("MeshUploadQueue::update");
+
+	{
+		std::lock_guard<std::mutex> lock(incomingMutex);
+		uploads.insert(uploads.end(), incoming.begin(), incoming.end());
+		incoming.clear();
+	}
+
+	size_t budget = bytesPerFrame > 0 ? bytesPerFrame : (size_t)-1;
+	size_t uploaded = 0;
+
+	while (!uploads.empty() && uploaded < budget)
+	{
+		Upload& upload = uploads.front();
+
+		// The mesh is gone (or loading something else), don't touch it. Whatever GL objects
+		// the staging mesh holds are freed here, on the GL thread
+		if (upload.handle->isCancelled())
+		{
+			uploads.pop_front();
+			continue;
+		}
+
+		VertexBufferObject& vbo = upload.mesh->vbo;
+
+		// Allocating the buffers is cheap, the data follows over the next frames
+		if (!upload.started)
+		{
+			upload.mesh->swapData(*upload.staging);
+			upload.staging.reset();
+
+			// A reload, the arena still holds the old triangles
+			GeometryArena::shared().removeMesh(upload.mesh);
+
+			vbo.createVBO(false);
+			upload.started = true;
+		}
+
+		if (upload.buffer < vbo.getNumBuffers())
+		{
+			size_t size = vbo.getBufferSize(upload.buffer);
+			size_t piece = std::min(size - upload.offset, budget - uploaded);
+
+			vbo.uploadBufferRange(upload.buffer, upload.offset, piece);
+			upload.offset += piece;
+			uploaded += piece;
+
+			if (upload.offset == size)
+			{
+				upload.buffer++;
+				upload.offset = 0;
+			}
+		}
+		else if (upload.buffer == vbo.getNumBuffers() && upload.offset < vbo.getNumIndices())
+		{
+			size_t indexSize = vbo.getIndexType() == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+			size_t count = std::min(vbo.getNumIndices() - upload.offset, std::max((budget - uploaded) / indexSize, (size_t)1));
+
+			vbo.uploadIndexRange((unsigned int)upload.offset, (unsigned int)count);
+			upload.offset += count;
+			uploaded += count * indexSize;
+		}
+		else
+		{
+			vbo.finishUpload();
+
+			// The GPU has its own copy now
+			if (upload.keepCPUData)
+				upload.mesh->freePackedArrays();
+			else
+				upload.mesh->freeCPUData();
+
+			upload.handle->setState(MESH_LOAD_READY);
+			uploads.pop_front();
+		}
+	}
+
+	bytesUploadedLastFrame = uploaded;
+}
+
+size_t TTK::MeshUploadQueue::getBytesUploadedLastFrame()
+{
+	return bytesUploadedLastFrame;
+}
+
+unsigned int TTK::MeshUploadQueue::getNumPending()
+{
+	std::lock_guard<std::mutex> lock(incomingMutex);
+	return uploads.size() + incoming.size();
+}
@@ -1,9 +1,22 @@
 #include "TTK/OBJMesh.h"
+#include "TTK/MappedFile.h"
+#include "TTK/ThreadPool.h"
+#include "TTK/MeshCache.h"
+#include "TTK/MeshOptimizer.h"
+#include "TTK/MeshSimplifier.h"
+#include "TTK/GeometryArena.h"
+#include "TTK/IO.h"
+#include "TTK/Profiler.h"
 #include "glm/glm.hpp"
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
 
 typedef struct
 {
@@ -12,31 +25,38 @@ typedef struct
 	int vertex3, texture3, normal3;
 }Face3;
 
-void TTK::OBJMesh::loadMesh(std::string filename)
+// Containers for OBJ data
+typedef struct
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<Face3> faces;
+}OBJData;
+
+//////////////////////////////////////////////////////////////////////////
+// Stream backend
+//////////////////////////////////////////////////////////////////////////
+
+static bool parseOBJStream(std::string filename, OBJData& obj, size_t& bytesRead)
 {
 	std::ifstream file;
 
 	//open file
-	file.open(filename.c_str());
+	file.open(filename.c_str(), std::ios::in | std::ios::ate);
 
 	//check if file opened
 	if (file.fail() == true)
-	{
-		std::cout << "Error - OBJMesh::loadMesh file: " << filename << " not found.\n";
-		return;
-	}
+		return false;
+
+	bytesRead = (size_t)file.tellg();
+	file.seekg(0, std::ios::beg);
 
 	char currentChar;
 
 	glm::vec3 temp;
 	Face3 temp2;
 
-	// Containers for OBJ data
-	std::vector<glm::vec3> objVertices;
-	std::vector<glm::vec3> objUVs;
-	std::vector<glm::vec3> objNormals;
-	std::vector<Face3> objFaces;
-
 	file.get(currentChar);
 
 	while (!file.eof())
@@ -47,18 +67,17 @@ void TTK::OBJMesh::loadMesh(std::string filename)
 			if (currentChar == ' ')
 			{
 				file >> temp.x >> temp.y >> temp.z;
-				objVertices.push_back(temp);
+				obj.vertices.push_back(temp);
 			}
 			if (currentChar == 't')
 			{
 				file >> temp.x >> temp.y;
-				temp.z = 0.0f;
-				objUVs.push_back(temp);
+				obj.uvs.push_back(glm::vec2(temp));
 			}
 			if (currentChar == 'n')
 			{
 				file >> temp.x >> temp.y >> temp.z;
-				objNormals.push_back(temp);
+				obj.normals.push_back(temp);
 			}
 		}
 		else
@@ -71,7 +90,7 @@ void TTK::OBJMesh::loadMesh(std::string filename)
 					file >> temp2.vertex1 >> currentChar >> temp2.texture1 >> currentChar >> temp2.normal1;
 					file >> temp2.vertex2 >> currentChar >> temp2.texture2 >> currentChar >> temp2.normal2;
 					file >> temp2.vertex3 >> currentChar >> temp2.texture3 >> currentChar >> temp2.normal3;
-					objFaces.push_back(temp2);
+					obj.faces.push_back(temp2);
 				}
 			}
 		}
@@ -80,28 +99,1144 @@ void TTK::OBJMesh::loadMesh(std::string filename)
 
 	file.close();
 
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Memory mapped backend
+// The tokenizer works directly on the mapped bytes. The mapping is not
+// null terminated so every function takes the end of the buffer.
+//////////////////////////////////////////////////////////////////////////
+
+static inline bool isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c)
+{
+	return (unsigned char)(c - '0') < 10;
+}
+
+static inline const char* skipBlanks(const char* p, const char* end)
+{
+	while (p < end && isBlank(*p))
+		p++;
+	return p;
+}
+
+static inline const char* skipLine(const char* p, const char* end)
+{
+	const char* newline = (const char*)memchr(p, '\n', end - p);
+	return newline ? newline + 1 : end;
+}
+
+static const char* parseInt(const char* p, const char* end, int& out)
+{
+	p = skipBlanks(p, end);
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	int value = 0;
+	while (p < end && isDigit(*p))
+	{
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+
+	out = negative ? -value : value;
+	return p;
+}
+
+// Fallback for numbers the fast path cannot convert exactly
+// (more than 15 significant digits, huge exponents, inf, nan)
+static const char* parseFloatSlow(const char* p, const char* end, float& out)
+{
+	char buffer[64];
+	size_t length = 0;
+
+	while (p + length < end && length < sizeof(buffer) - 1 && !isBlank(p[length]) && p[length] != '\n' && p[length] != '/')
+	{
+		buffer[length] = p[length];
+		length++;
+	}
+	buffer[length] = '\0';
+
+	char* parsedEnd;
+	out = strtof(buffer, &parsedEnd);
+	return p + (parsedEnd - buffer);
+}
+
+static const char* parseFloat(const char* p, const char* end, float& out)
+{
+	// Powers of ten which are exactly representable as doubles
+	static const double powersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	p = skipBlanks(p, end);
+	const char* start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	// Integer part
+	while (p < end && isDigit(*p))
+	{
+		anyDigits = true;
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa)
+				significantDigits++;
+		}
+		else
+		{
+			exponent++;
+			significantDigits++;
+		}
+		p++;
+	}
+
+	// Fractional part
+	if (p < end && *p == '.')
+	{
+		p++;
+		while (p < end && isDigit(*p))
+		{
+			anyDigits = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa)
+					significantDigits++;
+				exponent--;
+			}
+			else
+			{
+				significantDigits++;
+			}
+			p++;
+		}
+	}
+
+	if (!anyDigits)
+		return parseFloatSlow(start, end, out);
+
+	// Exponent
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		int explicitExponent;
+		const char* afterExponent = parseInt(p + 1, end, explicitExponent);
+		if (afterExponent != p + 1)
+		{
+			exponent += explicitExponent;
+			p = afterExponent;
+		}
+	}
+
+	// Beyond 15 digits or 10^22 the double maths below can round differently than strtof
+	if (significantDigits > 15 || exponent > 22 || exponent < -22)
+		return parseFloatSlow(start, end, out);
+
+	// Both operands are exact, so this is the correctly rounded double
+	double value = (double)mantissa;
+
+	if (exponent < 0)
+		value /= powersOfTen[-exponent];
+	else
+		value *= powersOfTen[exponent];
+
+	// Narrowing rounds a second time, strtof rounds the digits once. The two only differ
+	// when the double landed exactly halfway between two floats, let strtof decide those
+	float result = (float)value;
+
+	if ((double)result != value)
+	{
+		float neighbour = nextafterf(result, value > result ? FLT_MAX : -FLT_MAX);
+
+		if (((double)result + (double)neighbour) * 0.5 == value)
+			return parseFloatSlow(start, end, out);
+	}
+
+	out = negative ? -result : result;
+	return p;
+}
+
+// Turns a relative (negative) OBJ index into an absolute 1-based one.
+// numDefined is the number of elements of that type defined before this line
+static inline int resolveIndex(int index, size_t numDefined)
+{
+	if (index < 0)
+		return (int)numDefined + index + 1;
+	return index;
+}
+
+// Parses a single "v/vt/vn" face vertex, components which are left out ("v//vn") are 0
+static const char* parseFaceVertex(const char* p, const char* end, int& vertex, int& texture, int& normal)
+{
+	texture = normal = 0;
+
+	p = parseInt(p, end, vertex);
+
+	if (p < end && *p == '/')
+	{
+		p++;
+		if (p < end && *p != '/')
+			p = parseInt(p, end, texture);
+
+		if (p < end && *p == '/')
+			p = parseInt(p + 1, end, normal);
+	}
+
+	return p;
+}
+
+enum OBJRecord
+{
+	RECORD_NONE = 0,
+	RECORD_VERTEX,
+	RECORD_UV,
+	RECORD_NORMAL,
+	RECORD_FACE
+};
+
+// Returns the type of the line starting at p (leading blanks already skipped).
+// Both the counting and the parsing pass use this so their counts always agree.
+static inline OBJRecord classifyLine(const char* p, const char* end)
+{
+	if (p + 1 >= end)
+		return RECORD_NONE;
+
+	if (p[0] == 'v')
+	{
+		if (isBlank(p[1]))
+			return RECORD_VERTEX;
+		if (p[1] == 't')
+			return RECORD_UV;
+		if (p[1] == 'n')
+			return RECORD_NORMAL;
+	}
+	else if (p[0] == 'f' && isBlank(p[1]))
+	{
+		return RECORD_FACE;
+	}
+
+	return RECORD_NONE;
+}
+
+// A piece of the file which starts and ends on a line boundary
+typedef struct
+{
+	const char* begin;
+	const char* end;
+
+	// Number of each record in this chunk
+	size_t numVertices, numUVs, numNormals, numFaces;
+
+	// Where this chunk's records go in OBJData.
+	// OBJ indices are global, so these are also the index offsets of the chunk.
+	size_t vertexBase, uvBase, normalBase, faceBase;
+}OBJChunk;
+
+// Record counts for the whole file
+typedef struct
+{
+	size_t numVertices, numUVs, numNormals, numFaces;
+}OBJCounts;
+
+static void countOBJChunk(OBJChunk& chunk)
+{
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+
+	chunk.numVertices = chunk.numUVs = chunk.numNormals = chunk.numFaces = 0;
+
+	while (p < end)
+	{
+		p = skipBlanks(p, end);
+
+		switch (classifyLine(p, end))
+		{
+		case RECORD_VERTEX: chunk.numVertices++; break;
+		case RECORD_UV: chunk.numUVs++; break;
+		case RECORD_NORMAL: chunk.numNormals++; break;
+		case RECORD_FACE: chunk.numFaces++; break;
+		default: break;
+		}
+
+		p = skipLine(p, end);
+	}
+}
+
+// Description:
+// Splits the file into line aligned chunks (one per thread, each at least 256 KB),
+// counts the records in each chunk in parallel and works out each chunk's offsets.
+// If maxChunkSize is not 0 the file is split further so no chunk is larger than that.
+// If releaseFile is given each chunk's pages are released once it has been counted.
+static void splitOBJ(const char* data, size_t size, unsigned int numThreads,
+	std::vector<OBJChunk>& chunks, OBJCounts& counts,
+	size_t maxChunkSize = 0, TTK::MappedFile* releaseFile = nullptr)
+{
+	// Chunks smaller than this are not worth handing to another thread
+	const size_t minChunkSize = 256 * 1024;
+
+	TTK::ThreadPool& pool = TTK::ThreadPool::shared();
+
+	if (numThreads == 0)
+		numThreads = pool.numThreads() + 1; // workers + this thread
+
+	size_t numChunks = size / minChunkSize;
+	if (numChunks > numThreads)
+		numChunks = numThreads;
+	if (maxChunkSize > 0 && numChunks < size / maxChunkSize + 1)
+		numChunks = size / maxChunkSize + 1;
+	if (numChunks < 1)
+		numChunks = 1;
+
+	// Split the file into roughly equal pieces, moving each split forward to the next line
+	chunks.resize(numChunks);
+	const char* fileEnd = data + size;
+
+	const char* chunkStart = data;
+	for (size_t i = 0; i < numChunks; i++)
+	{
+		const char* chunkEnd = fileEnd;
+
+		if (i + 1 < numChunks)
+		{
+			chunkEnd = data + (size / numChunks) * (i + 1);
+			if (chunkEnd < chunkStart)
+				chunkEnd = chunkStart;
+			chunkEnd = skipLine(chunkEnd, fileEnd);
+		}
+
+		chunks[i].begin = chunkStart;
+		chunks[i].end = chunkEnd;
+		chunkStart = chunkEnd;
+	}
+
+	// Count records so each chunk knows where its data goes
+	pool.parallelFor(numChunks, [&chunks, releaseFile](unsigned int i)
+	{
+		countOBJChunk(chunks[i]);
+
+		if (releaseFile)
+			releaseFile->release(chunks[i].begin, chunks[i].end);
+	});
+
+	counts.numVertices = counts.numUVs = counts.numNormals = counts.numFaces = 0;
+	for (size_t i = 0; i < numChunks; i++)
+	{
+		chunks[i].vertexBase = counts.numVertices;
+		chunks[i].uvBase = counts.numUVs;
+		chunks[i].normalBase = counts.numNormals;
+		chunks[i].faceBase = counts.numFaces;
+
+		counts.numVertices += chunks[i].numVertices;
+		counts.numUVs += chunks[i].numUVs;
+		counts.numNormals += chunks[i].numNormals;
+		counts.numFaces += chunks[i].numFaces;
+	}
+}
+
+// Description:
+// Parses a chunk. If parseAttributes is set v/vt/vn records are written straight into their
+// slots in OBJData, which must already be sized. If parseFaces is set every face is handed to
+// faceSink(faceNumber, face) with relative indices already made absolute.
+template <typename FaceSink>
+static void parseOBJChunk(const OBJChunk& chunk, OBJData& obj, bool parseAttributes, bool parseFaces, FaceSink faceSink)
+{
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+
+	glm::vec3* vertexOut = obj.vertices.data() + chunk.vertexBase;
+	glm::vec2* uvOut = obj.uvs.data() + chunk.uvBase;
+	glm::vec3* normalOut = obj.normals.data() + chunk.normalBase;
+
+	size_t numVertices = chunk.vertexBase;
+	size_t numUVs = chunk.uvBase;
+	size_t numNormals = chunk.normalBase;
+	size_t numFaces = chunk.faceBase;
+
+	glm::vec3 temp;
+	Face3 temp2;
+
+	while (p < end)
+	{
+		p = skipBlanks(p, end);
+
+		switch (classifyLine(p, end))
+		{
+		case RECORD_VERTEX:
+			if (parseAttributes)
+			{
+				p = parseFloat(p + 1, end, temp.x);
+				p = parseFloat(p, end, temp.y);
+				p = parseFloat(p, end, temp.z);
+				*vertexOut++ = temp;
+			}
+			numVertices++;
+			break;
+
+		case RECORD_UV:
+			if (parseAttributes)
+			{
+				p = parseFloat(p + 2, end, temp.x);
+				p = parseFloat(p, end, temp.y);
+				*uvOut++ = glm::vec2(temp);
+			}
+			numUVs++;
+			break;
+
+		case RECORD_NORMAL:
+			if (parseAttributes)
+			{
+				p = parseFloat(p + 2, end, temp.x);
+				p = parseFloat(p, end, temp.y);
+				p = parseFloat(p, end, temp.z);
+				*normalOut++ = temp;
+			}
+			numNormals++;
+			break;
+
+		case RECORD_FACE:
+			if (parseFaces)
+			{
+				p = parseFaceVertex(p + 1, end, temp2.vertex1, temp2.texture1, temp2.normal1);
+				p = parseFaceVertex(p, end, temp2.vertex2, temp2.texture2, temp2.normal2);
+				p = parseFaceVertex(p, end, temp2.vertex3, temp2.texture3, temp2.normal3);
+
+				temp2.vertex1 = resolveIndex(temp2.vertex1, numVertices);
+				temp2.vertex2 = resolveIndex(temp2.vertex2, numVertices);
+				temp2.vertex3 = resolveIndex(temp2.vertex3, numVertices);
+				temp2.texture1 = resolveIndex(temp2.texture1, numUVs);
+				temp2.texture2 = resolveIndex(temp2.texture2, numUVs);
+				temp2.texture3 = resolveIndex(temp2.texture3, numUVs);
+				temp2.normal1 = resolveIndex(temp2.normal1, numNormals);
+				temp2.normal2 = resolveIndex(temp2.normal2, numNormals);
+				temp2.normal3 = resolveIndex(temp2.normal3, numNormals);
+
+				faceSink(numFaces, temp2);
+			}
+			numFaces++;
+			break;
+
+		default:
+			break;
+		}
+
+		// Comments, groups, materials and anything after the parsed values are ignored
+		p = skipLine(p, end);
+	}
+}
+
+static void sizeOBJData(OBJData& obj, const OBJCounts& counts, bool withFaces)
+{
+	obj.vertices.resize(counts.numVertices);
+	obj.uvs.resize(counts.numUVs);
+	obj.normals.resize(counts.numNormals);
+
+	if (withFaces)
+		obj.faces.resize(counts.numFaces);
+}
+
+static bool parseOBJMapped(std::string filename, OBJData& obj, size_t& bytesRead, unsigned int numThreads)
+{
+	TTK::MappedFile file;
+
+	if (!file.open(filename))
+		return false;
+
+	bytesRead = file.size();
+
+	if (file.size() == 0)
+		return true;
+
+	std::vector<OBJChunk> chunks;
+	OBJCounts counts;
+	splitOBJ(file.data(), file.size(), numThreads, chunks, counts);
+
+	sizeOBJData(obj, counts, true);
+
+	// Parse every chunk in place, no merging needed afterwards
+	TTK::ThreadPool::shared().parallelFor(chunks.size(), [&chunks, &obj](unsigned int i)
+	{
+		parseOBJChunk(chunks[i], obj, true, true, [&obj](size_t faceNumber, const Face3& face)
+		{
+			obj.faces[faceNumber] = face;
+		});
+	});
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Returns the element referenced by a 1-based OBJ index, or zero if the face left it out
+template <typename T>
+static inline T fetch(const std::vector<T>& elements, int index)
+{
+	if (index < 1 || index > (int)elements.size())
+		return T(0.0f);
+	return elements[index - 1];
+}
+
+// Expands one face into three vertices
+static inline void unpackFace(const OBJData& obj, const Face3& face,
+	glm::vec3* vertexOut, glm::vec3* normalOut, glm::vec2* uvOut)
+{
+	vertexOut[0] = fetch(obj.vertices, face.vertex1);
+	vertexOut[1] = fetch(obj.vertices, face.vertex2);
+	vertexOut[2] = fetch(obj.vertices, face.vertex3);
+
+	normalOut[0] = fetch(obj.normals, face.normal1);
+	normalOut[1] = fetch(obj.normals, face.normal2);
+	normalOut[2] = fetch(obj.normals, face.normal3);
+
+	uvOut[0] = fetch(obj.uvs, face.texture1);
+	uvOut[1] = fetch(obj.uvs, face.texture2);
+	uvOut[2] = fetch(obj.uvs, face.texture3);
+}
+
+// Expands faces [firstFace, lastFace) into three vertices each
+static void unpackFaces(const OBJData& obj, size_t firstFace, size_t lastFace,
+	glm::vec3* vertexOut, glm::vec3* normalOut, glm::vec2* uvOut)
+{
+	for (size_t i = firstFace; i < lastFace; i++)
+	{
+		unpackFace(obj, obj.faces[i], vertexOut, normalOut, uvOut);
+
+		vertexOut += 3;
+		normalOut += 3;
+		uvOut += 3;
+	}
+}
+
+// One face corner, as written in the file ("v/vt/vn")
+typedef struct
+{
+	int vertex, texture, normal;
+}Corner;
+
+static inline unsigned int hashCorner(const Corner& corner)
+{
+	unsigned int hash = (unsigned int)corner.vertex * 73856093u;
+	hash ^= (unsigned int)corner.texture * 19349663u;
+	hash ^= (unsigned int)corner.normal * 83492791u;
+	return hash * 2654435761u;
+}
+
+// Description:
+// Creates one output vertex per unique (v, vt, vn) corner and an index for every face corner.
+// Faces must be added in file order so the output does not depend on how they are fed in.
+// Corners are looked up in an open addressing hash table which is sized from the number of
+// attributes (a good guess for the number of unique corners) and doubled when half full.
+class CornerIndexer
+{
+public:
+	CornerIndexer(const OBJData& _obj, size_t numFaces, std::vector<glm::vec3>& _vertexOut,
+		std::vector<glm::vec3>& _normalOut, std::vector<glm::vec2>& _uvOut, std::vector<unsigned int>& _indexOut)
+		: obj(_obj),
+		vertexOut(_vertexOut),
+		normalOut(_normalOut),
+		uvOut(_uvOut),
+		indexOut(_indexOut)
+	{
+		firstVertex = vertexOut.size();
+
+		size_t expectedVertices = obj.vertices.size();
+		if (obj.uvs.size() > expectedVertices)
+			expectedVertices = obj.uvs.size();
+		if (obj.normals.size() > expectedVertices)
+			expectedVertices = obj.normals.size();
+
+		tableSize = 16;
+		while (tableSize < expectedVertices * 2)
+			tableSize *= 2;
+
+		table.assign(tableSize, 0);
+		uniqueCorners.reserve(expectedVertices);
+
+		vertexOut.reserve(firstVertex + expectedVertices);
+		normalOut.reserve(firstVertex + expectedVertices);
+		uvOut.reserve(firstVertex + expectedVertices);
+		indexOut.reserve(indexOut.size() + numFaces * 3);
+	}
+
+	void addFace(const Face3& face)
+	{
+		Corner corners[3] =
+		{
+			{ face.vertex1, face.texture1, face.normal1 },
+			{ face.vertex2, face.texture2, face.normal2 },
+			{ face.vertex3, face.texture3, face.normal3 }
+		};
+
+		for (int c = 0; c < 3; c++)
+			indexOut.push_back(firstVertex + findOrAdd(corners[c]));
+	}
+
+private:
+	// Returns the vertex number for a corner, adding a new vertex if it has not been seen
+	unsigned int findOrAdd(const Corner& corner)
+	{
+		size_t slot = hashCorner(corner) & (tableSize - 1);
+
+		// Linear probe until we find this corner or an empty slot
+		while (table[slot] != 0)
+		{
+			const Corner& existing = uniqueCorners[table[slot] - 1];
+			if (existing.vertex == corner.vertex && existing.texture == corner.texture && existing.normal == corner.normal)
+				return table[slot] - 1;
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		uniqueCorners.push_back(corner);
+		table[slot] = uniqueCorners.size();
+
+		vertexOut.push_back(fetch(obj.vertices, corner.vertex));
+		normalOut.push_back(fetch(obj.normals, corner.normal));
+		uvOut.push_back(fetch(obj.uvs, corner.texture));
+
+		if (uniqueCorners.size() * 2 > tableSize)
+			grow();
+
+		return uniqueCorners.size() - 1;
+	}
+
+	void grow()
+	{
+		tableSize *= 2;
+		table.assign(tableSize, 0);
+
+		for (size_t i = 0; i < uniqueCorners.size(); i++)
+		{
+			size_t slot = hashCorner(uniqueCorners[i]) & (tableSize - 1);
+			while (table[slot] != 0)
+				slot = (slot + 1) & (tableSize - 1);
+			table[slot] = i + 1;
+		}
+	}
+
+	const OBJData& obj;
+	std::vector<glm::vec3>& vertexOut;
+	std::vector<glm::vec3>& normalOut;
+	std::vector<glm::vec2>& uvOut;
+	std::vector<unsigned int>& indexOut;
+
+	unsigned int firstVertex;
+
+	// Slots hold (vertex number + 1), 0 means empty
+	std::vector<unsigned int> table;
+	size_t tableSize;
+	std::vector<Corner> uniqueCorners;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Streaming
+// Faces are never stored, they are turned into output vertices while
+// the file is parsed. Only the v/vt/vn arrays and the output are in memory.
+//////////////////////////////////////////////////////////////////////////
+
+static bool loadOBJStreaming(std::string filename, TTK::OBJMesh& mesh, const TTK::OBJLoadOptions& options,
+	size_t& bytesRead, size_t& numFaces, bool& uploaded)
+{
+	TTK::MappedFile file;
+	uploaded = false;
+
+	if (!file.open(filename))
+		return false;
+
+	bytesRead = file.size();
+	numFaces = 0;
+
+	if (file.size() == 0)
+		return true;
+
+	TTK::ThreadPool& pool = TTK::ThreadPool::shared();
+
+	// Small chunks, and every pass hands a chunk's pages of the file back once it is done
+	// with them, so only a few chunks of the file are ever in the working set at once
+	const size_t streamChunkSize = 4 * 1024 * 1024;
+
+	std::vector<OBJChunk> chunks;
+	OBJCounts counts;
+	splitOBJ(file.data(), file.size(), options.numThreads, chunks, counts, streamChunkSize, &file);
+
+	numFaces = counts.numFaces;
+
+	// Pass 1: attributes only, faces reference them from anywhere in the file
+	OBJData obj;
+	sizeOBJData(obj, counts, false);
+
+	pool.parallelFor(chunks.size(), [&chunks, &obj, &file](unsigned int i)
+	{
+		parseOBJChunk(chunks[i], obj, true, false, [](size_t, const Face3&) {});
+		file.release(chunks[i].begin, chunks[i].end);
+	});
+
+	// Pass 2: faces, straight into the output
+	if (options.indexed)
+	{
+		// Unique vertices are numbered in file order, so chunks are indexed one after another
+		CornerIndexer indexer(obj, numFaces, mesh.vertices, mesh.normals, mesh.textureCoordinates, mesh.indices);
+
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			parseOBJChunk(chunks[i], obj, false, true, [&indexer](size_t, const Face3& face)
+			{
+				indexer.addFace(face);
+			});
+			file.release(chunks[i].begin, chunks[i].end);
+		}
+
+		return true;
+	}
+
+	glm::vec3* vertexOut;
+	glm::vec3* normalOut;
+	glm::vec2* uvOut;
+	size_t outputStart = 0;
+	unsigned int numOutputVertices = numFaces * 3;
+	bool mapped = options.streamToGPU && numOutputVertices > 0;
+
+	if (mapped)
+	{
+		// Allocate the GL buffers empty and write the triangles into them directly,
+		// the mesh's own arrays are never filled
+		mesh.vbo.destroy();
+		mesh.vbo.setInterleaved(false);
+		mesh.addAttribute(AttributeLocations::VERTEX, "vertex", nullptr, numOutputVertices, 3);
+		mesh.addAttribute(AttributeLocations::TEX_COORD, "uv", nullptr, numOutputVertices, 2);
+		mesh.addAttribute(AttributeLocations::NORMAL, "normal", nullptr, numOutputVertices, 3);
+		mesh.vbo.createVBO();
+
+		vertexOut = (glm::vec3*)mesh.vbo.mapAttributeArray(0);
+		uvOut = (glm::vec2*)mesh.vbo.mapAttributeArray(1);
+		normalOut = (glm::vec3*)mesh.vbo.mapAttributeArray(2);
+	}
+	else
+	{
+		outputStart = mesh.vertices.size();
+		mesh.vertices.resize(outputStart + numOutputVertices);
+		mesh.normals.resize(outputStart + numOutputVertices);
+		mesh.textureCoordinates.resize(outputStart + numOutputVertices);
+
+		vertexOut = mesh.vertices.data() + outputStart;
+		normalOut = mesh.normals.data() + outputStart;
+		uvOut = mesh.textureCoordinates.data() + outputStart;
+	}
+
+	// The CPU arrays are always there (null only when there are no faces to write)
+	bool written = !mapped || (vertexOut && normalOut && uvOut);
+
+	if (written)
+	{
+		// Every face has its own three slots, so chunks can write in parallel
+		pool.parallelFor(chunks.size(), [&](unsigned int i)
+		{
+			parseOBJChunk(chunks[i], obj, false, true, [&](size_t faceNumber, const Face3& face)
+			{
+				unpackFace(obj, face, vertexOut + faceNumber * 3, normalOut + faceNumber * 3, uvOut + faceNumber * 3);
+			});
+			file.release(chunks[i].begin, chunks[i].end);
+		});
+	}
+	else
+	{
+		std::cout << "Error - OBJMesh::loadMesh could not map vertex buffers for " << filename << std::endl;
+	}
+
+	if (mapped)
+	{
+		// Whatever did map is unmapped, even after a failure. GL_FALSE means the contents were
+		// lost while mapped (a mode switch...) and the buffer holds garbage
+		bool unmapped = true;
+		if (vertexOut)
+			unmapped = mesh.vbo.unmapAttributeArray(0) && unmapped;
+		if (uvOut)
+			unmapped = mesh.vbo.unmapAttributeArray(1) && unmapped;
+		if (normalOut)
+			unmapped = mesh.vbo.unmapAttributeArray(2) && unmapped;
+
+		if (written && !unmapped)
+			std::cout << "Error - OBJMesh::loadMesh vertex buffers were lost while writing " << filename << std::endl;
+
+		// Don't leave a mesh with uninitialized buffers behind
+		if (!written || !unmapped)
+		{
+			mesh.vbo.destroy();
+			return false;
+		}
+
+		uploaded = true;
+
+		// There are no output vertices on the CPU to compute the bounds from, use the positions in the file
+		if (obj.vertices.size() > 0)
+		{
+			mesh.boundsMin = mesh.boundsMax = obj.vertices[0];
+			for (size_t i = 1; i < obj.vertices.size(); i++)
+			{
+				mesh.boundsMin = glm::min(mesh.boundsMin, obj.vertices[i]);
+				mesh.boundsMax = glm::max(mesh.boundsMax, obj.vertices[i]);
+			}
+		}
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Loader settings which change the output, a cache file built with other settings is rebuilt
+enum OBJCacheFlags
+{
+	CACHE_INDEXED = 1 << 0,
+	CACHE_OPTIMIZED = 1 << 1,
+	CACHE_REDUCED_OVERDRAW = 1 << 2,
+
+	// Vertex formats, two bits each
+	CACHE_POSITION_FORMAT_SHIFT = 8,
+	CACHE_NORMAL_FORMAT_SHIFT = 10,
+	CACHE_TEX_COORD_FORMAT_SHIFT = 12,
+
+	// Number of levels of detail (4 bits) and the triangle ratio between them in percent (7 bits)
+	CACHE_NUM_LODS_SHIFT = 14,
+	CACHE_LOD_RATIO_SHIFT = 18
+};
+
+static unsigned int getCacheFlags(const TTK::OBJLoadOptions& options)
+{
+	unsigned int flags = 0;
+
+	if (options.indexed)
+		flags |= CACHE_INDEXED;
+
+	if (options.optimize)
+		flags |= CACHE_OPTIMIZED;
+
+	if (options.optimize && options.reduceOverdraw)
+		flags |= CACHE_REDUCED_OVERDRAW;
+
+	flags |= options.vertexFormat.positions << CACHE_POSITION_FORMAT_SHIFT;
+	flags |= options.vertexFormat.normals << CACHE_NORMAL_FORMAT_SHIFT;
+	flags |= options.vertexFormat.texCoords << CACHE_TEX_COORD_FORMAT_SHIFT;
+
+	if (options.numLODs > 0)
+	{
+		flags |= std::min(options.numLODs, 15u) << CACHE_NUM_LODS_SHIFT;
+		flags |= ((unsigned int)(options.lodTriangleRatio * 100.0f + 0.5f) & 127) << CACHE_LOD_RATIO_SHIFT;
+	}
+
+	return flags;
+}
+
+static void reportLoad(std::string filename, const char* source, size_t numBytes, size_t numTriangles, size_t numVertices,
+	std::chrono::high_resolution_clock::time_point startTime)
+{
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+	double megabytes = numBytes / (1024.0 * 1024.0);
+
+	std::cout << "OBJMesh::loadMesh " << filename << " (" << source << "): " << megabytes << " MB, "
+		<< numTriangles << " triangles, " << numVertices << " vertices in " << elapsed.count() * 1000.0 << " ms ("
+		<< (elapsed.count() > 0.0 ? megabytes / elapsed.count() : 0.0) << " MB/s), peak RSS "
+		<< TTK::IO::getPeakMemoryUsage() / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+static void optimizeOBJ(std::string filename, TTK::OBJMesh& mesh, const TTK::OBJLoadOptions& options)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	TTK::VertexCacheStats before, after;
+	TTK::MeshOptimizer::optimize(mesh, options.reduceOverdraw, TTK::MeshOptimizer::DEFAULT_CACHE_SIZE, &before, &after);
+
+	if (options.reportThroughput)
+	{
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+
+		std::cout << "OBJMesh::loadMesh " << filename << " optimized in " << elapsed.count() * 1000.0 << " ms: ACMR "
+			<< before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr
+			<< " (" << TTK::MeshOptimizer::DEFAULT_CACHE_SIZE << " entry cache)" << std::endl;
+	}
+}
+
+static void generateOBJLODs(std::string filename, TTK::OBJMesh& mesh, const TTK::OBJLoadOptions& options)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	TTK::MeshSimplifier::generateLODs(mesh, std::min(options.numLODs, 15u), options.lodTriangleRatio);
+
+	if (options.reportThroughput && mesh.lods.size() > 0)
+	{
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+
+		std::cout << "OBJMesh::loadMesh " << filename << " built " << mesh.lods.size() - 1 << " LODs in "
+			<< elapsed.count() * 1000.0 << " ms, triangles:";
+
+		for (unsigned int i = 0; i < mesh.lods.size(); i++)
+			std::cout << " " << mesh.lods[i].numIndices / 3 << " (error " << mesh.lods[i].error << ")";
+
+		std::cout << std::endl;
+	}
+}
+
+// Description:
+// Fills the mesh's arrays from the OBJ file (with streamToGPU, its vbo instead, and sets uploaded).
+// Everything but streamToGPU is free of OpenGL calls and can run on a worker thread.
+static bool loadOBJData(std::string filename, TTK::OBJMesh& mesh, const TTK::OBJLoadOptions& options,
+	const char*& source, size_t& fileSize, size_t& numFaces, bool& uploaded)
+{
+	bool loaded;
+
+	fileSize = 0;
+	numFaces = 0;
+	uploaded = false;
+
+	if (options.streaming && options.backend != TTK::OBJ_LOADER_STREAM)
+	{
+		source = "streaming";
+		loaded = loadOBJStreaming(filename, mesh, options, fileSize, numFaces, uploaded);
+
+		if (loaded && !uploaded)
+			mesh.computeBounds();
+
+		if (loaded && !uploaded && options.optimize)
+			optimizeOBJ(filename, mesh, options);
+
+		if (loaded && !uploaded)
+			generateOBJLODs(filename, mesh, options);
+
+		return loaded;
+	}
+
+	OBJData obj;
+	source = options.backend == TTK::OBJ_LOADER_STREAM ? "stream" : "mapped";
+
+	if (options.backend == TTK::OBJ_LOADER_STREAM)
+		loaded = parseOBJStream(filename, obj, fileSize);
+	else
+		loaded = parseOBJMapped(filename, obj, fileSize, options.numThreads);
+
+	numFaces = obj.faces.size();
+
 	// Unpack data
-	vertices.reserve(objVertices.size());
-	normals.reserve(objNormals.size());
-	textureCoordinates.reserve(objUVs.size());
+	if (loaded && options.indexed)
+	{
+		CornerIndexer indexer(obj, numFaces, mesh.vertices, mesh.normals, mesh.textureCoordinates, mesh.indices);
+
+		for (size_t i = 0; i < numFaces; i++)
+			indexer.addFace(obj.faces[i]);
+	}
+	else if (loaded && numFaces > 0)
+	{
+		size_t outputStart = mesh.vertices.size();
+
+		mesh.vertices.resize(outputStart + numFaces * 3);
+		mesh.normals.resize(outputStart + numFaces * 3);
+		mesh.textureCoordinates.resize(outputStart + numFaces * 3);
+
+		// Every face writes to its own three slots, so ranges of faces can be unpacked in parallel
+		unsigned int numRanges = 1;
+		if (options.backend != TTK::OBJ_LOADER_STREAM && options.numThreads != 1)
+			numRanges = (unsigned int)(numFaces / 65536) + 1;
+
+		TTK::ThreadPool::shared().parallelFor(numRanges, [&](unsigned int range)
+		{
+			size_t firstFace = numFaces * range / numRanges;
+			size_t lastFace = numFaces * (range + 1) / numRanges;
+			size_t firstVertex = outputStart + firstFace * 3;
+
+			unpackFaces(obj, firstFace, lastFace,
+				mesh.vertices.data() + firstVertex, mesh.normals.data() + firstVertex, mesh.textureCoordinates.data() + firstVertex);
+		});
+	}
+
+	if (loaded)
+		mesh.computeBounds();
+
+	if (loaded && options.optimize)
+		optimizeOBJ(filename, mesh, options);
+
+	if (loaded)
+		generateOBJLODs(filename, mesh, options);
+
+	return loaded;
+}
+
+TTK::OBJMesh::~OBJMesh()
+{
+	cancelPendingLoad();
+}
 
-	for (int i = 0; i < objFaces.size(); i++)
+void TTK::OBJMesh::cancelPendingLoad()
+{
+	if (pendingLoad && !pendingLoad->isDone())
+		pendingLoad->cancel();
+
+	pendingLoad.reset();
+}
+
+void TTK::OBJMesh::loadMesh(std::string filename, OBJLoadOptions options)
+{
+	TTK_PROFILE_ZONE("OBJMesh::loadMesh");
+
+	// The async load would overwrite this one when it lands
+	cancelPendingLoad();
+
+	// The arena would keep drawing the old triangles, the mesh is added again when next drawn
+	GeometryArena::shared().removeMesh(this);
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	if (options.optimize || options.numLODs > 0)
+		options.indexed = true;
+
+	vertexFormat = options.vertexFormat;
+	vbo.setInterleaved(options.interleaved);
+
+	// Try the binary cache first
+	MeshCacheKey cacheKey;
+	std::string cacheFileName = MeshCache::getCacheFileName(filename);
+	bool useCache = options.useCache && MeshCache::makeKey(filename, options.validateCacheHash, getCacheFlags(options), cacheKey);
+
+	if (useCache && MeshCache::load(cacheFileName, cacheKey, *this, options.keepCPUData))
 	{
-		Face3* face = &objFaces[i];
+		if (options.reportThroughput)
+		{
+			// Only the full detail triangles, the index array holds every level of detail
+			unsigned int numCorners = vbo.getNumIndices() > 0 ? vbo.getNumIndices() : vbo.getNumVertices();
+			if (lods.size() > 0)
+				numCorners = lods[0].numIndices;
+			reportLoad(filename, "cache", (size_t)cacheKey.sourceSize, numCorners / 3, vbo.getNumVertices(), startTime);
+		}
+		return;
+	}
 
-		vertices.push_back(objVertices[face->vertex1 - 1]);
-		vertices.push_back(objVertices[face->vertex2 - 1]);
-		vertices.push_back(objVertices[face->vertex3 - 1]);
+	size_t fileSize;
+	size_t numFaces;
+	const char* source;
+	bool uploaded;
 
-		normals.push_back(objNormals[face->normal1 - 1]);
-		normals.push_back(objNormals[face->normal2 - 1]);
-		normals.push_back(objNormals[face->normal3 - 1]);
+	//check if file opened
+	if (!loadOBJData(filename, *this, options, source, fileSize, numFaces, uploaded))
+	{
+		std::cout << "Error - OBJMesh::loadMesh file: " << filename << " not found.\n";
+		return;
+	}
+
+	if (uploaded)
+	{
+		// The mapped buffers hold plain floats whatever options.vertexFormat asked for
+		vertexFormat = VertexFormat();
+		positionScale = glm::vec3(1.0f);
+		positionOffset = glm::vec3(0.0f);
 
-		textureCoordinates.push_back(objUVs[face->texture1 - 1]);
-		textureCoordinates.push_back(objUVs[face->texture2 - 1]);
-		textureCoordinates.push_back(objUVs[face->texture3 - 1]);
+		// Triangles went straight to the GPU, there is nothing on the CPU to cache
+		if (options.reportThroughput)
+			reportLoad(filename, source, fileSize, numFaces, vbo.getNumVertices(), startTime);
+		return;
 	}
 
-	createVBO();
+	prepareVBO();
+	vbo.createVBO();
+
+	if (options.reportThroughput)
+		reportLoad(filename, source, fileSize, numFaces, vertices.size(), startTime);
+
+	if (useCache)
+		MeshCache::write(cacheFileName, cacheKey, *this);
+
+	// The GPU has its own copy now
+	if (options.keepCPUData)
+		freePackedArrays();
+	else
+		freeCPUData();
 }
 
+TTK::MeshLoadHandle TTK::OBJMesh::loadMeshAsync(std::string filename, OBJLoadOptions options)
+{
+	MeshLoadHandle handle = std::make_shared<MeshLoadStatus>();
+	MeshBase* target = this;
+
+	cancelPendingLoad();
+	pendingLoad = handle;
+
+	// Mapping GL buffers only works on the GL thread
+	options.streamToGPU = false;
+
+	if (options.optimize || options.numLODs > 0)
+		options.indexed = true;
+
+	// The worker only ever touches its own copy, this mesh may be drawn meanwhile
+	std::shared_ptr<OBJMesh> staging = std::make_shared<OBJMesh>();
+	staging->vertexFormat = options.vertexFormat;
+	staging->vbo.setInterleaved(options.interleaved);
+
+	ThreadPool::shared().enqueue([staging, target, handle, filename, options]()
+	{
+		OBJMesh* mesh = staging.get();
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		MeshCacheKey cacheKey;
+		std::string cacheFileName = MeshCache::getCacheFileName(filename);
+		bool useCache = options.useCache && MeshCache::makeKey(filename, options.validateCacheHash, getCacheFlags(options), cacheKey);
+
+		const char* source = "cache";
+		size_t fileSize = (size_t)cacheKey.sourceSize;
+		size_t numFaces;
+		bool uploaded;
+		bool fromCache = useCache && MeshCache::read(cacheFileName, cacheKey, *mesh);
+
+		if (fromCache)
+		{
+			numFaces = (mesh->indices.size() > 0 ? mesh->indices.size() : mesh->vertices.size()) / 3;
+
+			if (mesh->lods.size() > 0)
+				numFaces = mesh->lods[0].numIndices / 3;
+		}
+		else if (!loadOBJData(filename, *mesh, options, source, fileSize, numFaces, uploaded))
+		{
+			std::cout << "Error - OBJMesh::loadMeshAsync file: " << filename << " not found.\n";
+			handle->setState(MESH_LOAD_FAILED);
+			return;
+		}
+
+		if (mesh->vertices.size() == 0)
+		{
+			// Nothing to draw, the target keeps what it had and never gets an empty vertex array
+			std::cout << "Error - OBJMesh::loadMeshAsync file: " << filename << " has no triangles.\n";
+			handle->setState(MESH_LOAD_FAILED);
+			return;
+		}
+
+		mesh->prepareVBO();
+
+		if (options.reportThroughput)
+			reportLoad(filename, source, fileSize, numFaces, mesh->vertices.size(), startTime);
+
+		if (useCache && !fromCache)
+			MeshCache::write(cacheFileName, cacheKey, *mesh);
+
+		MeshUploadQueue::shared().push(staging, target, handle, options.keepCPUData);
+	});
+
+	return handle;
+}
@@ -0,0 +1,181 @@
+#include "TTK/Profiler.h"
+
+#ifdef TTK_PROFILE
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	// Names are code identifiers, but a quote or backslash would break the JSON
+	std::string escapeJSON(const std::string& str)
+	{
+		std::string escaped;
+
+		for (size_t i = 0; i < str.length(); i++)
+		{
+			if (str[i] == '"' || str[i] == '\\')
+				escaped += '\\';
+
+			escaped += str[i];
+		}
+
+		return escaped;
+	}
+}
+
+TTK::Profiler::Profiler()
+{
+	startTime = std::chrono::high_resolution_clock::now();
+	lastFrameEnd = 0;
+	frameNumber = 0;
+	spikeMilliseconds = 0.0;
+	spikeCooldownFrames = 0;
+	lastSpikeFrame = 0;
+}
+
+TTK::Profiler& TTK::Profiler::shared()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+long long TTK::Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+void TTK::Profiler::record(const char* name, long long start, long long end)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+
+	// Only this thread writes numEvents, so a relaxed load is enough
+	unsigned long long index = buffer.numEvents.load(std::memory_order_relaxed);
+
+	Event& event = buffer.events[index % EVENTS_PER_THREAD];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+
+	// The event is written before writeChromeTrace can see it counted
+	buffer.numEvents.store(index + 1, std::memory_order_release);
+}
+
+void TTK::Profiler::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	buffer.name = name;
+}
+
+void TTK::Profiler::endFrame()
+{
+	long long frameEnd = now();
+	record("Frame", lastFrameEnd, frameEnd);
+
+	double frameMilliseconds = (frameEnd - lastFrameEnd) / 1000000.0;
+	lastFrameEnd = frameEnd;
+	frameNumber++;
+
+	bool coolingDown = lastSpikeFrame > 0 && frameNumber - lastSpikeFrame <= spikeCooldownFrames;
+
+	// The first frame includes loading, it is always slow
+	if (spikeMilliseconds > 0.0 && frameNumber > 1 && frameMilliseconds > spikeMilliseconds && !coolingDown)
+	{
+		std::ostringstream fileName;
+		fileName << spikeFilePrefix << frameNumber << ".json";
+
+		std::cout << "Profiler: frame " << frameNumber << " took " << frameMilliseconds << " ms, writing " << fileName.str() << std::endl;
+		writeChromeTrace(fileName.str());
+		lastSpikeFrame = frameNumber;
+
+		// The next frame starts once the file is written, or writing it would make that frame a spike too
+		lastFrameEnd = now();
+	}
+}
+
+void TTK::Profiler::setSpikeThreshold(double milliseconds, const std::string& filePrefix, unsigned int cooldownFrames)
+{
+	spikeMilliseconds = milliseconds;
+	spikeFilePrefix = filePrefix;
+	spikeCooldownFrames = cooldownFrames;
+}
+
+bool TTK::Profiler::writeChromeTrace(const std::string& fileName)
+{
+	std::ofstream file(fileName);
+
+	if (!file.is_open())
+	{
+		std::cout << "Profiler Error: Cannot write file: " << fileName << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(buffersMutex);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+	file << std::fixed << std::setprecision(3);
+
+	bool first = true;
+	std::vector<Event> events;
+
+	for (unsigned int i = 0; i < buffers.size(); i++)
+	{
+		ThreadBuffer& buffer = *buffers[i];
+
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id
+			<< ",\"args\":{\"name\":\"" << escapeJSON(buffer.name) << "\"}}";
+		first = false;
+
+		// The thread keeps recording while this copies. Anything it could have
+		// overwritten since (or be half way through overwriting) is left out
+		unsigned long long countBefore = buffer.numEvents.load(std::memory_order_acquire);
+		events.assign(buffer.events.begin(), buffer.events.end());
+		unsigned long long countAfter = buffer.numEvents.load(std::memory_order_acquire);
+
+		unsigned long long firstEvent = countBefore > EVENTS_PER_THREAD ? countBefore - EVENTS_PER_THREAD : 0;
+
+		if (countAfter + 1 > EVENTS_PER_THREAD && countAfter + 1 - EVENTS_PER_THREAD > firstEvent)
+			firstEvent = countAfter + 1 - EVENTS_PER_THREAD;
+
+		for (unsigned long long j = firstEvent; j < countBefore; j++)
+		{
+			const Event& event = events[j % EVENTS_PER_THREAD];
+
+			// Complete events, timestamps in microseconds
+			file << ",\n{\"name\":\"" << escapeJSON(event.name) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.id
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+		}
+	}
+
+	file << std::endl << "]}" << std::endl;
+
+	return file.good();
+}
+
+TTK::Profiler::ThreadBuffer& TTK::Profiler::getThreadBuffer()
+{
+	// Each thread finds its buffer once, after that there is no locking
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+
+	if (!threadBuffer)
+	{
+		std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+		buffer->events.resize(EVENTS_PER_THREAD);
+		buffer->numEvents = 0;
+
+		std::lock_guard<std::mutex> lock(buffersMutex);
+
+		buffer->id = buffers.size() + 1;
+		buffer->name = buffers.size() == 0 ? "Main" : "Thread " + std::to_string(buffer->id);
+		threadBuffer = buffer.get();
+		buffers.push_back(std::move(buffer));
+	}
+
+	return *threadBuffer;
+}
+
+#endif
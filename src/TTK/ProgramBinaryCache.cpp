@@ -0,0 +1,213 @@
+#include "TTK/ProgramBinaryCache.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string.h>
+#include <stdio.h>
+
+// On disk layout:
+//   FileHeader
+//   program binary, binarySize bytes
+
+typedef struct
+{
+	char magic[8];					// "TTKPROG"
+	unsigned int version;
+	unsigned int binaryFormat;		// From glGetProgramBinary
+	unsigned long long sourceHash;
+	unsigned long long driverHash;
+	unsigned long long binarySize;
+	double compileMilliseconds;
+}FileHeader;
+
+static_assert(sizeof(FileHeader) == 48, "FileHeader layout changed, bump ProgramBinaryCache::VERSION");
+
+static const char cacheMagic[8] = { 'T', 'T', 'K', 'P', 'R', 'O', 'G', '\0' };
+
+static bool cacheEnabled = true;
+
+// 64-bit FNV-1a, continuing from hash
+static unsigned long long hashBytes(const char* data, size_t size, unsigned long long hash = 14695981039346656037ull)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static unsigned long long hashString(const std::string& str, unsigned long long hash)
+{
+	// Hash the length too, so "ab" + "c" and "a" + "bc" differ
+	unsigned long long length = str.length();
+	hash = hashBytes((const char*)&length, sizeof(length), hash);
+	return hashBytes(str.c_str(), str.length(), hash);
+}
+
+static std::string getGLString(GLenum name)
+{
+	const char* str = (const char*)glGetString(name);
+	return str ? str : "";
+}
+
+void TTK::ProgramBinaryCache::setEnabled(bool enabled)
+{
+	cacheEnabled = enabled;
+}
+
+bool TTK::ProgramBinaryCache::isEnabled()
+{
+	return cacheEnabled;
+}
+
+bool TTK::ProgramBinaryCache::isSupported()
+{
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+		return false;
+
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+	return numFormats > 0;
+}
+
+std::string TTK::ProgramBinaryCache::getCacheFileName(const std::vector<std::string>& shaderFileNames)
+{
+	if (shaderFileNames.size() == 0)
+		return "";
+
+	unsigned long long hash = 14695981039346656037ull;
+
+	for (unsigned int i = 0; i < shaderFileNames.size(); i++)
+		hash = hashString(shaderFileNames[i], hash);
+
+	std::ostringstream name;
+	name << shaderFileNames[0] << "." << std::hex << std::setw(16) << std::setfill('0') << hash << ".ttkprog";
+	return name.str();
+}
+
+TTK::ProgramCacheKey TTK::ProgramBinaryCache::makeKey(const std::vector<GLenum>& shaderTypes, const std::vector<std::string>& shaderSources)
+{
+	ProgramCacheKey key;
+	key.sourceHash = 14695981039346656037ull;
+
+	for (unsigned int i = 0; i < shaderSources.size(); i++)
+	{
+		unsigned int type = i < shaderTypes.size() ? shaderTypes[i] : 0;
+		key.sourceHash = hashBytes((const char*)&type, sizeof(type), key.sourceHash);
+		key.sourceHash = hashString(shaderSources[i], key.sourceHash);
+	}
+
+	// Same GPU with a driver update gives a different version string
+	key.driverHash = 14695981039346656037ull;
+	key.driverHash = hashString(getGLString(GL_VENDOR), key.driverHash);
+	key.driverHash = hashString(getGLString(GL_RENDERER), key.driverHash);
+	key.driverHash = hashString(getGLString(GL_VERSION), key.driverHash);
+
+	return key;
+}
+
+bool TTK::ProgramBinaryCache::load(std::string cacheFileName, const ProgramCacheKey& key, GLuint program, double& compileMilliseconds)
+{
+	std::ifstream file(cacheFileName, std::ios::in | std::ios::binary);
+
+	if (!file.is_open())
+		return false;
+
+	FileHeader header;
+
+	if (!file.read((char*)&header, sizeof(header)) ||
+		memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != VERSION)
+		return false;
+
+	if (header.sourceHash != key.sourceHash)
+	{
+		std::cout << "ProgramBinaryCache: " << cacheFileName << " is stale, shader source changed" << std::endl;
+		return false;
+	}
+
+	if (header.driverHash != key.driverHash)
+	{
+		std::cout << "ProgramBinaryCache: " << cacheFileName << " is from another driver" << std::endl;
+		return false;
+	}
+
+	std::vector<char> binary((size_t)header.binarySize);
+
+	if (binary.size() == 0 || !file.read(&binary[0], binary.size()))
+		return false;
+
+	glProgramBinary(program, header.binaryFormat, &binary[0], binary.size());
+
+	// Drivers may still turn a binary down, after an update that didn't change the version string say
+	GLint linkStatus = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+
+	if (!linkStatus)
+	{
+		std::cout << "ProgramBinaryCache: driver rejected " << cacheFileName << std::endl;
+		return false;
+	}
+
+	compileMilliseconds = header.compileMilliseconds;
+	return true;
+}
+
+bool TTK::ProgramBinaryCache::write(std::string cacheFileName, const ProgramCacheKey& key, GLuint program, double compileMilliseconds)
+{
+	GLint binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+
+	if (binarySize <= 0)
+		return false;
+
+	std::vector<char> binary(binarySize);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, binarySize, &binarySize, &binaryFormat, &binary[0]);
+
+	if (binarySize <= 0)
+		return false;
+
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = VERSION;
+	header.binaryFormat = binaryFormat;
+	header.sourceHash = key.sourceHash;
+	header.driverHash = key.driverHash;
+	header.binarySize = binarySize;
+	header.compileMilliseconds = compileMilliseconds;
+
+	// Write to a temporary file first so a crash never leaves a half written cache behind
+	std::string tempFileName = cacheFileName + ".tmp";
+	std::ofstream file(tempFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "ProgramBinaryCache Error: Cannot write file: " << cacheFileName << std::endl;
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write(&binary[0], binarySize);
+
+	bool ok = file.good();
+	file.close();
+
+	if (ok)
+	{
+		remove(cacheFileName.c_str());
+		ok = rename(tempFileName.c_str(), cacheFileName.c_str()) == 0;
+	}
+
+	if (!ok)
+	{
+		std::cout << "ProgramBinaryCache Error: Cannot write file: " << cacheFileName << std::endl;
+		remove(tempFileName.c_str());
+	}
+
+	return ok;
+}
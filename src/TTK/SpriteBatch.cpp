@@ -0,0 +1,240 @@
+#include "TTK/SpriteBatch.h"
+#include "TTK/GLState.h"
+#include <algorithm>
+#include <cstring>
+
+TTK::SpriteBatch::SpriteBatch(unsigned int maxSprites)
+	: maxSprites(std::max(maxSprites, 1u))
+{
+	sortMode = SPRITE_SORT_TEXTURE;
+	vaoHandle = 0;
+	vboHandle = 0;
+	iboHandle = 0;
+	indexType = GL_UNSIGNED_SHORT;
+	numDrawCalls = 0;
+	numSprites = 0;
+}
+
+TTK::SpriteBatch::~SpriteBatch()
+{
+	destroy();
+}
+
+void TTK::SpriteBatch::begin(SpriteSortMode mode)
+{
+	sortMode = mode;
+	sprites.clear();
+	vertices.clear();
+}
+
+void TTK::SpriteBatch::addVertex(glm::vec3 position, glm::vec2 uv, glm::vec4 colour)
+{
+	SpriteVertex vertex;
+	vertex.position = position;
+	vertex.uv = uv;
+
+	glm::vec4 c = glm::clamp(colour, 0.0f, 1.0f) * 255.0f + 0.5f;
+	vertex.colour[0] = (unsigned char)c.r;
+	vertex.colour[1] = (unsigned char)c.g;
+	vertex.colour[2] = (unsigned char)c.b;
+	vertex.colour[3] = (unsigned char)c.a;
+
+	vertices.push_back(vertex);
+}
+
+void TTK::SpriteBatch::draw(Texture2D* texture, glm::vec2 position, glm::vec2 size,
+	glm::vec4 uvRect, glm::vec4 colour, float rotation, float depth)
+{
+	Sprite sprite;
+	sprite.texture = texture;
+	sprite.firstVertex = vertices.size();
+	sprites.push_back(sprite);
+
+	// Half size axes, rotated
+	float c = cos(rotation);
+	float s = sin(rotation);
+	glm::vec2 right = glm::vec2(c, s) * size.x * 0.5f;
+	glm::vec2 up = glm::vec2(-s, c) * size.y * 0.5f;
+
+	// Same corner order as QuadMesh
+	addVertex(glm::vec3(position - right - up, depth), glm::vec2(uvRect.x, uvRect.y), colour); // bottom left
+	addVertex(glm::vec3(position - right + up, depth), glm::vec2(uvRect.x, uvRect.w), colour); // top left
+	addVertex(glm::vec3(position + right + up, depth), glm::vec2(uvRect.z, uvRect.w), colour); // top right
+	addVertex(glm::vec3(position + right - up, depth), glm::vec2(uvRect.z, uvRect.y), colour); // bottom right
+}
+
+void TTK::SpriteBatch::draw(Texture2D* texture, const QuadMesh& quad, const glm::mat4& model)
+{
+	if (quad.vertices.size() < 4)
+		return;
+
+	Sprite sprite;
+	sprite.texture = texture;
+	sprite.firstVertex = vertices.size();
+	sprites.push_back(sprite);
+
+	bool hasTexCoords = quad.textureCoordinates.size() >= 4;
+	bool hasColours = quad.colours.size() >= 4;
+
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		addVertex(glm::vec3(model * glm::vec4(quad.vertices[i], 1.0f)),
+			hasTexCoords ? quad.textureCoordinates[i] : glm::vec2(0.0f),
+			hasColours ? quad.colours[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+}
+
+void TTK::SpriteBatch::end()
+{
+	numDrawCalls = 0;
+	numSprites = sprites.size();
+
+	if (sprites.empty())
+		return;
+
+	// Stable, so sprites with the same texture keep the order they were queued in
+	if (sortMode == SPRITE_SORT_TEXTURE)
+	{
+		std::stable_sort(sprites.begin(), sprites.end(),
+			[](const Sprite& a, const Sprite& b) { return a.texture < b.texture; });
+	}
+
+	if (!vaoHandle)
+		createBuffers();
+
+	GLState::shared().bindVertexArray(vaoHandle);
+
+	for (unsigned int first = 0; first < sprites.size(); first += maxSprites)
+		flush(first, std::min(maxSprites, (unsigned int)sprites.size() - first));
+
+	GLState::shared().bindVertexArray(0);
+
+	sprites.clear();
+	vertices.clear();
+}
+
+void TTK::SpriteBatch::flush(unsigned int first, unsigned int count)
+{
+	size_t quadSize = 4 * sizeof(SpriteVertex);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vboHandle);
+
+	// Invalidating lets the driver hand back fresh memory instead of waiting for the last draw to finish with it
+	unsigned char* out = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, count * quadSize,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	if (!out)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+		memcpy(out + i * quadSize, &vertices[sprites[first + i].firstVertex], quadSize);
+
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	unsigned int indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	// One draw for each run of sprites with the same texture
+	unsigned int runStart = 0;
+	Texture2D* boundTexture = nullptr;
+
+	while (runStart < count)
+	{
+		Texture2D* texture = sprites[first + runStart].texture;
+		unsigned int runEnd = runStart + 1;
+
+		while (runEnd < count && sprites[first + runEnd].texture == texture)
+			runEnd++;
+
+		if (texture)
+			texture->bind();
+		else if (boundTexture)
+			boundTexture->unbind();
+
+		boundTexture = texture;
+
+		glDrawElements(GL_TRIANGLES, (runEnd - runStart) * 6, indexType, (const void*)((size_t)runStart * 6 * indexSize));
+		numDrawCalls++;
+
+		runStart = runEnd;
+	}
+
+	if (boundTexture)
+		boundTexture->unbind();
+}
+
+void TTK::SpriteBatch::createBuffers()
+{
+	glGenVertexArrays(1, &vaoHandle);
+	GLState::shared().bindVertexArray(vaoHandle);
+
+	glGenBuffers(1, &vboHandle);
+	glBindBuffer(GL_ARRAY_BUFFER, vboHandle);
+	glBufferData(GL_ARRAY_BUFFER, (size_t)maxSprites * 4 * sizeof(SpriteVertex), nullptr, GL_STREAM_DRAW);
+
+	const VertexElement* elements = VertexLayout<SpriteVertex>::getElements();
+
+	for (unsigned int i = 0; i < VertexLayout<SpriteVertex>::numElements; i++)
+	{
+		glEnableVertexAttribArray(elements[i].attributeLocation);
+		glVertexAttribPointer(elements[i].attributeLocation, elements[i].numComponents, elements[i].elementType,
+			elements[i].normalized ? GL_TRUE : GL_FALSE, sizeof(SpriteVertex), (const void*)(size_t)elements[i].offset);
+	}
+
+	// Two triangles per quad: bottom left, top left, top right and bottom left, top right, bottom right
+	glGenBuffers(1, &iboHandle);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboHandle);
+
+	if ((size_t)maxSprites * 4 <= 65536)
+	{
+		std::vector<unsigned short> indices(maxSprites * 6);
+
+		for (unsigned int i = 0; i < maxSprites; i++)
+		{
+			unsigned short v = i * 4;
+			unsigned short quad[6] = { v, (unsigned short)(v + 1), (unsigned short)(v + 2), v, (unsigned short)(v + 2), (unsigned short)(v + 3) };
+			std::copy(quad, quad + 6, &indices[i * 6]);
+		}
+
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
+		indexType = GL_UNSIGNED_SHORT;
+	}
+	else
+	{
+		std::vector<unsigned int> indices(maxSprites * 6);
+
+		for (unsigned int i = 0; i < maxSprites; i++)
+		{
+			unsigned int v = i * 4;
+			unsigned int quad[6] = { v, v + 1, v + 2, v, v + 2, v + 3 };
+			std::copy(quad, quad + 6, &indices[i * 6]);
+		}
+
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		indexType = GL_UNSIGNED_INT;
+	}
+
+	GLState::shared().bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Don't unbind the element array while the VAO is bound, that would remove it from the VAO
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void TTK::SpriteBatch::destroy()
+{
+	if (vaoHandle)
+	{
+		GLState::shared().forgetVertexArray(vaoHandle);
+		glDeleteVertexArrays(1, &vaoHandle);
+		glDeleteBuffers(1, &vboHandle);
+		glDeleteBuffers(1, &iboHandle);
+		vaoHandle = vboHandle = iboHandle = 0;
+	}
+
+	sprites.clear();
+	vertices.clear();
+}
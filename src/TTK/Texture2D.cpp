@@ -1,5 +1,7 @@
 #include "GLEW/glew.h"
 #include "TTK/Texture2D.h"
+#include "TTK/GLState.h"
+#include "TTK/Profiler.h"
 #include "IL/ilut.h"
 
 TTK::Texture2D::Texture2D()
@@ -16,6 +18,7 @@ TTK::Texture2D::Texture2D(std::string filename)
 
 TTK::Texture2D::~Texture2D()
 {
+	GLState::shared().forgetTexture(texID);
 	glDeleteTextures(1, &texID);
 }
 
@@ -31,6 +34,8 @@ int TTK::Texture2D::height()
 
 void TTK::Texture2D::loadTexture(std::string filename, bool createGLTexture, bool flip)
 {
+	TTK_PROFILE_ZONE("Texture2D::loadTexture");
+
 	glEnable(GL_TEXTURE_2D);
 
 	ilGenImages(1, &texID);
@@ -55,7 +60,7 @@ void TTK::Texture2D::loadTexture(std::string filename, bool createGLTexture, boo
 	if (createGLTexture)
 	{
 		glGenTextures(1, &texID);
-		glBindTexture(GL_TEXTURE_2D, texID);
+		GLState::shared().bindTexture(GL_TEXTURE_2D, texID);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -63,7 +68,7 @@ void TTK::Texture2D::loadTexture(std::string filename, bool createGLTexture, boo
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texWidth, texHeight, 0, pixelFormat, dataType, dataPtr);
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::shared().bindTexture(GL_TEXTURE_2D, 0);
 	}
 
 	ILenum Error;
@@ -77,18 +82,16 @@ void TTK::Texture2D::bind(GLenum textureUnit /* = GL_TEXTURE0 */)
 {
 /*	glEnable(GL_TEXTURE_2D);*/
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLState::shared().enable(GL_BLEND);
+	GLState::shared().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, texID);
+	GLState::shared().bindTexture(textureUnit, GL_TEXTURE_2D, texID);
 }
 
 void TTK::Texture2D::unbind(GLenum textureUnit /* = GL_TEXTURE0 */)
 {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glDisable(GL_BLEND);
+	GLState::shared().bindTexture(textureUnit, GL_TEXTURE_2D, 0);
+	GLState::shared().disable(GL_BLEND);
 }
 
 unsigned int TTK::Texture2D::id()
@@ -0,0 +1,129 @@
+#include "TTK/ThreadPool.h"
+#include "TTK/Profiler.h"
+#include <atomic>
+#include <memory>
+
+TTK::ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	stopping = false;
+
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+
+	// hardware_concurrency is allowed to return 0 if it does not know
+	if (numThreads == 0)
+		numThreads = 1;
+
+	for (unsigned int i = 0; i < numThreads; i++)
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+TTK::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+
+	queueCondition.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+TTK::ThreadPool& TTK::ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+unsigned int TTK::ThreadPool::numThreads()
+{
+	return workers.size();
+}
+
+void TTK::ThreadPool::enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		tasks.push(task);
+	}
+
+	queueCondition.notify_one();
+}
+
+void TTK::ThreadPool::parallelFor(unsigned int count, std::function<void(unsigned int)> func)
+{
+	if (count == 0)
+		return;
+
+	if (count == 1 || workers.empty())
+	{
+		for (unsigned int i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	// Items are handed out through an atomic counter, whoever is free takes the next one.
+	// Helpers which only start after all items are taken find nothing to do and return,
+	// so we only wait for the items, never for the helpers.
+	struct Job
+	{
+		std::atomic<unsigned int> nextItem;
+		std::atomic<unsigned int> itemsDone;
+		std::mutex doneMutex;
+		std::condition_variable doneCondition;
+	};
+
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->nextItem = 0;
+	job->itemsDone = 0;
+
+	auto work = [job, count, func]()
+	{
+		unsigned int item;
+		while ((item = job->nextItem++) < count)
+		{
+			func(item);
+
+			if (++job->itemsDone == count)
+			{
+				std::lock_guard<std::mutex> lock(job->doneMutex);
+				job->doneCondition.notify_all();
+			}
+		}
+	};
+
+	unsigned int numHelpers = count - 1 < workers.size() ? count - 1 : workers.size();
+
+	for (unsigned int i = 0; i < numHelpers; i++)
+		enqueue(work);
+
+	work();
+
+	std::unique_lock<std::mutex> lock(job->doneMutex);
+	job->doneCondition.wait(lock, [&job, count]() { return job->itemsDone == count; });
+}
+
+void TTK::ThreadPool::workerLoop()
+{
+	TTK_PROFILE_THREAD_NAME("Worker");
+
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			if (stopping && tasks.empty())
+				return;
+
+			task = tasks.front();
+			tasks.pop();
+		}
+
+		task();
+	}
+}
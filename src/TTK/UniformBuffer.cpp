@@ -0,0 +1,147 @@
+#include "TTK/UniformBuffer.h"
+#include <iostream>
+#include <cstring>
+
+TTK::UniformBuffer::UniformBuffer()
+{
+	handle = 0;
+	size = 0;
+}
+
+TTK::UniformBuffer::~UniformBuffer()
+{
+	destroy();
+}
+
+void TTK::UniformBuffer::setData(const void* data, size_t dataSize)
+{
+	if (!handle)
+		glGenBuffers(1, &handle);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, handle);
+
+	// Orphan and fill in one go
+	glBufferData(GL_UNIFORM_BUFFER, dataSize, data, GL_STREAM_DRAW);
+	size = dataSize;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void TTK::UniformBuffer::bindBase(GLuint binding)
+{
+	if (handle)
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, handle);
+}
+
+void TTK::UniformBuffer::destroy()
+{
+	if (handle)
+	{
+		glDeleteBuffers(1, &handle);
+		handle = 0;
+	}
+
+	size = 0;
+}
+
+TTK::UniformRing::UniformRing(size_t size)
+	: size(size)
+{
+	handle = 0;
+	head = 0;
+	alignment = 0;
+}
+
+TTK::UniformRing::~UniformRing()
+{
+	destroy();
+}
+
+void TTK::UniformRing::create()
+{
+	glGenBuffers(1, &handle);
+	glBindBuffer(GL_UNIFORM_BUFFER, handle);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	head = 0;
+}
+
+size_t TTK::UniformRing::write(const void* data, size_t dataSize)
+{
+	if (!handle)
+		create();
+
+	glBindBuffer(GL_UNIFORM_BUFFER, handle);
+
+	head = align(head);
+
+	if (head + dataSize > size)
+	{
+		// Too big for the ring at all, make it big enough for twice as much
+		if (dataSize > size)
+		{
+			std::cout << "UniformRing: growing from " << size << " to " << dataSize * 2 << " bytes" << std::endl;
+			size = dataSize * 2;
+		}
+
+		// Wrap around, with new storage since draws queued earlier may still read the old one
+		glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		head = 0;
+	}
+
+	size_t offset = head;
+
+	void* destination = glMapBufferRange(GL_UNIFORM_BUFFER, offset, dataSize,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+	if (destination)
+	{
+		memcpy(destination, data, dataSize);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+	}
+	else
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, dataSize, data);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	head += dataSize;
+	return offset;
+}
+
+void TTK::UniformRing::bindRange(GLuint binding, size_t offset, size_t rangeSize)
+{
+	if (handle)
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, handle, offset, rangeSize);
+}
+
+size_t TTK::UniformRing::getAlignment()
+{
+	if (!alignment)
+	{
+		GLint value = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+		alignment = value > 0 ? value : 256;
+	}
+
+	return alignment;
+}
+
+size_t TTK::UniformRing::align(size_t value)
+{
+	size_t a = getAlignment();
+	return (value + a - 1) / a * a;
+}
+
+void TTK::UniformRing::destroy()
+{
+	if (handle)
+	{
+		glDeleteBuffers(1, &handle);
+		handle = 0;
+	}
+
+	head = 0;
+}
@@ -0,0 +1,410 @@
+#include "TTK/VertexPacking.h"
+#include <string.h>
+
+unsigned short TTK::VertexPacking::floatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int floatExponent = (bits >> 23) & 0xff;
+	unsigned int mantissa = bits & 0x7fffff;
+	int exponent = (int)floatExponent - 127 + 15;
+
+	// Infinity and NaN
+	if (floatExponent == 0xff)
+		return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+	// Too big, becomes infinity
+	if (exponent >= 31)
+		return sign | 0x7c00;
+
+	unsigned int half;
+	unsigned int shift;
+
+	if (exponent <= 0)
+	{
+		// Too small even for a denormal
+		if (exponent < -10)
+			return sign;
+
+		mantissa |= 0x800000;
+		shift = 14 - exponent;
+		half = mantissa >> shift;
+	}
+	else
+	{
+		shift = 13;
+		half = (exponent << 10) | (mantissa >> shift);
+	}
+
+	// Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+	unsigned int remainder = mantissa & ((1u << shift) - 1);
+	unsigned int halfway = 1u << (shift - 1);
+
+	if (remainder > halfway || (remainder == halfway && (half & 1)))
+		half++;
+
+	return sign | half;
+}
+
+float TTK::VertexPacking::halfToFloat(unsigned short value)
+{
+	unsigned int sign = (value & 0x8000) << 16;
+	unsigned int exponent = (value >> 10) & 0x1f;
+	unsigned int mantissa = value & 0x3ff;
+	unsigned int bits;
+
+	if (exponent == 0)
+	{
+		// Zero and denormals
+		float f = mantissa * (1.0f / 16777216.0f);
+		return sign ? -f : f;
+	}
+
+	if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static inline short floatToSnorm16(float value)
+{
+	value = glm::clamp(value, -1.0f, 1.0f) * 32767.0f;
+	return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+}
+
+static inline float snorm16ToFloat(short value)
+{
+	return glm::max(value / 32767.0f, -1.0f);
+}
+
+static inline unsigned int floatToSnorm10(float value)
+{
+	value = glm::clamp(value, -1.0f, 1.0f) * 511.0f;
+	int i = (int)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+	return (unsigned int)i & 0x3ff;
+}
+
+static inline float snorm10ToFloat(unsigned int bits)
+{
+	// Sign extend the 10 bit value
+	int i = (int)(bits << 22) >> 22;
+	return glm::max(i / 511.0f, -1.0f);
+}
+
+// Octahedron normal encoding: the unit sphere is folded onto an octahedron,
+// which is unfolded into the -1..1 square
+static glm::vec2 octEncode(glm::vec3 n)
+{
+	float sum = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+
+	if (sum == 0.0f)
+		return glm::vec2(0.0f);
+
+	n /= sum;
+
+	if (n.z >= 0.0f)
+		return glm::vec2(n.x, n.y);
+
+	return glm::vec2((1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+static glm::vec3 octDecode(glm::vec2 e)
+{
+	glm::vec3 n(e.x, e.y, 1.0f - glm::abs(e.x) - glm::abs(e.y));
+	float t = glm::max(-n.z, 0.0f);
+
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+
+	return glm::normalize(n);
+}
+
+// Fills in everything but the location and name
+static void describeArray(AttributeDescriptor& attrib, GLenum type, unsigned int elementSize, unsigned int numPerVertex,
+	size_t numVertices, bool normalized, std::vector<unsigned char>& out)
+{
+	out.resize(numVertices * numPerVertex * elementSize);
+
+	attrib.elementType = type;
+	attrib.elementSize = elementSize;
+	attrib.numElementsPerAttrib = numPerVertex;
+	attrib.numElements = numVertices * numPerVertex;
+	attrib.normalized = normalized;
+	attrib.data = out.size() > 0 ? &out[0] : nullptr;
+}
+
+void TTK::VertexPacking::getPositionQuantization(PositionFormat format, glm::vec3 boundsMin, glm::vec3 boundsMax,
+	glm::vec3& scale, glm::vec3& offset)
+{
+	scale = glm::vec3(1.0f);
+	offset = glm::vec3(0.0f);
+
+	if (format == POSITION_FLOAT)
+		return;
+
+	// Half floats are most precise near zero, so both formats are relative to the middle of the bounds
+	offset = (boundsMin + boundsMax) * 0.5f;
+
+	if (format == POSITION_SNORM16)
+	{
+		scale = (boundsMax - boundsMin) * 0.5f;
+
+		// Flat along an axis, anything works as long as it isn't zero
+		for (int i = 0; i < 3; i++)
+		{
+			if (scale[i] <= 0.0f)
+				scale[i] = 1.0f;
+		}
+	}
+}
+
+void TTK::VertexPacking::packPositions(const std::vector<glm::vec3>& positions, PositionFormat format, glm::vec3 scale, glm::vec3 offset,
+	std::vector<unsigned char>& out, AttributeDescriptor& attrib)
+{
+	size_t numVertices = positions.size();
+
+	attrib.attributeLocation = AttributeLocations::VERTEX;
+	attrib.attributeName = "vertex";
+
+	if (format == POSITION_FLOAT)
+	{
+		describeArray(attrib, GL_FLOAT, sizeof(float), 3, numVertices, false, out);
+		if (numVertices > 0)
+			memcpy(&out[0], &positions[0], numVertices * sizeof(glm::vec3));
+		return;
+	}
+
+	// Four components instead of three keep every vertex 4 byte aligned
+	if (format == POSITION_HALF)
+	{
+		describeArray(attrib, GL_HALF_FLOAT, sizeof(unsigned short), 4, numVertices, false, out);
+		unsigned short* packed = (unsigned short*)attrib.data;
+
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			glm::vec3 p = (positions[i] - offset) / scale;
+			packed[i * 4 + 0] = floatToHalf(p.x);
+			packed[i * 4 + 1] = floatToHalf(p.y);
+			packed[i * 4 + 2] = floatToHalf(p.z);
+			packed[i * 4 + 3] = 0;
+		}
+	}
+	else
+	{
+		describeArray(attrib, GL_SHORT, sizeof(short), 4, numVertices, true, out);
+		short* packed = (short*)attrib.data;
+
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			glm::vec3 p = (positions[i] - offset) / scale;
+			packed[i * 4 + 0] = floatToSnorm16(p.x);
+			packed[i * 4 + 1] = floatToSnorm16(p.y);
+			packed[i * 4 + 2] = floatToSnorm16(p.z);
+			packed[i * 4 + 3] = 0;
+		}
+	}
+}
+
+void TTK::VertexPacking::packNormals(const std::vector<glm::vec3>& normals, NormalFormat format,
+	std::vector<unsigned char>& out, AttributeDescriptor& attrib)
+{
+	size_t numVertices = normals.size();
+
+	attrib.attributeLocation = AttributeLocations::NORMAL;
+	attrib.attributeName = "normal";
+
+	if (format == NORMAL_FLOAT)
+	{
+		describeArray(attrib, GL_FLOAT, sizeof(float), 3, numVertices, false, out);
+		if (numVertices > 0)
+			memcpy(&out[0], &normals[0], numVertices * sizeof(glm::vec3));
+	}
+	else if (format == NORMAL_OCT16)
+	{
+		describeArray(attrib, GL_SHORT, sizeof(short), 2, numVertices, true, out);
+		short* packed = (short*)attrib.data;
+
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			glm::vec2 e = octEncode(normals[i]);
+			packed[i * 2 + 0] = floatToSnorm16(e.x);
+			packed[i * 2 + 1] = floatToSnorm16(e.y);
+		}
+	}
+	else
+	{
+		// The four components share one 32 bit word, so each one counts as a byte
+		describeArray(attrib, GL_INT_2_10_10_10_REV, 1, 4, numVertices, true, out);
+		unsigned int* packed = (unsigned int*)attrib.data;
+
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			packed[i] = floatToSnorm10(normals[i].x) |
+				(floatToSnorm10(normals[i].y) << 10) |
+				(floatToSnorm10(normals[i].z) << 20);
+		}
+	}
+}
+
+void TTK::VertexPacking::packTexCoords(const std::vector<glm::vec2>& texCoords, TexCoordFormat format,
+	std::vector<unsigned char>& out, AttributeDescriptor& attrib)
+{
+	size_t numVertices = texCoords.size();
+
+	attrib.attributeLocation = AttributeLocations::TEX_COORD;
+	attrib.attributeName = "uv";
+
+	if (format == TEX_COORD_FLOAT)
+	{
+		describeArray(attrib, GL_FLOAT, sizeof(float), 2, numVertices, false, out);
+		if (numVertices > 0)
+			memcpy(&out[0], &texCoords[0], numVertices * sizeof(glm::vec2));
+		return;
+	}
+
+	// Half floats rather than normalized shorts, so uvs outside 0..1 (tiling) still work
+	describeArray(attrib, GL_HALF_FLOAT, sizeof(unsigned short), 2, numVertices, false, out);
+	unsigned short* packed = (unsigned short*)attrib.data;
+
+	for (size_t i = 0; i < numVertices; i++)
+	{
+		packed[i * 2 + 0] = floatToHalf(texCoords[i].x);
+		packed[i * 2 + 1] = floatToHalf(texCoords[i].y);
+	}
+}
+
+bool TTK::VertexPacking::unpackPositions(const AttributeDescriptor& attrib, glm::vec3 scale, glm::vec3 offset, std::vector<glm::vec3>& out)
+{
+	unsigned int stride = attrib.numElementsPerAttrib;
+	unsigned int numVertices = stride > 0 ? attrib.numElements / stride : 0;
+
+	if (stride < 3)
+		return false;
+
+	out.resize(numVertices);
+
+	if (attrib.elementType == GL_FLOAT)
+	{
+		const float* packed = (const float*)attrib.data;
+		for (unsigned int i = 0; i < numVertices; i++)
+			out[i] = glm::vec3(packed[i * stride], packed[i * stride + 1], packed[i * stride + 2]) * scale + offset;
+	}
+	else if (attrib.elementType == GL_HALF_FLOAT)
+	{
+		const unsigned short* packed = (const unsigned short*)attrib.data;
+		for (unsigned int i = 0; i < numVertices; i++)
+			out[i] = glm::vec3(halfToFloat(packed[i * stride]), halfToFloat(packed[i * stride + 1]), halfToFloat(packed[i * stride + 2])) * scale + offset;
+	}
+	else if (attrib.elementType == GL_SHORT && attrib.normalized)
+	{
+		const short* packed = (const short*)attrib.data;
+		for (unsigned int i = 0; i < numVertices; i++)
+			out[i] = glm::vec3(snorm16ToFloat(packed[i * stride]), snorm16ToFloat(packed[i * stride + 1]), snorm16ToFloat(packed[i * stride + 2])) * scale + offset;
+	}
+	else
+	{
+		out.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool TTK::VertexPacking::unpackNormals(const AttributeDescriptor& attrib, std::vector<glm::vec3>& out)
+{
+	unsigned int stride = attrib.numElementsPerAttrib;
+	unsigned int numVertices = stride > 0 ? attrib.numElements / stride : 0;
+
+	out.resize(numVertices);
+
+	if (attrib.elementType == GL_FLOAT && stride == 3)
+	{
+		if (numVertices > 0)
+			memcpy(&out[0], attrib.data, numVertices * sizeof(glm::vec3));
+	}
+	else if (attrib.elementType == GL_SHORT && attrib.normalized && stride == 2)
+	{
+		const short* packed = (const short*)attrib.data;
+		for (unsigned int i = 0; i < numVertices; i++)
+			out[i] = octDecode(glm::vec2(snorm16ToFloat(packed[i * 2]), snorm16ToFloat(packed[i * 2 + 1])));
+	}
+	else if (attrib.elementType == GL_INT_2_10_10_10_REV && stride == 4)
+	{
+		const unsigned int* packed = (const unsigned int*)attrib.data;
+		for (unsigned int i = 0; i < numVertices; i++)
+			out[i] = glm::vec3(snorm10ToFloat(packed[i] & 0x3ff), snorm10ToFloat((packed[i] >> 10) & 0x3ff), snorm10ToFloat((packed[i] >> 20) & 0x3ff));
+	}
+	else
+	{
+		out.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool TTK::VertexPacking::unpackTexCoords(const AttributeDescriptor& attrib, std::vector<glm::vec2>& out)
+{
+	unsigned int stride = attrib.numElementsPerAttrib;
+	unsigned int numVertices = stride > 0 ? attrib.numElements / stride : 0;
+
+	out.resize(numVertices);
+
+	if (attrib.elementType == GL_FLOAT && stride == 2)
+	{
+		if (numVertices > 0)
+			memcpy(&out[0], attrib.data, numVertices * sizeof(glm::vec2));
+	}
+	else if (attrib.elementType == GL_HALF_FLOAT && stride == 2)
+	{
+		const unsigned short* packed = (const unsigned short*)attrib.data;
+		for (unsigned int i = 0; i < numVertices; i++)
+			out[i] = glm::vec2(halfToFloat(packed[i * 2]), halfToFloat(packed[i * 2 + 1]));
+	}
+	else
+	{
+		out.clear();
+		return false;
+	}
+
+	return true;
+}
+
+TTK::VertexFormat TTK::VertexPacking::getVertexFormat(const std::vector<AttributeDescriptor>& attributes)
+{
+	VertexFormat format;
+
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		const AttributeDescriptor& attrib = attributes[i];
+
+		if (attrib.attributeLocation == AttributeLocations::VERTEX)
+		{
+			if (attrib.elementType == GL_HALF_FLOAT)
+				format.positions = POSITION_HALF;
+			else if (attrib.elementType == GL_SHORT)
+				format.positions = POSITION_SNORM16;
+		}
+		else if (attrib.attributeLocation == AttributeLocations::NORMAL)
+		{
+			if (attrib.elementType == GL_SHORT)
+				format.normals = NORMAL_OCT16;
+			else if (attrib.elementType == GL_INT_2_10_10_10_REV)
+				format.normals = NORMAL_SNORM_10_10_10_2;
+		}
+		else if (attrib.attributeLocation == AttributeLocations::TEX_COORD)
+		{
+			if (attrib.elementType == GL_HALF_FLOAT)
+				format.texCoords = TEX_COORD_HALF;
+		}
+	}
+
+	return format;
+}
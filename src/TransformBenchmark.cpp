@@ -0,0 +1,568 @@
+// Transform microbenchmarks
+//
+// Builds forests of GameObjects of different sizes, depths and fan-outs and times the
+// transform code every frame goes through: GameObject::update (local matrices and the
+// world matrices passed down the hierarchy), getWorldPosition and getWorldRotation.
+//
+// The same propagation is then run over flat arrays in three ways, to see what SIMD buys:
+//	scalar		glm::mat4, what GameObject uses
+//	aligned		glm's aligned_highp types, whose vec4 maths glm does with SSE
+//	glm_simd	the glm/simd functions (glm_mat4_mul) on __m128 columns
+// "compose" builds each local matrix from position, rotation and scale like
+// GameObject::update and then multiplies by the parent's, "multiply" only does the
+// parent * local multiply with the locals made up front. Each is checked against the
+// GameObject world matrices, maxError is the largest difference in any element.
+//
+//	TransformBenchmark [--counts 10000,100000,1000000] [--repeats N] [--output file.json]
+//
+// The results go out as JSON, one entry per hierarchy, size and test, so a script can
+// compare a run against an earlier one. Build without TTK_PROFILE, or the profiler's
+// zone in GameObject::update gets timed too.
+
+// Core Libraries
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+// 3rd Party Libraries
+#include <GLM/glm.hpp>
+#include <GLM/gtc/matrix_transform.hpp>
+#include <GLM/gtc/type_aligned.hpp>
+#include <GLM/gtc/type_ptr.hpp>
+#include <GLM/gtx/transform.hpp>
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <GLM/simd/matrix.h>
+#define TTK_TRANSFORM_SIMD
+#endif
+
+// User Libraries
+#include "GameObject.h"
+
+// Shape of a forest: trees of depth levels, each node with fanout children
+struct HierarchyShape
+{
+public:
+	const char* name;
+	unsigned int depth;
+	unsigned int fanout;
+};
+
+const HierarchyShape HIERARCHY_SHAPES[] =
+{
+	{ "flat", 1, 0 },		// Every object a root
+	{ "wide", 3, 32 },		// 1057 objects a tree
+	{ "binary", 10, 2 },	// 1023 objects a tree
+	{ "deep", 100, 1 }		// Chains of 100
+};
+
+// Local transforms of every object, parents always before their children
+struct TransformArrays
+{
+public:
+	std::vector<int> parents;			// -1 for roots
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> angles;		// Degrees, as GameObject takes them
+	std::vector<float> scales;
+};
+
+// One timed test, times in milliseconds
+struct TestResult
+{
+public:
+	std::string hierarchy;
+	unsigned int numObjects;
+	unsigned int depth;
+	unsigned int fanout;
+	std::string test;
+	double minMs;
+	double medianMs;
+	double maxMs;
+	double nsPerObject;		// From the median
+	double maxError;		// Largest difference from the GameObject world matrices, -1 if not checked
+};
+
+#ifdef TTK_TRANSFORM_SIMD
+typedef glm::tmat4x4<float, glm::aligned_highp> AlignedMat4;
+typedef glm::tvec3<float, glm::aligned_highp> AlignedVec3;
+
+// A glm/simd matrix, its 4 columns. glm_vec4 can't be a template argument
+// without losing its alignment attribute, so the arrays hold these instead
+struct alignas(16) SimdMat4
+{
+public:
+	glm_vec4 c[4];
+};
+
+// Heap array of 16 byte aligned elements, std::vector only promises 8 on 32-bit Windows
+template <typename T>
+class AlignedArray
+{
+public:
+	AlignedArray(size_t size) { data = (T*)_mm_malloc(size * sizeof(T), 16); }
+	~AlignedArray() { _mm_free(data); }
+
+	T& operator[](size_t i) { return data[i]; }
+	const T& operator[](size_t i) const { return data[i]; }
+
+private:
+	AlignedArray(const AlignedArray&);
+	AlignedArray& operator=(const AlignedArray&);
+
+	T* data;
+};
+#endif
+
+namespace
+{
+	// Keeps results alive so the optimizer can't drop the loops making them
+	volatile float sink;
+
+	// Same numbers on every compiler, unlike <random>'s distributions
+	unsigned int randomState = 12345;
+
+	float randomFloat(float min, float max)
+	{
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+
+		return min + (max - min) * (randomState % 65536) / 65535.0f;
+	}
+
+	float maxDifference(const glm::mat4& a, const float* b)
+	{
+		float difference = 0.0f;
+
+		for (unsigned int i = 0; i < 16; i++)
+			difference = std::max(difference, std::abs(glm::value_ptr(a)[i] - b[i]));
+
+		return difference;
+	}
+}
+
+// Description:
+// Parents for numObjects objects making trees of shape, breadth first so every parent
+// comes before its children. The last tree is cut short to make the count.
+TransformArrays makeHierarchy(const HierarchyShape& shape, unsigned int numObjects)
+{
+	TransformArrays arrays;
+	arrays.parents.reserve(numObjects);
+
+	while (arrays.parents.size() < numObjects)
+	{
+		size_t levelStart = arrays.parents.size();
+		arrays.parents.push_back(-1);
+		size_t levelEnd = arrays.parents.size();
+
+		for (unsigned int level = 1; level < shape.depth && arrays.parents.size() < numObjects; level++)
+		{
+			for (size_t parent = levelStart; parent < levelEnd; parent++)
+			{
+				for (unsigned int child = 0; child < shape.fanout && arrays.parents.size() < numObjects; child++)
+					arrays.parents.push_back((int)parent);
+			}
+
+			levelStart = levelEnd;
+			levelEnd = arrays.parents.size();
+		}
+	}
+
+	randomState = 12345;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+	{
+		arrays.positions.push_back(glm::vec3(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f)));
+		arrays.angles.push_back(glm::vec3(randomFloat(0.0f, 360.0f), randomFloat(0.0f, 360.0f), randomFloat(0.0f, 360.0f)));
+
+		// Scales around 1, so deep chains don't blow up or shrink away
+		arrays.scales.push_back(randomFloat(0.9f, 1.1f));
+	}
+
+	return arrays;
+}
+
+// Description:
+// Runs test repeats times (after one run to warm the caches) and returns the times.
+// test is any callable, called with no arguments.
+template <typename Test>
+TestResult timeTest(Test test, unsigned int repeats, unsigned int numObjects)
+{
+	std::vector<double> times;
+
+	test();
+
+	for (unsigned int i = 0; i < repeats; i++)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		test();
+		times.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+	}
+
+	std::sort(times.begin(), times.end());
+
+	TestResult result;
+	result.numObjects = numObjects;
+	result.minMs = times[0];
+	result.medianMs = times[(times.size() - 1) / 2];
+	result.maxMs = times[times.size() - 1];
+	result.nsPerObject = result.medianMs * 1000000.0 / numObjects;
+	result.maxError = -1.0;
+
+	return result;
+}
+
+// Object i's local matrix, made the way GameObject::update makes it
+inline glm::mat4 makeLocalScalar(const TransformArrays& arrays, size_t i)
+{
+	glm::mat4 rx = glm::rotate(glm::radians(arrays.angles[i].x), glm::vec3(1.0f, 0.0f, 0.0f));
+	glm::mat4 ry = glm::rotate(glm::radians(arrays.angles[i].y), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 rz = glm::rotate(glm::radians(arrays.angles[i].z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	return glm::translate(arrays.positions[i]) * (rz * ry * rx) * glm::scale(glm::vec3(arrays.scales[i]));
+}
+
+// GameObject::update's maths over the arrays with plain glm::mat4
+void composeScalar(const TransformArrays& arrays, std::vector<glm::mat4>& world)
+{
+	for (size_t i = 0; i < arrays.parents.size(); i++)
+	{
+		glm::mat4 local = makeLocalScalar(arrays, i);
+
+		world[i] = arrays.parents[i] < 0 ? local : world[arrays.parents[i]] * local;
+	}
+}
+
+void multiplyScalar(const std::vector<int>& parents, const std::vector<glm::mat4>& local, std::vector<glm::mat4>& world)
+{
+	for (size_t i = 0; i < parents.size(); i++)
+		world[i] = parents[i] < 0 ? local[i] : world[parents[i]] * local[i];
+}
+
+#ifdef TTK_TRANSFORM_SIMD
+// The same with aligned types, every vec4 operation in the matrix maths is one SSE instruction
+void composeAligned(const TransformArrays& arrays, AlignedArray<AlignedMat4>& world)
+{
+	const AlignedMat4 identity(1.0f);
+
+	for (size_t i = 0; i < arrays.parents.size(); i++)
+	{
+		AlignedMat4 rx = glm::rotate(identity, glm::radians(arrays.angles[i].x), AlignedVec3(1.0f, 0.0f, 0.0f));
+		AlignedMat4 ry = glm::rotate(identity, glm::radians(arrays.angles[i].y), AlignedVec3(0.0f, 1.0f, 0.0f));
+		AlignedMat4 rz = glm::rotate(identity, glm::radians(arrays.angles[i].z), AlignedVec3(0.0f, 0.0f, 1.0f));
+
+		AlignedMat4 local = glm::translate(identity, AlignedVec3(arrays.positions[i])) * (rz * ry * rx)
+			* glm::scale(identity, AlignedVec3(arrays.scales[i]));
+
+		world[i] = arrays.parents[i] < 0 ? local : world[arrays.parents[i]] * local;
+	}
+}
+
+void multiplyAligned(const std::vector<int>& parents, const AlignedArray<AlignedMat4>& local, AlignedArray<AlignedMat4>& world)
+{
+	for (size_t i = 0; i < parents.size(); i++)
+		world[i] = parents[i] < 0 ? local[i] : world[parents[i]] * local[i];
+}
+
+// And with glm/simd, 4 columns per matrix. It has no rotate, so the
+// rotations about each axis are filled in from their sine and cosine
+void composeGLMSIMD(const TransformArrays& arrays, AlignedArray<SimdMat4>& world)
+{
+	for (size_t i = 0; i < arrays.parents.size(); i++)
+	{
+		glm::vec3 angles = glm::radians(arrays.angles[i]);
+		glm::vec3 c = glm::cos(angles);
+		glm::vec3 s = glm::sin(angles);
+
+		glm_vec4 rx[4] = { _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f), _mm_setr_ps(0.0f, c.x, s.x, 0.0f), _mm_setr_ps(0.0f, -s.x, c.x, 0.0f), _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f) };
+		glm_vec4 ry[4] = { _mm_setr_ps(c.y, 0.0f, -s.y, 0.0f), _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f), _mm_setr_ps(s.y, 0.0f, c.y, 0.0f), _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f) };
+		glm_vec4 rz[4] = { _mm_setr_ps(c.z, s.z, 0.0f, 0.0f), _mm_setr_ps(-s.z, c.z, 0.0f, 0.0f), _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f), _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f) };
+
+		const glm::vec3& p = arrays.positions[i];
+		float scale = arrays.scales[i];
+
+		glm_vec4 tran[4] = { _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f), _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f), _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f), _mm_setr_ps(p.x, p.y, p.z, 1.0f) };
+		glm_vec4 scal[4] = { _mm_setr_ps(scale, 0.0f, 0.0f, 0.0f), _mm_setr_ps(0.0f, scale, 0.0f, 0.0f), _mm_setr_ps(0.0f, 0.0f, scale, 0.0f), _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f) };
+
+		glm_vec4 rzy[4], rotation[4], translated[4], local[4];
+		glm_mat4_mul(rz, ry, rzy);
+		glm_mat4_mul(rzy, rx, rotation);
+		glm_mat4_mul(tran, rotation, translated);
+		glm_mat4_mul(translated, scal, local);
+
+		glm_vec4* out = world[i].c;
+
+		if (arrays.parents[i] < 0)
+		{
+			for (unsigned int j = 0; j < 4; j++)
+				out[j] = local[j];
+		}
+		else
+			glm_mat4_mul(world[arrays.parents[i]].c, local, out);
+	}
+}
+
+void multiplyGLMSIMD(const std::vector<int>& parents, const AlignedArray<SimdMat4>& local, AlignedArray<SimdMat4>& world)
+{
+	for (size_t i = 0; i < parents.size(); i++)
+	{
+		if (parents[i] < 0)
+			world[i] = local[i];
+		else
+			glm_mat4_mul(world[parents[i]].c, local[i].c, world[i].c);
+	}
+}
+#endif
+
+// Description:
+// Every test on one hierarchy, results are added to results.
+void runHierarchy(const HierarchyShape& shape, unsigned int numObjects, unsigned int repeats, std::vector<TestResult>& results)
+{
+	TransformArrays arrays = makeHierarchy(shape, numObjects);
+
+	// Reserved up front so the children's parent pointers stay put
+	std::vector<GameObject> objects;
+	objects.reserve(numObjects);
+
+	std::vector<GameObject*> roots;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+	{
+		objects.push_back(GameObject(arrays.positions[i], nullptr, nullptr));
+		objects[i].setRotationAngleX(arrays.angles[i].x);
+		objects[i].setRotationAngleY(arrays.angles[i].y);
+		objects[i].setRotationAngleZ(arrays.angles[i].z);
+		objects[i].setScale(arrays.scales[i]);
+
+		if (arrays.parents[i] < 0)
+			roots.push_back(&objects[i]);
+		else
+			objects[arrays.parents[i]].addChild(&objects[i]);
+	}
+
+	size_t firstResult = results.size();
+
+	// GameObject
+	results.push_back(timeTest([&]()
+	{
+		for (size_t i = 0; i < roots.size(); i++)
+			roots[i]->update(1.0f / 60.0f);
+	}, repeats, numObjects));
+	results.back().test = "GameObject::update";
+
+	results.push_back(timeTest([&]()
+	{
+		glm::vec3 total(0.0f);
+
+		for (size_t i = 0; i < objects.size(); i++)
+			total += objects[i].getWorldPosition();
+
+		sink = total.x + total.y + total.z;
+	}, repeats, numObjects));
+	results.back().test = "GameObject::getWorldPosition";
+
+	results.push_back(timeTest([&]()
+	{
+		glm::mat4 total(0.0f);
+
+		for (size_t i = 0; i < objects.size(); i++)
+			total += objects[i].getWorldRotation();
+
+		sink = total[0][0] + total[1][1] + total[2][2];
+	}, repeats, numObjects));
+	results.back().test = "GameObject::getWorldRotation";
+
+	// Arrays, checked against what GameObject::update worked out
+	std::vector<glm::mat4> scalarLocal(numObjects), scalarWorld(numObjects);
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		scalarLocal[i] = makeLocalScalar(arrays, i);
+
+	results.push_back(timeTest([&]() { composeScalar(arrays, scalarWorld); }, repeats, numObjects));
+	results.back().test = "compose_scalar";
+	results.back().maxError = 0.0;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		results.back().maxError = std::max(results.back().maxError, (double)maxDifference(objects[i].getLocalToWorldMatrix(), glm::value_ptr(scalarWorld[i])));
+
+	results.push_back(timeTest([&]() { multiplyScalar(arrays.parents, scalarLocal, scalarWorld); }, repeats, numObjects));
+	results.back().test = "multiply_scalar";
+	results.back().maxError = 0.0;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		results.back().maxError = std::max(results.back().maxError, (double)maxDifference(objects[i].getLocalToWorldMatrix(), glm::value_ptr(scalarWorld[i])));
+
+#ifdef TTK_TRANSFORM_SIMD
+	AlignedArray<AlignedMat4> alignedLocal(numObjects), alignedWorld(numObjects);
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		alignedLocal[i] = AlignedMat4(scalarLocal[i]);
+
+	results.push_back(timeTest([&]() { composeAligned(arrays, alignedWorld); }, repeats, numObjects));
+	results.back().test = "compose_aligned";
+	results.back().maxError = 0.0;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		results.back().maxError = std::max(results.back().maxError, (double)maxDifference(objects[i].getLocalToWorldMatrix(), &alignedWorld[i][0][0]));
+
+	results.push_back(timeTest([&]() { multiplyAligned(arrays.parents, alignedLocal, alignedWorld); }, repeats, numObjects));
+	results.back().test = "multiply_aligned";
+	results.back().maxError = 0.0;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		results.back().maxError = std::max(results.back().maxError, (double)maxDifference(objects[i].getLocalToWorldMatrix(), &alignedWorld[i][0][0]));
+
+	AlignedArray<SimdMat4> simdLocal(numObjects), simdWorld(numObjects);
+
+	for (unsigned int i = 0; i < numObjects; i++)
+	{
+		for (unsigned int j = 0; j < 4; j++)
+			simdLocal[i].c[j] = _mm_loadu_ps(&scalarLocal[i][j][0]);
+	}
+
+	results.push_back(timeTest([&]() { composeGLMSIMD(arrays, simdWorld); }, repeats, numObjects));
+	results.back().test = "compose_glm_simd";
+	results.back().maxError = 0.0;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		results.back().maxError = std::max(results.back().maxError, (double)maxDifference(objects[i].getLocalToWorldMatrix(), (const float*)simdWorld[i].c));
+
+	results.push_back(timeTest([&]() { multiplyGLMSIMD(arrays.parents, simdLocal, simdWorld); }, repeats, numObjects));
+	results.back().test = "multiply_glm_simd";
+	results.back().maxError = 0.0;
+
+	for (unsigned int i = 0; i < numObjects; i++)
+		results.back().maxError = std::max(results.back().maxError, (double)maxDifference(objects[i].getLocalToWorldMatrix(), (const float*)simdWorld[i].c));
+#endif
+
+	for (size_t i = firstResult; i < results.size(); i++)
+	{
+		results[i].hierarchy = shape.name;
+		results[i].depth = shape.depth;
+		results[i].fanout = shape.fanout;
+	}
+}
+
+bool writeJSON(std::ostream& out, const std::vector<TestResult>& results, unsigned int repeats)
+{
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6);
+
+	out << "{" << std::endl;
+	out << "\t\"glmVersion\": " << GLM_VERSION << "," << std::endl;
+#ifdef TTK_TRANSFORM_SIMD
+	out << "\t\"simd\": true," << std::endl;
+#else
+	out << "\t\"simd\": false," << std::endl;
+#endif
+	out << "\t\"repeats\": " << repeats << "," << std::endl;
+	out << "\t\"results\": [" << std::endl;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const TestResult& result = results[i];
+
+		out << "\t\t{ \"hierarchy\": \"" << result.hierarchy << "\", \"objects\": " << result.numObjects
+			<< ", \"depth\": " << result.depth << ", \"fanout\": " << result.fanout << ", \"test\": \"" << result.test << "\""
+			<< ", \"minMs\": " << result.minMs << ", \"medianMs\": " << result.medianMs << ", \"maxMs\": " << result.maxMs
+			<< ", \"nsPerObject\": " << result.nsPerObject;
+
+		if (result.maxError >= 0.0)
+			out << ", \"maxError\": " << result.maxError;
+
+		out << " }" << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+
+	out << "\t]" << std::endl;
+	out << "}" << std::endl;
+
+	return out.good();
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<unsigned int> counts;
+	unsigned int repeats = 5;
+	std::string outputFile = "transform_benchmark.json";
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if (i + 1 >= argc)
+		{
+			std::cout << "Usage: TransformBenchmark [--counts 10000,100000,1000000] [--repeats N] [--output file.json]" << std::endl;
+			return 1;
+		}
+
+		std::string value = argv[++i];
+
+		if (arg == "--counts")
+		{
+			for (size_t start = 0; start < value.length(); start = value.find(',', start) + 1)
+			{
+				counts.push_back(std::max(1, atoi(value.c_str() + start)));
+
+				if (value.find(',', start) == std::string::npos)
+					break;
+			}
+		}
+		else if (arg == "--repeats")
+			repeats = std::max(1, atoi(value.c_str()));
+		else if (arg == "--output")
+			outputFile = value;
+		else
+		{
+			std::cout << "TransformBenchmark Error: Unknown argument: " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	if (counts.size() == 0)
+	{
+		counts.push_back(10000);
+		counts.push_back(100000);
+		counts.push_back(1000000);
+	}
+
+	std::vector<TestResult> results;
+
+	std::cout << std::left << std::setw(8) << "shape" << std::right << std::setw(9) << "objects" << "  "
+		<< std::left << std::setw(30) << "test" << std::right << std::setw(11) << "median ms" << std::setw(12) << "ns/object" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (unsigned int i = 0; i < counts.size(); i++)
+	{
+		for (unsigned int j = 0; j < sizeof(HIERARCHY_SHAPES) / sizeof(HIERARCHY_SHAPES[0]); j++)
+		{
+			size_t firstResult = results.size();
+			runHierarchy(HIERARCHY_SHAPES[j], counts[i], repeats, results);
+
+			for (size_t k = firstResult; k < results.size(); k++)
+			{
+				std::cout << std::left << std::setw(8) << results[k].hierarchy << std::right << std::setw(9) << results[k].numObjects << "  "
+					<< std::left << std::setw(30) << results[k].test << std::right << std::setw(11) << results[k].medianMs
+					<< std::setw(12) << results[k].nsPerObject << std::endl;
+			}
+		}
+	}
+
+	if (outputFile == "-")
+		return writeJSON(std::cout, results, repeats) ? 0 : 1;
+
+	std::ofstream file(outputFile);
+
+	if (!file.is_open())
+	{
+		std::cout << "TransformBenchmark Error: Cannot write file: " << outputFile << std::endl;
+		return 1;
+	}
+
+	return writeJSON(file, results, repeats) ? 0 : 1;
+}
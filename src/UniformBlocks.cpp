@@ -0,0 +1,89 @@
+#include "UniformBlocks.h"
+#include <cstring>
+
+int getUniformBlockBinding(const std::string& blockName)
+{
+	if (blockName == "FrameData")
+		return FRAME_DATA_BINDING;
+	if (blockName == "ObjectData")
+		return OBJECT_DATA_BINDING;
+
+	return -1;
+}
+
+UniformBlocks& UniformBlocks::shared()
+{
+	static UniformBlocks blocks;
+	return blocks;
+}
+
+void UniformBlocks::setFrame(TTK::Camera& camera, const glm::vec4& lightPosEye)
+{
+	frame.view = camera.viewMatrix;
+	frame.proj = camera.projMatrix;
+	frame.viewProj = camera.viewProjMatrix;
+	frame.lightPos = lightPosEye;
+
+	frameBuffer.setData(&frame, sizeof(FrameData));
+	frameBuffer.bindBase(FRAME_DATA_BINDING);
+}
+
+ObjectData UniformBlocks::makeObject(const glm::mat4& model, const glm::vec4& colour, const TTK::MeshBase& mesh)
+{
+	ObjectData object;
+	object.mvp = frame.viewProj * model;
+	object.mv = frame.view * model;
+	object.colour = colour;
+
+	// The packing of a mesh still loading may change under us, it draws nothing anyway
+	if (mesh.isUploaded())
+	{
+		object.positionScale = glm::vec4(mesh.positionScale, 1.0f);
+		object.positionOffset = glm::vec4(mesh.positionOffset, 0.0f);
+		object.octNormals = mesh.vertexFormat.normals == TTK::NORMAL_OCT16 ? 1 : 0;
+	}
+	else
+	{
+		object.positionScale = glm::vec4(1.0f);
+		object.positionOffset = glm::vec4(0.0f);
+		object.octNormals = 0;
+	}
+
+	object.padding[0] = object.padding[1] = object.padding[2] = 0;
+
+	return object;
+}
+
+void UniformBlocks::setObject(const glm::mat4& model, const glm::vec4& colour, const TTK::MeshBase& mesh)
+{
+	ObjectData object = makeObject(model, colour, mesh);
+
+	size_t offset = objectRing.write(&object, sizeof(ObjectData));
+	objectRing.bindRange(OBJECT_DATA_BINDING, offset, sizeof(ObjectData));
+}
+
+size_t UniformBlocks::writeObjects(const ObjectData* objects, unsigned int count)
+{
+	if (count == 0)
+		return 0;
+
+	size_t stride = objectRing.align(sizeof(ObjectData));
+	objectStaging.resize(stride * count);
+
+	for (unsigned int i = 0; i < count; i++)
+		memcpy(&objectStaging[i * stride], &objects[i], sizeof(ObjectData));
+
+	return objectRing.write(&objectStaging[0], objectStaging.size());
+}
+
+void UniformBlocks::bindObject(size_t first, unsigned int index)
+{
+	objectRing.bindRange(OBJECT_DATA_BINDING, first + index * objectRing.align(sizeof(ObjectData)), sizeof(ObjectData));
+}
+
+void UniformBlocks::destroy()
+{
+	frameBuffer.destroy();
+	objectRing.destroy();
+	objectStaging.clear();
+}
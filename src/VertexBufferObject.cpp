@@ -1,9 +1,23 @@
 #include "VertexBufferObject.h"
+#include "TTK/GLState.h"
 #include <iostream>
+#include <cstring>
+#include <utility>
 
 VertexBufferObject::VertexBufferObject()
 {
 	vaoHandle = 0;
+	iboHandle = 0;
+	indexData = nullptr;
+	numIndices = 0;
+	indexDataType = GL_UNSIGNED_INT;
+	indexType = GL_UNSIGNED_INT;
+	numVertices = 0;
+	uploading = false;
+	interleaved = false;
+	vertexData = nullptr;
+	vertexStride = 0;
+	numInterleavedVertices = 0;
 }
 
 VertexBufferObject::~VertexBufferObject()
@@ -17,60 +31,408 @@ int VertexBufferObject::addAttributeArray(AttributeDescriptor attrib)
 	return 1;
 }
 
-void VertexBufferObject::createVBO()
+void VertexBufferObject::setIndexArray(unsigned int* indices, unsigned int count)
+{
+	indexData = indices;
+	numIndices = count;
+	indexDataType = GL_UNSIGNED_INT;
+}
+
+void VertexBufferObject::setIndexArray(unsigned short* indices, unsigned int count)
+{
+	indexData = indices;
+	numIndices = count;
+	indexDataType = GL_UNSIGNED_SHORT;
+}
+
+GLenum VertexBufferObject::getIndexType()
+{
+	// Half the memory and bandwidth if every index fits in 16 bits
+	if (indexDataType == GL_UNSIGNED_INT && getNumVertices() <= 65536)
+		return GL_UNSIGNED_SHORT;
+
+	return indexDataType;
+}
+
+void VertexBufferObject::setVertexArray(const void* vertices, unsigned int count, unsigned int stride,
+	const VertexElement* elements, unsigned int numElements)
+{
+	vertexElements.assign(elements, elements + numElements);
+	vertexData = vertices;
+	vertexStride = stride;
+	numInterleavedVertices = count;
+}
+
+void VertexBufferObject::interleaveAttributes()
+{
+	if (!interleaved || attributeDescriptors.size() == 0)
+		return;
+
+	unsigned int count = attributeDescriptors[0].numElements / attributeDescriptors[0].numElementsPerAttrib;
+	std::vector<VertexElement> elements(attributeDescriptors.size());
+	unsigned int stride = 0;
+
+	for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+	{
+		AttributeDescriptor* attrib = &attributeDescriptors[i];
+
+		elements[i].attributeLocation = attrib->attributeLocation;
+		elements[i].elementType = attrib->elementType;
+		elements[i].numComponents = attrib->numElementsPerAttrib;
+		elements[i].normalized = attrib->normalized;
+		elements[i].offset = stride;
+
+		// GL wants every attribute 4 byte aligned
+		stride += (attrib->elementSize * attrib->numElementsPerAttrib + 3) & ~3u;
+	}
+
+	interleavedData.assign((size_t)count * stride, 0);
+
+	for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+	{
+		AttributeDescriptor* attrib = &attributeDescriptors[i];
+		size_t size = attrib->elementSize * attrib->numElementsPerAttrib;
+		const unsigned char* in = (const unsigned char*)attrib->data;
+		unsigned char* out = &interleavedData[elements[i].offset];
+
+		if (!in)
+			continue;
+
+		for (unsigned int v = 0; v < count; v++, in += size, out += stride)
+			memcpy(out, in, size);
+	}
+
+	setVertexArray(interleavedData.data(), count, stride, &elements[0], elements.size());
+}
+
+unsigned int VertexBufferObject::getNumVertices()
+{
+	if (vertexElements.size() > 0)
+		return numInterleavedVertices;
+
+	if (attributeDescriptors.size() == 0)
+		return 0;
+
+	return attributeDescriptors[0].numElements / attributeDescriptors[0].numElementsPerAttrib;
+}
+
+void VertexBufferObject::createVBO(bool uploadData)
 {
 	if (vaoHandle)
 	{
 		destroy();
 	}
 
+	if (interleaved && vertexElements.size() == 0)
+		interleaveAttributes();
+
 	glGenVertexArrays(1, &vaoHandle);
-	glBindVertexArray(vaoHandle);
+	TTK::GLState::shared().bindVertexArray(vaoHandle);
 
-	unsigned int numBuffers = attributeDescriptors.size();
-	vboHandles.resize(numBuffers);
+	if (vertexElements.size() > 0)
+	{
+		// One buffer, each attribute is at its offset into every vertex
+		vboHandles.resize(1);
+		glGenBuffers(1, &vboHandles[0]);
 
-	glGenBuffers(numBuffers, &vboHandles[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, vboHandles[0]);
+		glBufferData(GL_ARRAY_BUFFER, (size_t)numInterleavedVertices * vertexStride,
+			uploadData ? vertexData : nullptr, GL_STATIC_DRAW);
 
-	for (int i = 0; i < numBuffers; i++)
-	{
-		AttributeDescriptor* attrib = &attributeDescriptors[i];
-		
-		glEnableVertexAttribArray(attrib->attributeLocation);
-		glBindBuffer(GL_ARRAY_BUFFER, vboHandles[i]);
-		glBufferData(GL_ARRAY_BUFFER, attrib->numElements * attrib->elementSize,
-			attrib->data, GL_STATIC_DRAW);
+		for (unsigned int i = 0; i < vertexElements.size(); i++)
+		{
+			VertexElement* element = &vertexElements[i];
 
-		glVertexAttribPointer(attrib->attributeLocation, attrib->numElementsPerAttrib,
-			attrib->elementType, GL_FALSE, 0, 0);
+			glEnableVertexAttribArray(element->attributeLocation);
+			glVertexAttribPointer(element->attributeLocation, element->numComponents, element->elementType,
+				element->normalized ? GL_TRUE : GL_FALSE, vertexStride, (const void*)(size_t)element->offset);
+		}
 
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
+	else
+	{
+		unsigned int numBuffers = attributeDescriptors.size();
+		vboHandles.resize(numBuffers);
+
+		if (numBuffers > 0)
+			glGenBuffers(numBuffers, &vboHandles[0]);
+
+		for (int i = 0; i < numBuffers; i++)
+		{
+			AttributeDescriptor* attrib = &attributeDescriptors[i];
+
+			glEnableVertexAttribArray(attrib->attributeLocation);
+			glBindBuffer(GL_ARRAY_BUFFER, vboHandles[i]);
+			glBufferData(GL_ARRAY_BUFFER, attrib->numElements * attrib->elementSize,
+				uploadData ? attrib->data : nullptr, GL_STATIC_DRAW);
+
+			glVertexAttribPointer(attrib->attributeLocation, attrib->numElementsPerAttrib,
+				attrib->elementType, attrib->normalized ? GL_TRUE : GL_FALSE, 0, 0);
+
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+	}
+
+	numVertices = getNumVertices();
+	indexType = getIndexType();
+
+	if (numIndices > 0)
+	{
+		// The element array binding is stored in the VAO, so it must be bound while the VAO is
+		glGenBuffers(1, &iboHandle);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboHandle);
+
+		unsigned int indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * indexSize, nullptr, GL_STATIC_DRAW);
+	}
+
+	TTK::GLState::shared().bindVertexArray(0);
+
+	// Don't unbind the element array while the VAO is bound, that would remove it from the VAO
+	if (iboHandle)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	glBindVertexArray(0);
+	uploading = !uploadData;
+
+	if (uploadData && numIndices > 0)
+		uploadIndexRange(0, numIndices);
+
+	if (uploadData)
+		freeInterleavedData();
+}
+
+size_t VertexBufferObject::getBufferSize(unsigned int buffer)
+{
+	if (buffer >= vboHandles.size())
+		return 0;
+
+	if (vertexElements.size() > 0)
+		return (size_t)numInterleavedVertices * vertexStride;
+
+	return (size_t)attributeDescriptors[buffer].numElements * attributeDescriptors[buffer].elementSize;
+}
+
+void VertexBufferObject::uploadBufferRange(unsigned int buffer, size_t offset, size_t size)
+{
+	if (buffer >= vboHandles.size() || size == 0)
+		return;
+
+	const void* data = vertexElements.size() > 0 ? vertexData : attributeDescriptors[buffer].data;
+
+	if (!data)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vboHandles[buffer]);
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, (const char*)data + offset);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBufferObject::uploadIndexRange(unsigned int first, unsigned int count)
+{
+	if (!iboHandle || !indexData || count == 0)
+		return;
+
+	// Binding to the copy target leaves the element array binding of whatever VAO is bound alone
+	glBindBuffer(GL_COPY_WRITE_BUFFER, iboHandle);
+
+	if (indexType == indexDataType)
+	{
+		unsigned int indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, first * indexSize, count * indexSize,
+			(const char*)indexData + first * indexSize);
+	}
+	else
+	{
+		// 32-bit indices going into a 16-bit buffer
+		unsigned int* wideIndices = (unsigned int*)indexData + first;
+		std::vector<unsigned short> shortIndices(wideIndices, wideIndices + count);
+
+		glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(unsigned short), count * sizeof(unsigned short),
+			&shortIndices[0]);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void VertexBufferObject::finishUpload()
+{
+	uploading = false;
+	freeInterleavedData();
+}
+
+void VertexBufferObject::releaseSourceData()
+{
+	for (unsigned int i = 0; i < attributeDescriptors.size(); i++)
+		attributeDescriptors[i].data = nullptr;
+
+	indexData = nullptr;
+	vertexData = nullptr;
+}
+
+void VertexBufferObject::setAttributeData(unsigned int index, void* data)
+{
+	if (index < attributeDescriptors.size())
+		attributeDescriptors[index].data = data;
+}
+
+void VertexBufferObject::freeInterleavedData()
+{
+	// vertexData points into the copy when interleaveAttributes made it
+	if (vertexData == interleavedData.data())
+		vertexData = nullptr;
+
+	std::vector<unsigned char>().swap(interleavedData);
 }
 
 void VertexBufferObject::draw()
 {
-	if (vaoHandle)
+	if (vaoHandle && !uploading)
+	{
+		TTK::GLState::shared().bindVertexArray(vaoHandle);
+
+		if (iboHandle)
+			glDrawElements(GL_TRIANGLES, numIndices, indexType, 0);
+		else
+			glDrawArrays(GL_TRIANGLES, 0, numVertices);
+	}
+}
+
+void VertexBufferObject::drawRange(unsigned int first, unsigned int count)
+{
+	if (vaoHandle && iboHandle && !uploading && first + count <= numIndices)
+	{
+		unsigned int indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+		TTK::GLState::shared().bindVertexArray(vaoHandle);
+		glDrawElements(GL_TRIANGLES, count, indexType, (const void*)((size_t)first * indexSize));
+	}
+}
+
+void VertexBufferObject::setInstanceArray(unsigned int buffer, size_t offset, unsigned int stride,
+	const VertexElement* elements, unsigned int numElements)
+{
+	if (!vaoHandle)
+		return;
+
+	TTK::GLState::shared().bindVertexArray(vaoHandle);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	for (unsigned int i = 0; i < numElements; i++)
+	{
+		const VertexElement* element = &elements[i];
+
+		glEnableVertexAttribArray(element->attributeLocation);
+		glVertexAttribPointer(element->attributeLocation, element->numComponents, element->elementType,
+			element->normalized ? GL_TRUE : GL_FALSE, stride, (const void*)(offset + element->offset));
+
+		// Advance once per instance instead of once per vertex
+		glVertexAttribDivisor(element->attributeLocation, 1);
+	}
+
+	TTK::GLState::shared().bindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBufferObject::drawInstanced(unsigned int instanceCount)
+{
+	if (vaoHandle && !uploading && instanceCount > 0)
 	{
-		glBindVertexArray(vaoHandle);
-		// better way would be to just store the num of vertices
-		glDrawArrays(GL_TRIANGLES, 0, 
-			attributeDescriptors[0].numElements / attributeDescriptors[0].numElementsPerAttrib);
+		TTK::GLState::shared().bindVertexArray(vaoHandle);
+
+		if (iboHandle)
+			glDrawElementsInstanced(GL_TRIANGLES, numIndices, indexType, 0, instanceCount);
+		else
+			glDrawArraysInstanced(GL_TRIANGLES, 0, numVertices, instanceCount);
 	}
 }
 
+void VertexBufferObject::drawRangeInstanced(unsigned int first, unsigned int count, unsigned int instanceCount)
+{
+	if (vaoHandle && iboHandle && !uploading && first + count <= numIndices && instanceCount > 0)
+	{
+		unsigned int indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+		TTK::GLState::shared().bindVertexArray(vaoHandle);
+		glDrawElementsInstanced(GL_TRIANGLES, count, indexType, (const void*)((size_t)first * indexSize), instanceCount);
+	}
+}
+
+void* VertexBufferObject::mapAttributeArray(unsigned int index)
+{
+	// Attributes don't have a buffer of their own when interleaved
+	if (index >= vboHandles.size() || vertexElements.size() > 0)
+		return nullptr;
+
+	AttributeDescriptor* attrib = &attributeDescriptors[index];
+
+	glBindBuffer(GL_ARRAY_BUFFER, vboHandles[index]);
+	void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, attrib->numElements * attrib->elementSize,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return ptr;
+}
+
+bool VertexBufferObject::unmapAttributeArray(unsigned int index)
+{
+	if (index >= vboHandles.size())
+		return false;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vboHandles[index]);
+	GLboolean intact = glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return intact == GL_TRUE;
+}
+
+void VertexBufferObject::swap(VertexBufferObject& other)
+{
+	attributeDescriptors.swap(other.attributeDescriptors);
+	std::swap(vaoHandle, other.vaoHandle);
+	vboHandles.swap(other.vboHandles);
+	std::swap(iboHandle, other.iboHandle);
+	std::swap(indexData, other.indexData);
+	std::swap(numIndices, other.numIndices);
+	std::swap(indexDataType, other.indexDataType);
+	std::swap(indexType, other.indexType);
+	std::swap(uploading, other.uploading);
+	std::swap(numVertices, other.numVertices);
+	std::swap(interleaved, other.interleaved);
+	vertexElements.swap(other.vertexElements);
+	std::swap(vertexData, other.vertexData);
+	std::swap(vertexStride, other.vertexStride);
+	std::swap(numInterleavedVertices, other.numInterleavedVertices);
+	interleavedData.swap(other.interleavedData);
+}
+
 void VertexBufferObject::destroy()
 {
 	if (vaoHandle)
 	{
+		TTK::GLState::shared().forgetVertexArray(vaoHandle);
 		glDeleteVertexArrays(1, &vaoHandle);
-		glDeleteBuffers(vboHandles.size(), &vboHandles[0]);
+		glDeleteBuffers(vboHandles.size(), vboHandles.data());
+		vaoHandle = 0;
+	}
+
+	if (iboHandle)
+	{
+		glDeleteBuffers(1, &iboHandle);
+		iboHandle = 0;
 	}
 
 	vboHandles.clear();
 	attributeDescriptors.clear();
-}
 
+	vertexElements.clear();
+	std::vector<unsigned char>().swap(interleavedData);
+	vertexData = nullptr;
+	vertexStride = 0;
+	numInterleavedVertices = 0;
 
+	indexData = nullptr;
+	numIndices = 0;
+	numVertices = 0;
+	uploading = false;
+}
@@ -4,24 +4,36 @@
 #include <math.h>
 #include <map> // for std::map
 #include <memory> // for std::shared_ptr
+#include <cstdlib> // for atexit()
 
 // 3rd Party Libraries
 #include <GLEW\glew.h>
 #include <GLUT\glut.h>
 #include <TTK\OBJMesh.h>
 #include <TTK\Camera.h>
+#include <TTK\SpriteBatch.h>
+#include <TTK\GLState.h>
+#include <TTK\GPUProfiler.h>
+#include <TTK\GeometryArena.h>
+#include <TTK\Profiler.h>
 #include <IL/il.h> // for ilInit()
 #include <glm\vec3.hpp>
 
 // User Libraries
 #include "Shader.h"
 #include "ShaderProgram.h"
+#include "ShaderBatch.h"
+#include "ShaderPermutations.h"
 #include "GameObject.h"
 #include "FrameBufferObject.h"
+#include "VertexLayout.h"
+#include "Scene.h"
+#include "UniformBlocks.h"
 
 // Defines and Core variables
 #define FRAMES_PER_SECOND 60
 const int FRAME_DELAY = 1000 / FRAMES_PER_SECOND; // Milliseconds per frame
+const size_t MESH_UPLOAD_BYTES_PER_FRAME = 4 * 1024 * 1024; // Mesh data sent to the GPU per frame, 0 = no limit
 
 int windowWidth = 800;
 int windowHeight = 600;
@@ -37,20 +49,33 @@ float deltaTime = 0.0f; // amount of time since last update (set every frame in
 
 glm::vec3 position;
 float movementSpeed = 5.0f;
-glm::vec4 lightPos;
 
 // Cameras
 TTK::Camera playerCamera; // the camera you move around with wasd + mouse
 TTK::Camera renderCamera; // fixed used to render the scene to an fbo
 
-// Asset databases
-std::map<std::string, std::shared_ptr<TTK::MeshBase>> meshes;
-std::map<std::string, std::shared_ptr<GameObject>> gameobjects;
+// Meshes, game objects and the light, loaded from Assets/Scenes/default.scene
+// Objects are drawn with scene.drawMode, press i to switch
+Scene scene;
 
 // Materials
 std::shared_ptr<Material> defaultMaterial;
 std::shared_ptr<Material> invertPostProcessMaterial;
 std::shared_ptr<Material> unlitTextureMaterial;
+std::shared_ptr<Material> spriteMaterial;
+
+// default_v.glsl with default_f.glsl, and with invertFilter_f.glsl, for each feature set used
+ShaderPermutations defaultShaders;
+ShaderPermutations invertFilterShaders;
+
+// Uniforms the materials above are given
+const ParameterId U_MVP = Material::getParameterId("u_mvp");
+const ParameterId U_TEX = Material::getParameterId("u_tex");
+
+// Sprites
+TTK::SpriteBatch spriteBatch;
+std::shared_ptr<TTK::Texture2D> spriteTextures[2];
+const int NUM_DEMO_SPRITES = 20000;
 
 FrameBufferObject fbo;
 
@@ -59,155 +84,169 @@ enum GameMode
 	DRAW_SCENE,
 	FBO_DEMO,
 	POST_PROCESS_DEMO,
+	SPRITE_DEMO,
 };
 
 GameMode currentMode = DRAW_SCENE;
 
 void initializeShaders()
 {
+	TTK_PROFILE_ZONE("initializeShaders");
+
 	std::string shaderPath = "../../Assets/Shaders/";
 
 	// Load shaders
 
-	Shader v_default, v_passThrough;
-	v_default.loadShaderFromFile(shaderPath + "default_v.glsl", GL_VERTEX_SHADER);
-	v_passThrough.loadShaderFromFile(shaderPath + "passThrough_v.glsl", GL_VERTEX_SHADER);
+	// Shaders with feature #ifdefs, each material takes the variant it needs (see ShaderPermutations.h)
+	defaultShaders.loadShadersFromFile(shaderPath + "default_v.glsl", shaderPath + "default_f.glsl");
+	invertFilterShaders.loadShadersFromFile(shaderPath + "default_v.glsl", shaderPath + "invertFilter_f.glsl");
+
+	Shader v_defaultIndirect, f_defaultLit;
+
+	// Needs GL 4.3, only load it if it can be used
+	if (MultiDrawRenderer::isSupported())
+	{
+		v_defaultIndirect.loadShaderFromFile(shaderPath + "default_indirect_v.glsl", GL_VERTEX_SHADER);
+		f_defaultLit.loadShaderFromFile(shaderPath + "default_f.glsl", GL_FRAGMENT_SHADER, FEATURE_LIT);
+	}
+
+	Shader v_sprite;
+	v_sprite.loadShaderFromFile(shaderPath + "sprite_v.glsl", GL_VERTEX_SHADER);
+
+	Shader f_sprite;
+	f_sprite.loadShaderFromFile(shaderPath + "sprite_f.glsl", GL_FRAGMENT_SHADER);
 
-	Shader f_default, f_invertFilter, f_unlitTexture;
-	f_default.loadShaderFromFile(shaderPath + "default_f.glsl", GL_FRAGMENT_SHADER);
-	f_invertFilter.loadShaderFromFile(shaderPath + "invertFilter_f.glsl", GL_FRAGMENT_SHADER);
-	f_unlitTexture.loadShaderFromFile(shaderPath + "unlitTexture_f.glsl", GL_FRAGMENT_SHADER);
+	// Every program is compiled and linked together, see ShaderBatch.h
+	ShaderBatch batch;
 
 	// Default material that all objects use
 	defaultMaterial = std::make_shared<Material>();
-	defaultMaterial->shader->attachShader(v_default);
-	defaultMaterial->shader->attachShader(f_default);
-	defaultMaterial->shader->linkProgram();
+	defaultMaterial->shader = defaultShaders.get(FEATURE_LIT, batch);
+
+	// Same thing, but takes each object's transform and colour as instance attributes
+	defaultMaterial->instancedShader = defaultShaders.get(FEATURE_LIT | FEATURE_INSTANCED, batch);
+
+	// And again, reading them from a storage buffer for meshes in the geometry arena
+	if (MultiDrawRenderer::isSupported())
+	{
+		defaultMaterial->indirectShader = std::make_shared<ShaderProgram>();
+		defaultMaterial->indirectShader->attachShader(v_defaultIndirect);
+		defaultMaterial->indirectShader->attachShader(f_defaultLit);
+		batch.add(defaultMaterial->indirectShader);
+	}
 
 	// Unlit texture
 	unlitTextureMaterial = std::make_shared<Material>();
-	unlitTextureMaterial->shader->attachShader(v_passThrough);
-	unlitTextureMaterial->shader->attachShader(f_unlitTexture);
-	unlitTextureMaterial->shader->linkProgram();
+	unlitTextureMaterial->shader = defaultShaders.get(FEATURE_TEXTURED, batch);
 
 	// Simple invert post process filter
 	invertPostProcessMaterial = std::make_shared<Material>();
-	invertPostProcessMaterial->shader->attachShader(v_passThrough);
-	invertPostProcessMaterial->shader->attachShader(f_invertFilter);
-	invertPostProcessMaterial->shader->linkProgram();
+	invertPostProcessMaterial->shader = invertFilterShaders.get(FEATURE_TEXTURED, batch);
+
+	// Sprites drawn with spriteBatch
+	spriteMaterial = std::make_shared<Material>();
+	spriteMaterial->shader->attachShader(v_sprite);
+	spriteMaterial->shader->attachShader(f_sprite);
+	batch.add(spriteMaterial->shader);
+
+	batch.submit();
+	batch.finish();
 }
 
 void initializeScene()
 {
 	std::string meshPath = "../../Assets/Models/";
-	
-	std::shared_ptr<TTK::OBJMesh> floorMesh = std::make_shared<TTK::OBJMesh>();
-	std::shared_ptr<TTK::OBJMesh> sphereMesh = std::make_shared<TTK::OBJMesh>();
-	std::shared_ptr<TTK::OBJMesh> torusMesh = std::make_shared<TTK::OBJMesh>();
-
-	floorMesh->loadMesh(meshPath + "floor.obj");
-	sphereMesh->loadMesh(meshPath + "sphere.obj");
-	torusMesh->loadMesh(meshPath + "cone.obj");
-
-	// Note: looking up a mesh by it's string name is not the fastest thing,
-	// you don't want to do this every frame, once in a while (like now) is fine.
-	// If you need you need constant access to a mesh (i.e. you need it every frame),
-	// store a reference to it so you don't need to look it up every time.
-	meshes["floor"] = floorMesh;
-	meshes["sphere"] = sphereMesh;
-	meshes["torus"] = torusMesh;
-
-	// Create objects
-	gameobjects["floor"] = std::make_shared<GameObject>(glm::vec3(0.0f, 0.0f, 0.0f), floorMesh, defaultMaterial);
-	gameobjects["sphere"] = std::make_shared<GameObject>(glm::vec3(0.0f, 5.0f, 0.0f), sphereMesh, defaultMaterial);
-	gameobjects["torus"] = std::make_shared<GameObject>(glm::vec3(5.0f, 5.0f, 0.0f), torusMesh, defaultMaterial);
-
-	// Set object properties
-	gameobjects["sphere"]->colour = glm::vec4(1.0f);
-	gameobjects["floor"]->colour = glm::vec4(0.2f, 0.1f, 0.2f, 1.0f);
-	gameobjects["torus"]->colour = glm::vec4(0.1f, 0.2f, 0.2f, 1.0f);
-
-	// Create a quad (probably want to put this in a class...)
-	std::shared_ptr<TTK::MeshBase> quadMesh = std::make_shared<TTK::MeshBase>();
-	meshes["quad"] = quadMesh;
+	std::string scenePath = "../../Assets/Scenes/";
 
-	// Triangle 1
-	quadMesh->vertices.push_back(glm::vec3(1.0f, 1.0f, 0.0f));
-	quadMesh->textureCoordinates.push_back(glm::vec2(1.0f, 1.0f));
+	// The meshes load in the background and pop into the scene once they are uploaded,
+	// objects using a mesh that is still loading just don't draw
+	TTK::OBJLoadOptions loadOptions;
+	loadOptions.interleaved = true;
+	loadOptions.numLODs = 3; // Far away objects are drawn with a quarter, a sixteenth... of the triangles
 
-	quadMesh->vertices.push_back(glm::vec3(-1.0f, 1.0f, 0.0f));
-	quadMesh->textureCoordinates.push_back(glm::vec2(0.0f, 1.0f));
+	scene.loadFromFile(scenePath + "default.scene", meshPath, defaultMaterial, loadOptions, true);
 
-	quadMesh->vertices.push_back(glm::vec3(-1.0, -1.0, 0.0f));
-	quadMesh->textureCoordinates.push_back(glm::vec2(0.0f, 0.0f));
+	// Create a quad (probably want to put this in a class...)
+	// The vertices go to the GPU as they are, interleaved in one buffer
+	static const VertexPositionUV quadVertices[] =
+	{
+		// Triangle 1
+		{ glm::vec3(1.0f, 1.0f, 0.0f), glm::vec2(1.0f, 1.0f) },
+		{ glm::vec3(-1.0f, 1.0f, 0.0f), glm::vec2(0.0f, 1.0f) },
+		{ glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec2(0.0f, 0.0f) },
 
-	// Triangle 2
-	quadMesh->vertices.push_back(glm::vec3(1.0, 1.0, 0.0f));
-	quadMesh->textureCoordinates.push_back(glm::vec2(1.0f, 1.0f));
+		// Triangle 2
+		{ glm::vec3(1.0f, 1.0f, 0.0f), glm::vec2(1.0f, 1.0f) },
+		{ glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec2(0.0f, 0.0f) },
+		{ glm::vec3(1.0f, -1.0f, 0.0f), glm::vec2(1.0f, 0.0f) }
+	};
 
-	quadMesh->vertices.push_back(glm::vec3(-1.0, -1.0, 0.0f));
-	quadMesh->textureCoordinates.push_back(glm::vec2(0.0f, 0.0f));
+	std::shared_ptr<TTK::MeshBase> quadMesh = std::make_shared<TTK::MeshBase>();
+	scene.meshes["quad"] = quadMesh;
 
-	quadMesh->vertices.push_back(glm::vec3(1.0, -1.0, 0.0f));
-	quadMesh->textureCoordinates.push_back(glm::vec2(1.0f, 0.0f));
+	quadMesh->vbo.setVertexArray(quadVertices, 6);
+	quadMesh->vbo.createVBO();
 
-	quadMesh->createVBO();
+	// Textures for the sprite demo
+	std::string texturePath = "../../Assets/Textures/";
+	spriteTextures[0] = std::make_shared<TTK::Texture2D>(texturePath + "dkong.png");
+	spriteTextures[1] = std::make_shared<TTK::Texture2D>(texturePath + "dkong2.png");
 }
 
-void initializeFrameBufferObjects()
+void drawSprites()
 {
-	fbo.createFrameBuffer(windowWidth, windowHeight, 1, true);
-}
+	static float time = 0.0f;
+	time += deltaTime;
 
-void updateScene()
-{
-	// Move light in simple circular path
-	static float ang = 0.0f;
+	// One pixel per unit, origin in the bottom left corner of the window
+	spriteMaterial->shader->bind();
+	spriteMaterial->setMat4(U_MVP, glm::ortho(0.0f, (float)windowWidth, 0.0f, (float)windowHeight));
+	spriteMaterial->setInt(U_TEX, 0);
+	spriteMaterial->sendUniforms();
 
-	ang += deltaTime;
-	lightPos.x = cos(ang) * 15.0f;
-	lightPos.y = 10.0f;
-	lightPos.z = sin(ang) * 15.0f;
-	lightPos.w = 1.0f;
+	// Queued with the textures mixed up, the batch sorts them back into one draw per texture
+	spriteBatch.begin();
 
-	gameobjects["sphere"]->setPosition(lightPos);
+	int columns = (int)sqrt((float)NUM_DEMO_SPRITES * windowWidth / windowHeight) + 1;
+	glm::vec2 spacing = glm::vec2((float)windowWidth / columns);
 
-	// Update all game objects
-	for (auto itr = gameobjects.begin(); itr != gameobjects.end(); ++itr)
+	for (int i = 0; i < NUM_DEMO_SPRITES; i++)
 	{
-		auto gameobject = itr->second;
-
-		// Remember: root nodes are responsible for updating all of its children
-		// So we need to make sure to only invoke update() for the root nodes.
-		// Otherwise some objects would get updated twice in a frame!
-		if (gameobject->isRoot())
-			gameobject->update(deltaTime);
+		glm::vec2 position = (glm::vec2((float)(i % columns), (float)(i / columns)) + 0.5f) * spacing;
+		spriteBatch.draw(spriteTextures[i % 2].get(), position, spacing * 1.5f, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+			glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), time + i * 0.1f);
 	}
+
+	spriteBatch.end();
 }
 
-void drawScene(TTK::Camera& cam)
+void initializeFrameBufferObjects()
 {
-	// Send light position to shader
-	defaultMaterial->vec4Uniforms["u_lightPos"] = cam.viewMatrix * lightPos;
-
-	for (auto itr = gameobjects.begin(); itr != gameobjects.end(); ++itr)
-	{
-		auto gameobject = itr->second;
-
-		if (gameobject->isRoot())
-			gameobject->draw(cam);
-	}
+	fbo.createFrameBuffer(windowWidth, windowHeight, 1, true);
 }
 
 // This is where we draw stuff
 void DisplayCallbackFunction(void)
 {
+	TTK_PROFILE_END_FRAME(); // Frame zones run from one call to the next, so they include the swap
+
+	TTK_PROFILE_ZONE("DisplayCallbackFunction");
+
+	// GPU time of each pass below, press P for the numbers
+	TTK::GPUProfiler::shared().beginFrame();
+
+	// Upload the next piece of any meshes that finished loading
+	{
+		TTK::GPUZone zone("Mesh uploads");
+		TTK::MeshUploadQueue::shared().update();
+	}
+
 	// Update cameras (there's two now!)
 	playerCamera.update();
 	renderCamera.update();
 
 	// Update all gameobjects
-	updateScene();
+	scene.update(deltaTime);
 
 	switch (currentMode)
 	{
@@ -219,25 +258,33 @@ void DisplayCallbackFunction(void)
 			//glClearColor(0.8f, 0.8f, 0.8f, 0.0f);
 			//glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+			TTK::GPUZone zone("Scene");
+
 			fbo.unbindFrameBuffer(windowWidth, windowHeight);
 			fbo.clearFrameBuffer(glm::vec4(0.8f, 0.8f, 0.8f, 0.8f));
 
 			// Just draw the scene to the back buffer
-			drawScene(playerCamera);
+			scene.draw(playerCamera);
 		}
 		break;
 
 		case FBO_DEMO: // press 2
 		{
-			fbo.bindFrameBufferForDrawing();
-			fbo.clearFrameBuffer(glm::vec4(0.8f, 0.8f, 0.8f, 0.0f));
+			{
+				TTK::GPUZone zone("FBO scene");
+
+				fbo.bindFrameBufferForDrawing();
+				fbo.clearFrameBuffer(glm::vec4(0.8f, 0.8f, 0.8f, 0.0f));
 
-			drawScene(renderCamera);
+				scene.draw(renderCamera);
+			}
+
+			TTK::GPUZone zone("Fullscreen quad");
 
 			// draw the quad
 			unlitTextureMaterial->shader->bind();
 			fbo.bindTextureForSampling(0, GL_TEXTURE0);
-			unlitTextureMaterial->intUniforms["u_tex"] = 0;
+			unlitTextureMaterial->setInt(U_TEX, 0);
 			// create model matrix
 			glm::mat4 quadModelMatrix =
 				glm::translate(glm::vec3(0.0f)) *
@@ -246,18 +293,19 @@ void DisplayCallbackFunction(void)
 				glm::rotate(0.0f, glm::vec3(1.0f, 0.0f, 0.0f)) *
 				glm::scale(glm::vec3(4.0f));
 			
-			unlitTextureMaterial->mat4Uniforms["u_mvp"] =
-				playerCamera.viewProjMatrix * quadModelMatrix;
-
 			unlitTextureMaterial->sendUniforms();
 
+			// The quad's transform goes in its object block, seen from the player camera
+			UniformBlocks::shared().setFrame(playerCamera, glm::vec4(0.0f));
+			UniformBlocks::shared().setObject(quadModelMatrix, glm::vec4(1.0f), *scene.meshes["quad"]);
+
 			
 			fbo.unbindFrameBuffer(windowWidth, windowHeight);
 			fbo.clearFrameBuffer(glm::vec4(0.2f, 0.2f, 1.0f, 0.0f));
 
 
 			// draw the quad to the backbuffer
-			meshes["quad"]->draw();
+			scene.meshes["quad"]->draw();
 
 		}
 		break;
@@ -267,8 +315,24 @@ void DisplayCallbackFunction(void)
 			/// CODE HERE ////////////////////////////////////////////////////////////
 		}
 		break;
+
+		case SPRITE_DEMO: // press 4
+		{
+			fbo.unbindFrameBuffer(windowWidth, windowHeight);
+			fbo.clearFrameBuffer(glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+
+			TTK::GPUZone zone("Sprites");
+
+			// Sprites are flat, draw them in order
+			TTK::GLState::shared().disable(GL_DEPTH_TEST);
+			drawSprites();
+			TTK::GLState::shared().enable(GL_DEPTH_TEST);
+		}
+		break;
 	}
 
+	TTK::GPUProfiler::shared().endFrame();
+
 	/* Swap Buffers to Make it show up on screen */
 	glutSwapBuffers();
 }
@@ -328,6 +392,35 @@ void KeyboardUpCallbackFunction(unsigned char key, int x, int y)
 			currentMode = POST_PROCESS_DEMO;
 		break;
 
+		case '4':
+			currentMode = SPRITE_DEMO;
+		break;
+
+		case 'i':
+		case 'I':
+		{
+			const char* modeNames[] = { "one draw per object", "sorted", "instanced", "multi draw indirect" };
+
+			scene.drawMode = (ObjectDrawMode)((scene.drawMode + 1) % NUM_DRAW_MODES);
+			std::cout << "Drawing objects: " << modeNames[scene.drawMode] << std::endl;
+		}
+		break;
+
+		case 'p':
+		case 'P':
+			TTK::GPUProfiler::shared().printReport();
+			TTK::GPUProfiler::shared().writeCSV("gpu_profile.csv");
+		break;
+
+#ifdef TTK_PROFILE
+		// The last few seconds of CPU zones, open in about:tracing or ui.perfetto.dev
+		case 'c':
+		case 'C':
+			TTK::Profiler::shared().writeChromeTrace("cpu_trace.json");
+			std::cout << "Wrote cpu_trace.json" << std::endl;
+		break;
+#endif
+
 
 	default:
 		break;
@@ -418,6 +511,18 @@ void MouseMotionCallbackFunction(int x, int y)
 	mousePositionFlipped.y = windowHeight - mousePosition.y;
 }
 
+/* function ShutdownFunction()
+* Description:
+*   - GLUT exits the program from inside glutMainLoop, this frees the GL objects
+*     held by the scene and the shared arena before static destructors run
+*/
+void ShutdownFunction()
+{
+	scene.destroy();
+	TTK::GeometryArena::shared().destroy();
+	TTK::GPUProfiler::shared().destroy();
+}
+
 /* function main()
 * Description:
 *  - this is the main function
@@ -458,14 +563,28 @@ int main(int argc, char **argv)
 	ilInit();
 
 	// Init GL
-	glEnable(GL_DEPTH_TEST);
+	TTK::GLState::shared().enable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
 
+	TTK::MeshUploadQueue::shared().setBytesPerFrame(MESH_UPLOAD_BYTES_PER_FRAME);
+	TTK::GPUProfiler::shared().setEnabled(true);
+
+#ifdef TTK_PROFILE
+	// Frames over three times the target frame time save a trace of themselves
+	TTK_PROFILE_THREAD_NAME("Main");
+	TTK::Profiler::shared().setSpikeThreshold(3000.0 / FRAMES_PER_SECOND);
+#endif
+
 	// Initialize scene
 	initializeShaders();
 	initializeScene();
 	initializeFrameBufferObjects();
 
+	// Made now so it is destroyed after ShutdownFunction runs, atexit handlers and
+	// static destructors run in the reverse of the order they were registered in
+	TTK::GeometryArena::shared();
+	atexit(ShutdownFunction);
+
 	/* Start Game Loop */
 	deltaTime = glutGet(GLUT_ELAPSED_TIME);
 	deltaTime /= 1000.0f;